@@ -2,57 +2,74 @@
 #ifndef BOOK_H                    // Include guard: prevents multiple inclusions of this header
 #define BOOK_H                    // Define the include guard macro
 
+#include <stddef.h>               // For size_t
 
-#define MAX_TITLE_LEN 200         // Maximum length for book title string (199 chars + null terminator)
-#define MAX_AUTHOR_LEN 200        // Maximum length for author name string (199 chars + null terminator)
-#define MAX_BOOKS 800             // Maximum number of books that can be stored in the library
+#define MAX_TITLE_LEN 200         // Maximum length of a title typed in (199 chars + null terminator)
+#define MAX_AUTHOR_LEN 200        // Maximum length of an author name typed in (199 chars + null terminator)
+#define INITIAL_LIBRARY_CAPACITY 64 // Number of book slots allocated the first time the library grows
 
 // Define the Book structure - represents a single book with all its properties
+// The title lives in the string store (see store_string), so each book only
+// pays for the characters it actually uses. The author is an ID in the author
+// dictionary (see author_dict_name), so a name shared by many books is stored
+// once. The borrowed flag is not part of the record: it lives in a bitset in
+// admin.c (see is_book_borrowed).
 typedef struct {
     int id;                       // Unique identifier for each book
-    char title[MAX_TITLE_LEN];    // Array to store the book's title
-    char author[MAX_AUTHOR_LEN];  // Array to store the author's name
     int publication_year;         // Year the book was published
-    int is_borrowed;              // Flag: 1 if borrowed, 0 if available
+    unsigned int author_id;       // The author's name, interned (see author_dict.h)
+    const char *title;            // The book's title (owned by the string store)
 } Book;
 
+// Growable list of book IDs (used for index posting lists and search results)
+typedef struct {
+    int *ids;                     // The IDs, usually kept in ascending order
+    int count;                    // Number of IDs in the list
+    int capacity;                 // Number of IDs that fit before the list must grow
+} IdList;
+
 // Function prototypes (declarations only - actual code is in book.c)
-void display_book(const Book *book);           // Display details of a single book
-int get_next_id(const Book *books, int count); // Get next available unique ID
+void display_book(const Book *book, int is_borrowed); // Display details of a single book
 void clear_input_buffer();                     // Clear stdin buffer after scanf
+const char* store_string(const char *str);     // Copy a string into the string store
+const char* store_string_n(const char *str, size_t len); // Copy `len` bytes into the string store as a string
+void release_strings();                        // Free every string in the string store
+int id_list_push(IdList *list, int id);        // Append an ID, growing the list if needed
+int id_list_insert_sorted(IdList *list, int id); // Insert an ID, keeping the list in ascending order
+void id_list_remove_sorted(IdList *list, int id); // Remove an ID from an ascending list
+void id_list_sort(IdList *list);               // Sort a list in ascending order
+void id_list_intersect(IdList *list, const int *ids, int count); // Keep only IDs also in a sorted array
+void id_list_free(IdList *list);               // Free the list's memory and empty it
 
 #endif // BOOK_H               // End of include guard
 
 // ==================== book.c ====================
 #include <stdio.h>             // Include for printf, scanf functions
+#include <stdlib.h>            // Include for malloc, free functions
 #include <string.h>            // Include for string manipulation functions
-#include <limits.h>            // Include for INT_MIN constant
 
 #include "book.h"              // Include our book header file
+#include "render.h"            // Include the shared listing renderer
 
-// Function to display details of a single book
-void display_book(const Book *book) {
-    printf("ID: %d\n", book->id);                    // Print the book's unique ID
-    printf("Title: %s\n", book->title);              // Print the book's title
-    printf("Author: %s\n", book->author);            // Print the author's name
-    printf("Year: %d\n", book->publication_year);    // Print publication year
-    printf("Status: %s\n", book->is_borrowed ? "Borrowed" : "Available"); // Print status using ternary operator
-    printf("--------------------\n");                // Print separator line
-}
+#define STRING_BLOCK_SIZE (64 * 1024) // Size of one block of the string store
 
-// Function to get the next available unique ID for a new book
-// It finds the maximum existing ID and increments it by 1.
-int get_next_id(const Book *books, int count) {
-    if (count == 0) {                                 // If no books exist in the library
-        return 1;                                     // Start with ID 1 for the first book
-    }
-    int max_id = INT_MIN;                            // Initialize with smallest possible integer
-    for (int i = 0; i < count; i++) {               // Loop through all existing books
-        if (books[i].id > max_id) {                  // If current book's ID is larger than max found so far
-            max_id = books[i].id;                    // Update max_id to current book's ID
-        }
-    }
-    return max_id + 1;                               // Return the next available ID (max + 1)
+// One block of the string store (bump/arena allocator).
+// Strings are appended one after another and freed all at once.
+typedef struct StringBlock {
+    struct StringBlock *next;  // Previously filled block
+    size_t used;               // Bytes already handed out from data
+    size_t size;               // Total bytes available in data
+    char data[];               // The strings themselves
+} StringBlock;
+
+static StringBlock *string_blocks = NULL; // Block currently being filled (head of the list)
+
+// Function to display details of a single book
+void display_book(const Book *book, int is_borrowed) {
+    Renderer r;                                      // Same layout as every other listing
+    render_begin(&r, stdout, RENDER_HUMAN, 0, -1);
+    render_book(&r, book, is_borrowed);
+    render_end(&r);
 }
 
 // Function to clear the standard input buffer
@@ -62,521 +79,8182 @@ void clear_input_buffer() {
     while ((c = getchar()) != '\n' && c != EOF);    // Read and discard characters until newline or EOF
 }
 
-// ==================== admin.h ====================
-#ifndef ADMIN_H                // Include guard to prevent multiple inclusions
-#define ADMIN_H                // Define the include guard macro
+// Function to copy a string into the string store
+// Returns a pointer that stays valid until release_strings(), or NULL if out of memory.
+const char* store_string(const char *str) {
+    return store_string_n(str, strlen(str));         // Copy up to the terminator
+}
+
+// Function to copy `length` bytes (not null-terminated) into the string store
+// The stored copy gets a terminator. Used for strings cut out of a larger buffer.
+const char* store_string_n(const char *str, size_t length) {
+    size_t len = length + 1;                         // Bytes needed, including the null terminator
+    if (string_blocks == NULL || string_blocks->size - string_blocks->used < len) { // Current block is full
+        size_t size = len > STRING_BLOCK_SIZE ? len : STRING_BLOCK_SIZE; // Very long strings get their own block
+        StringBlock *block = malloc(sizeof(StringBlock) + size); // Allocate a new block
+        if (block == NULL) {                         // If allocation failed
+            return NULL;                             // Report failure to the caller
+        }
+        block->next = string_blocks;                 // Chain the new block in front of the old ones
+        block->used = 0;                             // Nothing handed out yet
+        block->size = size;                          // Remember its capacity
+        string_blocks = block;                       // Fill this block from now on
+    }
+    char *copy = string_blocks->data + string_blocks->used; // Next free byte of the block
+    memcpy(copy, str, length);                       // Copy the characters
+    copy[length] = '\0';                             // and terminate them
+    string_blocks->used += len;                      // Bump the fill position
+    return copy;                                     // Return the stored copy
+}
+
+// Function to append an ID to a list, doubling its capacity when full
+// Returns 1 on success, 0 if memory ran out.
+int id_list_push(IdList *list, int id) {
+    if (list->count == list->capacity) {             // List is full
+        int new_capacity = list->capacity ? list->capacity * 2 : 8;
+        int *grown = realloc(list->ids, (size_t) new_capacity * sizeof(int));
+        if (grown == NULL) {                         // If allocation failed
+            return 0;
+        }
+        list->ids = grown;
+        list->capacity = new_capacity;
+    }
+    list->ids[list->count++] = id;                   // Store the ID at the end
+    return 1;
+}
+
+// Function to insert an ID into an ascending list
+// New IDs are normally the largest, so this is usually a plain append.
+int id_list_insert_sorted(IdList *list, int id) {
+    if (!id_list_push(list, id)) {                   // Make room at the end
+        return 0;
+    }
+    int pos = list->count - 1;                       // Slide larger IDs up by one
+    while (pos > 0 && list->ids[pos - 1] > id) {
+        list->ids[pos] = list->ids[pos - 1];
+        pos--;
+    }
+    list->ids[pos] = id;                             // Drop the new ID into place
+    return 1;
+}
+
+// Function to remove an ID from an ascending list (binary search)
+void id_list_remove_sorted(IdList *list, int id) {
+    int lo = 0, hi = list->count;                    // Find the first element >= id
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (list->ids[mid] < id) lo = mid + 1; else hi = mid;
+    }
+    if (lo < list->count && list->ids[lo] == id) {   // Close the gap it leaves
+        memmove(&list->ids[lo], &list->ids[lo + 1], (size_t) (list->count - lo - 1) * sizeof(int));
+        list->count--;
+    }
+}
+
+// Compare two IDs for qsort
+static int compare_ids(const void *a, const void *b) {
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+// Function to sort a list in ascending order
+void id_list_sort(IdList *list) {
+    if (list->count > 1) {
+        qsort(list->ids, (size_t) list->count, sizeof(int), compare_ids);
+    }
+}
+
+// Function to intersect a sorted list with a sorted array, in place
+// Walks both in step; when the array is much longer, binary-searches it instead.
+void id_list_intersect(IdList *list, const int *ids, int count) {
+    int kept = 0;                                    // Number of IDs kept so far
+    int j = 0;                                       // Position in the other array
+    int gallop = count > list->count * 16;           // Other array is much longer: skip through it
+    for (int i = 0; i < list->count && j < count; i++) {
+        int id = list->ids[i];                       // ID we are looking for
+        if (gallop) {                                // Binary search for the first element >= id
+            int lo = j, hi = count;
+            while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (ids[mid] < id) lo = mid + 1; else hi = mid;
+            }
+            j = lo;
+        } else {
+            while (j < count && ids[j] < id) {       // Step forward to the first element >= id
+                j++;
+            }
+        }
+        if (j < count && ids[j] == id) {             // Present in both: keep it
+            list->ids[kept++] = id;
+        }
+    }
+    list->count = kept;                              // Drop everything that was not kept
+}
+
+// Function to free a list's memory
+void id_list_free(IdList *list) {
+    free(list->ids);                                 // Release the IDs
+    list->ids = NULL;                                // Leave an empty, reusable list
+    list->count = 0;
+    list->capacity = 0;
+}
+
+// Function to free every string in the string store at once
+// Called when the whole library is replaced (for example before loading a file).
+void release_strings() {
+    while (string_blocks != NULL) {                  // Walk the chain of blocks
+        StringBlock *next = string_blocks->next;     // Remember the next block
+        free(string_blocks);                         // Free the current one
+        string_blocks = next;                        // Move on
+    }
+}
+
+// ==================== author_dict.h ====================
+#ifndef AUTHOR_DICT_H          // Include guard to prevent multiple inclusions
+#define AUTHOR_DICT_H          // Define the include guard macro
+
+#include <stddef.h>            // For size_t
+
+// Dictionary of interned author names. Authors repeat across a catalog, so
+// every distinct name is stored once and books hold its 32-bit ID; two books
+// have the same author exactly when their IDs are equal.
+// Names never move until author_dict_clear(), and a name is stored before its
+// ID is published, so a thread that read an ID from a book can look up its
+// name while another thread interns new names.
+#define AUTHOR_NONE 0u                 // ID of the empty name (tombstones)
+#define AUTHOR_INVALID 0xFFFFFFFFu     // Returned when a name could not be interned
+#define AUTHOR_DICT_PAGE_NAMES 4096    // Names per page of the ID -> name table
+#define AUTHOR_DICT_MAX_PAGES 16384    // Pages the table can hold (67M distinct authors)
+
+unsigned int author_dict_intern(const char *name);                  // ID of a name, copied into name storage if new
+unsigned int author_dict_intern_n(const char *name, size_t length); // Same for `length` bytes that are not null-terminated
+unsigned int author_dict_adopt(const char *name);                   // Same, but a new name is used where it lies (must stay valid until cleared)
+const char* author_dict_name(unsigned int id);                      // Name of an ID ("" for AUTHOR_NONE)
+unsigned int author_dict_count();                                   // IDs handed out so far (every valid ID is below this)
+unsigned long long* author_dict_matching(const char *text);         // Bitset of the IDs whose name contains `text` (any case); free() it. NULL if out of memory
+void author_dict_clear();                                           // Forget every name (when the library is cleared)
+
+#endif // AUTHOR_DICT_H        // End of include guard
+
+// ==================== author_dict.c ====================
+#include <stdlib.h>            // For malloc, calloc, free functions
+#include <string.h>            // For strlen, strncmp, memcpy, memset functions
+
+#include "author_dict.h"       // Include our dictionary declarations
+#include "text_search.h"       // Include find_ignore_case
+
+#define AUTHOR_DICT_MIN_SLOTS 1024 // Smallest hash table (always a power of two)
+#define AUTHOR_NAME_BLOCK_SIZE (64 * 1024) // Size of one block of name storage
+
+// One block of name storage. Names get their own blocks instead of sharing
+// the string store with titles, so the names of a whole catalog sit close
+// together and stay in cache while a listing walks the books.
+typedef struct NameBlock {
+    struct NameBlock *next;    // Previously filled block
+    size_t used;               // Bytes already handed out from data
+    size_t size;               // Total bytes available in data
+    char data[];               // The names themselves
+} NameBlock;
+
+// Entry of the name -> ID hash table
+typedef struct {
+    unsigned int hash;         // Hash of the name, kept to skip most string compares
+    unsigned int id;           // ID of the name (AUTHOR_NONE = unused entry)
+} AuthorSlot;
+
+static const char **name_pages[AUTHOR_DICT_MAX_PAGES]; // ID -> name, allocated a page at a time (pages never move)
+static unsigned int name_count = 1;        // Next ID to hand out (ID 0 is the empty name)
+static AuthorSlot *author_slots = NULL;    // Open-addressing table from name to ID
+static unsigned int slot_capacity = 0;     // Number of entries (power of two)
+static NameBlock *name_blocks = NULL;      // Block currently being filled (head of the list)
+
+// Copy `length` bytes into name storage as a string; NULL if out of memory
+static const char* store_name(const char *name, size_t length) {
+    size_t len = length + 1;                          // Bytes needed, including the null terminator
+    if (name_blocks == NULL || name_blocks->size - name_blocks->used < len) { // Current block is full
+        size_t size = len > AUTHOR_NAME_BLOCK_SIZE ? len : AUTHOR_NAME_BLOCK_SIZE;
+        NameBlock *block = malloc(sizeof(NameBlock) + size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = name_blocks;
+        block->used = 0;
+        block->size = size;
+        name_blocks = block;
+    }
+    char *copy = name_blocks->data + name_blocks->used;
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    name_blocks->used += len;
+    return copy;
+}
+
+// FNV-1a hash of `length` bytes of a name
+static unsigned int hash_name(const char *name, size_t length) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (unsigned char) name[i]) * 16777619u;
+    }
+    return h;
+}
+
+static const char* name_at(unsigned int id) {
+    return name_pages[id / AUTHOR_DICT_PAGE_NAMES][id % AUTHOR_DICT_PAGE_NAMES];
+}
+
+// Grow the hash table and re-insert every ID
+static int author_dict_resize(unsigned int new_capacity) {
+    AuthorSlot *table = calloc(new_capacity, sizeof(AuthorSlot));
+    if (table == NULL) {
+        return 0;
+    }
+    for (unsigned int i = 0; i < slot_capacity; i++) {
+        if (author_slots[i].id != AUTHOR_NONE) {
+            unsigned int pos = author_slots[i].hash & (new_capacity - 1);
+            while (table[pos].id != AUTHOR_NONE) {    // Linear probing
+                pos = (pos + 1) & (new_capacity - 1);
+            }
+            table[pos] = author_slots[i];
+        }
+    }
+    free(author_slots);
+    author_slots = table;
+    slot_capacity = new_capacity;
+    return 1;
+}
+
+// Find a name, adding it if it is new; `copy` decides whether a new name is
+// copied into name storage or used where it lies (then it must be terminated)
+static unsigned int intern(const char *name, size_t length, int copy) {
+    if (length == 0) {                                // The empty name needs no entry
+        return AUTHOR_NONE;
+    }
+    if (name_count * 2 > slot_capacity) {             // Keep the table at most half full
+        unsigned int new_capacity = slot_capacity ? slot_capacity * 2 : AUTHOR_DICT_MIN_SLOTS;
+        if (!author_dict_resize(new_capacity) && name_count >= slot_capacity) {
+            return AUTHOR_INVALID;
+        }
+    }
+    unsigned int hash = hash_name(name, length);
+    unsigned int pos = hash & (slot_capacity - 1);
+    while (author_slots[pos].id != AUTHOR_NONE) {     // Walk the probe sequence
+        const char *stored = name_at(author_slots[pos].id);
+        if (author_slots[pos].hash == hash && strncmp(stored, name, length) == 0 && stored[length] == '\0') {
+            return author_slots[pos].id;              // Seen before: no new string
+        }
+        pos = (pos + 1) & (slot_capacity - 1);
+    }
+
+    unsigned int id = name_count;                     // A new author
+    unsigned int page = id / AUTHOR_DICT_PAGE_NAMES;
+    if (page >= AUTHOR_DICT_MAX_PAGES) {              // Table is full
+        return AUTHOR_INVALID;
+    }
+    if (name_pages[page] == NULL) {
+        name_pages[page] = malloc(AUTHOR_DICT_PAGE_NAMES * sizeof(const char *));
+        if (name_pages[page] == NULL) {
+            return AUTHOR_INVALID;
+        }
+        if (page == 0) {
+            name_pages[0][AUTHOR_NONE] = "";
+        }
+    }
+    const char *stored = copy ? store_name(name, length) : name;
+    if (stored == NULL) {
+        return AUTHOR_INVALID;
+    }
+    name_pages[page][id % AUTHOR_DICT_PAGE_NAMES] = stored;
+    author_slots[pos].hash = hash;
+    author_slots[pos].id = id;
+    __atomic_store_n(&name_count, id + 1, __ATOMIC_RELEASE); // Publish the ID once its name is in place
+    return id;
+}
+
+unsigned int author_dict_intern(const char *name) {
+    return intern(name, strlen(name), 1);
+}
+
+unsigned int author_dict_intern_n(const char *name, size_t length) {
+    return intern(name, length, 1);
+}
+
+unsigned int author_dict_adopt(const char *name) {
+    return intern(name, strlen(name), 0);
+}
+
+const char* author_dict_name(unsigned int id) {
+    return id == AUTHOR_NONE ? "" : name_at(id);
+}
+
+unsigned int author_dict_count() {
+    return __atomic_load_n(&name_count, __ATOMIC_ACQUIRE);
+}
+
+// Function to find every author whose name contains some text
+// Each distinct name is checked once, however many books it has; a scan then
+// tests a book's author with one bit. Covers the IDs handed out before the call.
+unsigned long long* author_dict_matching(const char *text) {
+    unsigned int count = author_dict_count();
+    unsigned long long *bits = calloc((count + 63) / 64, sizeof(unsigned long long));
+    if (bits == NULL) {
+        return NULL;
+    }
+    for (unsigned int id = 1; id < count; id++) {
+        if (find_ignore_case(name_at(id), text)) {
+            bits[id / 64] |= 1ULL << (id % 64);
+        }
+    }
+    return bits;
+}
+
+// Function to forget every name
+// Copied names are freed; adopted ones belong to their owner (a snapshot
+// mapping). The pages and the hash table are kept for the next library.
+void author_dict_clear() {
+    if (author_slots != NULL) {
+        memset(author_slots, 0, slot_capacity * sizeof(AuthorSlot));
+    }
+    __atomic_store_n(&name_count, 1, __ATOMIC_RELEASE);
+    while (name_blocks != NULL) {                     // Walk the chain of blocks
+        NameBlock *next = name_blocks->next;
+        free(name_blocks);
+        name_blocks = next;
+    }
+}
+
+// ==================== id_index.h ====================
+#ifndef ID_INDEX_H             // Include guard to prevent multiple inclusions
+#define ID_INDEX_H             // Define the include guard macro
 
-#include <stdio.h>             // Include standard I/O functions
 #include "book.h"              // Include Book structure definition
 
-// Function declarations only - actual implementations are in admin.c
-int find_book_by_id(int id);                           // Find book index by ID
-void addBook();                                         // Add a new book to library
-void removeBook();                                      // Remove a book from library
-void countTotalBooks();                                 // Display book statistics
-void admin_mode();                                      // Admin menu interface
-void view_all_books(const Book books[], int count);    // Display all books
-void view_borrowed_books(const Book books[], int count); // Display only borrowed books
-void invalid_choice();                                  // Handle invalid menu choices
+// Hash index from book ID to its slot (array index) in the library.
+// Lookups, inserts and removals are O(1) on average, whatever the catalog size.
+void id_index_put(int id, int slot);                    // Insert or update the slot stored for an ID
+int id_index_get(int id);                               // Return the slot for an ID, or -1 if not indexed
+void id_index_remove(int id);                           // Remove an ID from the index
+void id_index_clear();                                  // Remove every entry (keeps the table allocated)
+void id_index_rebuild(const Book *books, int count);   // Re-index a whole array of books
 
-// Function declarations to get addresses of global variables from admin.c
-Book* get_library_address();                           // Returns pointer to library array
-int* get_book_count_address();                         // Returns pointer to book_count variable
-int* get_next_id_address();                            // Returns pointer to next_id variable
+#endif // ID_INDEX_H           // End of include guard
 
-#endif                         // End of include guard
+// ==================== id_index.c ====================
+#include <stdlib.h>            // For malloc, calloc, free functions
+#include <string.h>            // For memset function
 
-// ==================== admin.c ====================
-#include <stdio.h>             // Include for printf, scanf, fgets functions
-#include <string.h>            // Include for strcspn function (string operations)
-#include <ctype.h>             // Include for character type functions (not used here but included)
-#include "book.h"              // Include Book structure and related functions
-#include "admin.h"             // Include admin function declarations
+#include "id_index.h"          // Include our index declarations
 
-Book library[MAX_BOOKS];       // Global array to store all books in the library
-int book_count = 0;           // Global variable tracking number of books currently in library
-int next_id = 1;              // Global variable for generating unique book IDs
+#define ID_INDEX_EMPTY 0       // Marker for an unused table entry (book IDs start at 1)
+#define ID_INDEX_MIN_CAPACITY 64 // Smallest table size (always a power of two)
 
-// Functions to get addresses of global variables - allows other files to access these variables
-Book* get_library_address() {
-    return library;            // Return pointer to the first element of library array
+// One entry of the open-addressing table
+typedef struct {
+    int id;                    // Book ID stored in this entry (ID_INDEX_EMPTY if unused)
+    int slot;                  // Index of the book in the library array
+} IdIndexEntry;
+
+static IdIndexEntry *id_table = NULL; // Table of entries, linear probing
+static int id_table_capacity = 0;     // Number of entries in the table (power of two)
+static int id_table_used = 0;         // Number of entries currently holding an ID
+static int id_table_shift = 32;       // 32 - log2(capacity): drops all but the top bits of a hash
+
+// Spread the bits of an ID and map it into the table (Fibonacci hashing)
+static int id_index_home(int id) {
+    unsigned int h = (unsigned int) id * 2654435769u; // Multiply by 2^32 / golden ratio
+    return (int) (h >> id_table_shift);               // Keep the top bits (the low bits only depend on the low bits of the ID)
 }
 
-int* get_book_count_address() {
-    return &book_count;        // Return address of book_count variable
+// Grow the table to new_capacity entries and re-insert all existing entries
+static int id_index_resize(int new_capacity) {
+    IdIndexEntry *old_table = id_table;           // Keep the old table to copy from
+    int old_capacity = id_table_capacity;         // Remember its size
+
+    IdIndexEntry *table = calloc((size_t) new_capacity, sizeof(IdIndexEntry)); // Zeroed = all entries empty
+    if (table == NULL) {                          // If allocation failed
+        return 0;                                 // Keep using the old table
+    }
+    id_table = table;                             // Switch to the new table
+    id_table_capacity = new_capacity;             // Record its size
+    id_table_shift = 32 - __builtin_ctz((unsigned int) new_capacity);
+
+    for (int i = 0; i < old_capacity; i++) {      // Move every used entry to its new home
+        if (old_table[i].id != ID_INDEX_EMPTY) {
+            int pos = id_index_home(old_table[i].id);
+            while (id_table[pos].id != ID_INDEX_EMPTY) { // Probe until a free entry is found
+                pos = (pos + 1) & (id_table_capacity - 1);
+            }
+            id_table[pos] = old_table[i];         // Store the entry
+        }
+    }
+    free(old_table);                              // Release the old table
+    return 1;                                     // Resize succeeded
 }
 
-int* get_next_id_address() {
-    return &next_id;           // Return address of next_id variable
+// Function to insert an ID, or update its slot if it is already indexed
+void id_index_put(int id, int slot) {
+    if ((id_table_used + 1) * 2 > id_table_capacity) { // Keep the table at most half full
+        int new_capacity = id_table_capacity ? id_table_capacity * 2 : ID_INDEX_MIN_CAPACITY;
+        if (!id_index_resize(new_capacity) && id_table_used + 1 >= id_table_capacity) {
+            return;                               // Out of memory and no free entry left
+        }
+    }
+
+    int pos = id_index_home(id);                  // Start probing at the ID's home entry
+    while (id_table[pos].id != ID_INDEX_EMPTY) {  // Walk the probe sequence
+        if (id_table[pos].id == id) {             // ID already indexed
+            id_table[pos].slot = slot;            // Just update its slot
+            return;
+        }
+        pos = (pos + 1) & (id_table_capacity - 1); // Try the next entry (wrap around)
+    }
+    id_table[pos].id = id;                        // Claim the free entry
+    id_table[pos].slot = slot;
+    id_table_used++;                              // One more entry in use
 }
 
-// Function to find book by ID (without pointers)
-int find_book_by_id(int id) {
-    for (int i = 0; i < book_count; i++) {           // Loop through all books in library
-        if (library[i].id == id) {                   // If current book's ID matches searched ID
-            return i;                                 // Return the index of the found book
+// Function to look up the slot of a book by its ID
+int id_index_get(int id) {
+    if (id_table_used == 0 || id == ID_INDEX_EMPTY) { // Nothing indexed, or an ID that can never exist
+        return -1;
+    }
+    int pos = id_index_home(id);                  // Start at the ID's home entry
+    while (id_table[pos].id != ID_INDEX_EMPTY) {  // An empty entry ends the probe sequence
+        if (id_table[pos].id == id) {             // Found the ID
+            return id_table[pos].slot;            // Return its slot
         }
+        pos = (pos + 1) & (id_table_capacity - 1); // Try the next entry
     }
-    return -1;                                       // Return -1 if book not found
+    return -1;                                    // ID is not in the index
 }
 
-// Function to add a book
-void addBook() {
-    if (book_count >= MAX_BOOKS) {                   // Check if library is full
-        printf("Library is full and you Cannot add more books.\n"); // Display error message
-        return;                                       // Exit function early
+// Function to remove an ID from the index
+// Uses backward-shift deletion so no tombstones are left behind.
+void id_index_remove(int id) {
+    if (id_table_used == 0) {                     // Nothing to remove
+        return;
+    }
+    int mask = id_table_capacity - 1;             // Mask for wrapping positions
+    int pos = id_index_home(id);                  // Find the entry holding the ID
+    while (id_table[pos].id != id) {
+        if (id_table[pos].id == ID_INDEX_EMPTY) { // Reached the end of the probe sequence
+            return;                               // ID was not indexed
+        }
+        pos = (pos + 1) & mask;
     }
-    
-    printf("\n Add New Book \n");                   // Display section header
-    
-    clear_input_buffer();                           // Clear any leftover input from previous scanf
-    
-    printf("Enter the book title: ");               // Prompt user for title
-    fgets(library[book_count].title, MAX_TITLE_LEN, stdin); // Read title including spaces
-    library[book_count].title[strcspn(library[book_count].title, "\n")] = 0; // Remove newline character
-    
-    printf("Enter author name: ");                  // Prompt user for author
-    fgets(library[book_count].author, MAX_AUTHOR_LEN, stdin); // Read author name including spaces
-    library[book_count].author[strcspn(library[book_count].author, "\n")] = 0; // Remove newline character
-    
-    printf("Enter publication year: ");             // Prompt user for year
-    scanf("%d", &library[book_count].publication_year); // Read publication year as integer
-    
-    library[book_count].id = next_id++;             // Assign current next_id and increment it
-    library[book_count].is_borrowed = 0;            // Set book as available (not borrowed)
-    
-    book_count++;                                   // Increment total book count
 
-    printf("Book added successfully! (ID: %d)\n", library[book_count-1].id); // Confirm addition with ID
+    int next = (pos + 1) & mask;                  // Pull later entries of the cluster back
+    while (id_table[next].id != ID_INDEX_EMPTY) {
+        int home = id_index_home(id_table[next].id); // Where this entry would like to live
+        // Move it into the hole only if the hole lies between its home and its current position
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            id_table[pos] = id_table[next];       // Shift the entry back into the hole
+            pos = next;                           // The hole moves forward
+        }
+        next = (next + 1) & mask;
+    }
+    id_table[pos].id = ID_INDEX_EMPTY;            // Clear the final hole
+    id_table_used--;                              // One fewer entry in use
 }
 
-// Function to remove books
-void removeBook() {
-    if (book_count == 0) {                          // Check if library is empty
-        printf("No books in this library to remove.\n"); // Display message
-        return;                                      // Exit function early
+// Function to remove every entry from the index
+void id_index_clear() {
+    if (id_table != NULL) {                       // Only if a table was allocated
+        memset(id_table, 0, (size_t) id_table_capacity * sizeof(IdIndexEntry)); // Mark all entries empty
     }
-    
-    int id;                                         // Variable to store book ID to remove
-    printf("\n Remove Book\n");                    // Display section header
-    printf("Enter book ID to remove: ");           // Prompt for book ID
-    scanf("%d", &id);                              // Read book ID
+    id_table_used = 0;                            // No entries in use
+}
 
-    int index = find_book_by_id(id);               // Find the book's index in array
-    if (index == -1) {                             // If book not found
-        printf("Book with ID %d not found.\n", id); // Display error message
-        return;                                     // Exit function
+// Function to rebuild the index from an array of books (used after loading)
+void id_index_rebuild(const Book *books, int count) {
+    id_index_clear();                             // Start from an empty index
+    for (int i = 0; i < count; i++) {             // Index every book by its position
+        if (books[i].id != 0) {                   // Skip tombstoned slots
+            id_index_put(books[i].id, i);
+        }
     }
-    printf("Book was found: \"%s\" by %s\n", library[index].title, library[index].author); // Show found book
+}
 
-    printf("Are you sure you wanna remove this book? (y/n): "); // Confirmation prompt
-    char confirm;                                   // Variable to store user's confirmation
-    scanf(" %c", &confirm);                        // Read confirmation (space before %c to skip whitespace)
+// ==================== title_index.h ====================
+#ifndef TITLE_INDEX_H          // Include guard to prevent multiple inclusions
+#define TITLE_INDEX_H          // Define the include guard macro
 
-    if (confirm == 'y' || confirm == 'Y') {        // If user confirms removal
-        for (int i = index; i < book_count - 1; i++) { // Shift all books after removed book
-            library[i] = library[i + 1];           // Copy next book to current position
+#include "book.h"              // Include IdList definition
+
+#define TRIGRAM_LEN 3          // Titles are indexed by every run of 3 characters
+
+// Trigram inverted indexes over case-folded text: one over titles and one over
+// author names. Each trigram maps to the sorted list of IDs whose text contains
+// it, so a substring query only has to look at books that contain all of its
+// trigrams, and a fuzzy query at books that share most of them.
+#define TRIGRAM_TITLES 0       // Index over titles
+#define TRIGRAM_AUTHORS 1      // Index over author names
+#define TRIGRAM_FIELDS 2       // Number of indexes
+
+void title_index_add(int id, const char *title);       // Index a book's title
+void title_index_remove(int id, const char *title);    // Un-index a book's title
+void title_index_clear();                              // Remove every entry
+int title_index_candidates(const char *query, IdList *out); // Candidate IDs for a substring query
+
+void trigram_index_add(int field, int id, const char *text);    // Index a book's title or author
+void trigram_index_remove(int field, int id, const char *text); // Un-index it
+void trigram_index_clear(int field);                            // Remove every entry of one index
+int trigram_count(const char *text);                            // Distinct trigrams of a string
+long long trigram_index_cost(int field, const char *text);      // IDs a similarity pass over `text` would read
+// Calls `visit` once for every ID whose text shares at least `min_shared` of
+// the distinct trigrams of `text` (count filter for fuzzy matching).
+// Returns the number of IDs visited, or -1 if out of memory.
+long long trigram_index_similar(int field, const char *text, int min_shared,
+                                void (*visit)(int id, void *context), void *context);
+
+#endif // TITLE_INDEX_H        // End of include guard
+
+// ==================== title_index.c ====================
+#include <stdlib.h>            // For malloc, realloc, calloc, free, qsort functions
+#include <string.h>            // For strlen function
+#include <ctype.h>             // For tolower function
+
+#include "title_index.h"       // Include our index declarations
+
+#define TRIGRAM_TABLE_MIN_CAPACITY 1024 // Smallest trigram table (always a power of two)
+
+// Posting list of one trigram
+typedef struct {
+    unsigned int key;          // Three folded bytes packed into an int (0 = unused entry)
+    IdList ids;                // Sorted IDs of books whose text contains the trigram
+} TrigramPosting;
+
+// Open-addressing table of posting lists (one per indexed field)
+typedef struct {
+    TrigramPosting *table;     // The entries
+    int capacity;              // Number of entries (power of two)
+    int used;                  // Number of entries holding a trigram
+} TrigramTable;
+
+static TrigramTable trigram_tables[TRIGRAM_FIELDS]; // Titles and authors
+
+// Scratch space is per thread so that lookups can run in parallel
+static _Thread_local unsigned int *trigram_buffer = NULL; // Scratch space for the trigrams of one string
+static _Thread_local int trigram_buffer_capacity = 0;     // Number of trigrams that fit in the scratch space
+
+// Map a trigram key to its home entry in a table
+static int trigram_home(const TrigramTable *t, unsigned int key) {
+    return (int) ((key * 2654435769u) >> 8) & (t->capacity - 1); // Multiplicative hash
+}
+
+// Grow a table and re-insert every posting list
+static int trigram_table_resize(TrigramTable *t, int new_capacity) {
+    TrigramPosting *table = calloc((size_t) new_capacity, sizeof(TrigramPosting));
+    if (table == NULL) {                              // If allocation failed
+        return 0;
+    }
+    TrigramPosting *old_table = t->table;             // Move entries out of the old table
+    int old_capacity = t->capacity;
+    t->table = table;
+    t->capacity = new_capacity;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_table[i].key != 0) {
+            int pos = trigram_home(t, old_table[i].key);
+            while (t->table[pos].key != 0) {          // Linear probing
+                pos = (pos + 1) & (t->capacity - 1);
+            }
+            t->table[pos] = old_table[i];             // The posting list itself does not move
         }
-        book_count--;                               // Decrease total book count
-        printf("Book with ID %d removed successfully.\n", id); // Confirm removal
-    } else {                                        // If user cancels
-        printf("Book removal canceled.\n");        // Display cancellation message
     }
+    free(old_table);
+    return 1;
 }
 
-// Function to count total books
-void countTotalBooks() {
-    printf("\n Book Count \n");                    // Display section header
-    printf("Total books in library: %d\n", book_count); // Display total count
+// Find the posting list of a trigram, optionally creating an empty one
+// The returned pointer is only valid until the next insertion.
+static TrigramPosting* trigram_lookup(TrigramTable *t, unsigned int key, int create) {
+    if (create && (t->used + 1) * 2 > t->capacity) {  // Keep the table at most half full
+        int new_capacity = t->capacity ? t->capacity * 2 : TRIGRAM_TABLE_MIN_CAPACITY;
+        if (!trigram_table_resize(t, new_capacity) && t->used + 1 >= t->capacity) {
+            return NULL;                              // Out of memory and no free entry left
+        }
+    }
+    if (t->capacity == 0) {                           // Nothing indexed yet
+        return NULL;
+    }
+    int pos = trigram_home(t, key);
+    while (t->table[pos].key != 0) {                  // Walk the probe sequence
+        if (t->table[pos].key == key) {
+            return &t->table[pos];                    // Found the trigram
+        }
+        pos = (pos + 1) & (t->capacity - 1);
+    }
+    if (!create) {                                    // Trigram never seen
+        return NULL;
+    }
+    t->table[pos].key = key;                          // Claim the free entry with an empty list
+    t->used++;
+    return &t->table[pos];
+}
+
+// Compare two trigram keys for qsort
+static int compare_keys(const void *a, const void *b) {
+    unsigned int x = *(const unsigned int *) a, y = *(const unsigned int *) b;
+    return (x > y) - (x < y);
+}
+
+// Collect the distinct case-folded trigrams of a string into trigram_buffer
+// Returns how many there are (0 if the string is shorter than a trigram), or -1 if out of memory.
+static int collect_trigrams(const char *str) {
+    size_t len = strlen(str);                         // Number of characters in the string
+    if (len < TRIGRAM_LEN) {                          // Too short to contain a trigram
+        return 0;
+    }
+    int n = (int) (len - TRIGRAM_LEN + 1);            // Number of trigram positions
+    if (n > trigram_buffer_capacity) {                // Grow the scratch space if needed
+        unsigned int *grown = realloc(trigram_buffer, (size_t) n * sizeof(unsigned int));
+        if (grown == NULL) {
+            return -1;
+        }
+        trigram_buffer = grown;
+        trigram_buffer_capacity = n;
+    }
+    unsigned int key = 0;                             // Sliding window of the last three folded bytes
+    for (size_t i = 0; i < len; i++) {
+        key = ((key << 8) | (unsigned char) tolower((unsigned char) str[i])) & 0xFFFFFF;
+        if (i + 1 >= TRIGRAM_LEN) {
+            trigram_buffer[i + 1 - TRIGRAM_LEN] = key; // Store each full window
+        }
+    }
+    qsort(trigram_buffer, (size_t) n, sizeof(unsigned int), compare_keys); // Sort, then drop repeats
+    int distinct = 0;
+    for (int i = 0; i < n; i++) {
+        if (distinct == 0 || trigram_buffer[distinct - 1] != trigram_buffer[i]) {
+            trigram_buffer[distinct++] = trigram_buffer[i];
+        }
+    }
+    return distinct;
+}
+
+// Function to add a book's title or author to an index
+void trigram_index_add(int field, int id, const char *text) {
+    TrigramTable *t = &trigram_tables[field];
+    int n = collect_trigrams(text);                   // Distinct trigrams of the text
+    for (int i = 0; i < n; i++) {
+        TrigramPosting *posting = trigram_lookup(t, trigram_buffer[i], 1); // Find or create its list
+        if (posting != NULL) {                        // (out of memory: this trigram stays incomplete)
+            id_list_insert_sorted(&posting->ids, id); // Books loaded from a file may arrive out of order
+        }
+    }
+}
+
+// Function to remove a book's title or author from an index
+void trigram_index_remove(int field, int id, const char *text) {
+    TrigramTable *t = &trigram_tables[field];
+    int n = collect_trigrams(text);                   // Same trigrams that were added
+    for (int i = 0; i < n; i++) {
+        TrigramPosting *posting = trigram_lookup(t, trigram_buffer[i], 0);
+        if (posting != NULL) {
+            id_list_remove_sorted(&posting->ids, id); // Binary search and close the gap
+        }
+    }
+}
+
+// Function to remove every entry from an index
+void trigram_index_clear(int field) {
+    TrigramTable *t = &trigram_tables[field];
+    for (int i = 0; i < t->capacity; i++) {           // Free every posting list
+        if (t->table[i].key != 0) {
+            id_list_free(&t->table[i].ids);
+            t->table[i].key = 0;
+        }
+    }
+    t->used = 0;
+}
+
+void title_index_add(int id, const char *title) {
+    trigram_index_add(TRIGRAM_TITLES, id, title);
+}
+
+void title_index_remove(int id, const char *title) {
+    trigram_index_remove(TRIGRAM_TITLES, id, title);
+}
+
+void title_index_clear() {
+    trigram_index_clear(TRIGRAM_TITLES);
+}
+
+// Compare two posting lists by length for qsort (shortest first)
+static int compare_postings(const void *a, const void *b) {
+    const TrigramPosting *x = *(TrigramPosting * const *) a, *y = *(TrigramPosting * const *) b;
+    return (x->ids.count > y->ids.count) - (x->ids.count < y->ids.count);
+}
+
+// Function to find candidate IDs for a case-insensitive substring query
+// Fills `out` (sorted by ID) with every book whose title contains all of the
+// query's trigrams; callers still verify each candidate against the title.
+// Returns 0 if the query is too short to use the index (caller must scan).
+int title_index_candidates(const char *query, IdList *out) {
+    TrigramTable *t = &trigram_tables[TRIGRAM_TITLES];
+    out->count = 0;                                   // Start with an empty result
+    int n = collect_trigrams(query);                  // Distinct trigrams of the query
+    if (n <= 0) {                                     // Too short (or out of memory): no index help
+        return 0;
+    }
+    TrigramPosting **lists = malloc((size_t) n * sizeof(TrigramPosting *)); // One posting list per trigram
+    if (lists == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        lists[i] = trigram_lookup(t, trigram_buffer[i], 0);
+        if (lists[i] == NULL) {                       // A trigram no title contains: no matches at all
+            free(lists);
+            return 1;
+        }
+    }
+    qsort(lists, (size_t) n, sizeof(TrigramPosting *), compare_postings); // Intersect smallest lists first
+    for (int i = 0; i < lists[0]->ids.count; i++) {   // Start from the shortest list
+        if (!id_list_push(out, lists[0]->ids.ids[i])) {
+            out->count = 0;                           // Out of memory: let the caller scan instead
+            free(lists);
+            return 0;
+        }
+    }
+    for (int i = 1; i < n && out->count > 0; i++) {   // Narrow it down with each other list
+        id_list_intersect(out, lists[i]->ids.ids, lists[i]->ids.count);
+    }
+    free(lists);
+    return 1;
+}
+
+int trigram_count(const char *text) {
+    int n = collect_trigrams(text);
+    return n > 0 ? n : 0;
+}
+
+long long trigram_index_cost(int field, const char *text) {
+    TrigramTable *t = &trigram_tables[field];
+    int n = collect_trigrams(text);
+    long long cost = 0;
+    for (int i = 0; i < n; i++) {                     // Every posting list the pass would walk
+        TrigramPosting *posting = trigram_lookup(t, trigram_buffer[i], 0);
+        cost += posting != NULL ? posting->ids.count : 0;
+    }
+    return cost;
+}
+
+// Read position in one posting list during a merge
+typedef struct {
+    const int *ids;            // The list's IDs (ascending)
+    int count;                 // Number of IDs
+    int pos;                   // Next ID to read
+} PostingCursor;
+
+// Restore the min-heap (ordered by each cursor's next ID) below `i`
+static void sift_cursor(PostingCursor *heap, int size, int i) {
+    while (1) {
+        int smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && heap[left].ids[heap[left].pos] < heap[smallest].ids[heap[smallest].pos]) smallest = left;
+        if (right < size && heap[right].ids[heap[right].pos] < heap[smallest].ids[heap[smallest].pos]) smallest = right;
+        if (smallest == i) {
+            return;
+        }
+        PostingCursor swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+// Function to visit every ID sharing enough trigrams with a string
+// The posting lists of the string's trigrams are merged in ID order with a
+// small heap; each ID is counted as it comes out of all the lists holding it
+// and visited if it appeared in at least `min_shared` of them. Memory is one
+// cursor per trigram, whatever the number of hits.
+long long trigram_index_similar(int field, const char *text, int min_shared,
+                                void (*visit)(int id, void *context), void *context) {
+    TrigramTable *t = &trigram_tables[field];
+    int n = collect_trigrams(text);
+    if (n < 0) {
+        return -1;
+    }
+    PostingCursor *heap = malloc((size_t) (n > 0 ? n : 1) * sizeof(PostingCursor));
+    if (heap == NULL) {
+        return -1;
+    }
+    if (min_shared < 1) min_shared = 1;               // Must share something
+    int size = 0;
+    for (int i = 0; i < n; i++) {
+        TrigramPosting *posting = trigram_lookup(t, trigram_buffer[i], 0);
+        if (posting != NULL && posting->ids.count > 0) { // Unknown trigrams simply never count
+            heap[size].ids = posting->ids.ids;
+            heap[size].count = posting->ids.count;
+            heap[size].pos = 0;
+            size++;
+        }
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) {         // Heapify
+        sift_cursor(heap, size, i);
+    }
+    long long visited = 0;
+    while (size >= min_shared) {                      // Fewer lists left than needed: nothing else can qualify
+        int id = heap[0].ids[heap[0].pos];            // Smallest ID still unread
+        int shared = 0;
+        while (size > 0 && heap[0].ids[heap[0].pos] == id) { // Pop it from every list holding it
+            shared++;
+            if (++heap[0].pos == heap[0].count) {     // List used up: drop it
+                heap[0] = heap[--size];
+            }
+            sift_cursor(heap, size, 0);
+        }
+        if (shared >= min_shared) {
+            visit(id, context);
+            visited++;
+        }
+    }
+    free(heap);
+    return visited;
+}
+
+// ==================== author_index.h ====================
+#ifndef AUTHOR_INDEX_H         // Include guard to prevent multiple inclusions
+#define AUTHOR_INDEX_H         // Define the include guard macro
+
+#include "book.h"              // Include IdList definition
+
+// Hash index from normalized author name to the sorted IDs of their books.
+// Names are normalized by folding case and collapsing spaces, so
+// "j.r.r.  TOLKIEN " and "J.R.R. Tolkien" are the same author.
+void author_index_add(int id, const char *author);     // Index a book under its author
+void author_index_remove(int id, const char *author);  // Un-index a book
+void author_index_clear();                             // Remove every entry
+const IdList* author_index_lookup(const char *author); // Books by exactly this author, or NULL
+
+#endif // AUTHOR_INDEX_H       // End of include guard
+
+// ==================== author_index.c ====================
+#include <stdlib.h>            // For malloc, realloc, calloc, free functions
+#include <string.h>            // For strlen, strcmp, memcpy functions
+#include <ctype.h>             // For tolower, isspace functions
+
+#include "author_index.h"      // Include our index declarations
+
+#define AUTHOR_TABLE_MIN_CAPACITY 256 // Smallest author table (always a power of two)
+
+// Posting list of one author
+typedef struct {
+    char *key;                 // Normalized author name (NULL = unused entry)
+    unsigned int hash;         // Hash of key, kept to skip most string compares
+    IdList ids;                // Sorted IDs of this author's books
+} AuthorPosting;
+
+static AuthorPosting *author_table = NULL; // Open-addressing table of posting lists
+static int author_capacity = 0;            // Number of entries (power of two)
+static int author_used = 0;                // Number of entries holding an author
+
+// Scratch buffer is per thread so that lookups can run in parallel
+static _Thread_local char *normalized = NULL;        // Scratch buffer for the normalized form of a name
+static _Thread_local size_t normalized_capacity = 0; // Bytes available in the scratch buffer
+
+// Normalize a name into the scratch buffer: lowercase, single spaces, no outer spaces
+// Returns the buffer, or NULL if out of memory.
+static const char* normalize_author(const char *author) {
+    size_t len = strlen(author) + 1;                  // Normalized form is never longer
+    if (len > normalized_capacity) {
+        char *grown = realloc(normalized, len);
+        if (grown == NULL) {
+            return NULL;
+        }
+        normalized = grown;
+        normalized_capacity = len;
+    }
+    size_t out = 0;                                   // Next byte to write
+    int pending_space = 0;                            // Saw whitespace since the last word
+    for (const char *c = author; *c; c++) {
+        if (isspace((unsigned char) *c)) {
+            pending_space = out > 0;                  // Ignore leading whitespace
+        } else {
+            if (pending_space) {
+                normalized[out++] = ' ';              // Collapse a run of whitespace to one space
+                pending_space = 0;
+            }
+            normalized[out++] = (char) tolower((unsigned char) *c);
+        }
+    }
+    normalized[out] = '\0';                           // Trailing whitespace is dropped
+    return normalized;
+}
+
+// FNV-1a hash of a normalized name
+static unsigned int hash_author(const char *key) {
+    unsigned int h = 2166136261u;
+    for (; *key; key++) {
+        h = (h ^ (unsigned char) *key) * 16777619u;
+    }
+    return h;
+}
+
+// Grow the table and re-insert every posting list
+static int author_table_resize(int new_capacity) {
+    AuthorPosting *table = calloc((size_t) new_capacity, sizeof(AuthorPosting));
+    if (table == NULL) {
+        return 0;
+    }
+    AuthorPosting *old_table = author_table;
+    int old_capacity = author_capacity;
+    author_table = table;
+    author_capacity = new_capacity;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_table[i].key != NULL) {
+            int pos = (int) (old_table[i].hash & (unsigned int) (author_capacity - 1));
+            while (author_table[pos].key != NULL) {   // Linear probing
+                pos = (pos + 1) & (author_capacity - 1);
+            }
+            author_table[pos] = old_table[i];
+        }
+    }
+    free(old_table);
+    return 1;
+}
+
+// Find the posting list of a normalized name, optionally creating an empty one
+static AuthorPosting* author_lookup(const char *key, int create) {
+    if (create && (author_used + 1) * 2 > author_capacity) { // Keep the table at most half full
+        int new_capacity = author_capacity ? author_capacity * 2 : AUTHOR_TABLE_MIN_CAPACITY;
+        if (!author_table_resize(new_capacity) && author_used + 1 >= author_capacity) {
+            return NULL;
+        }
+    }
+    if (author_capacity == 0) {                       // Nothing indexed yet
+        return NULL;
+    }
+    unsigned int hash = hash_author(key);
+    int pos = (int) (hash & (unsigned int) (author_capacity - 1));
+    while (author_table[pos].key != NULL) {           // Walk the probe sequence
+        if (author_table[pos].hash == hash && strcmp(author_table[pos].key, key) == 0) {
+            return &author_table[pos];                // Found the author
+        }
+        pos = (pos + 1) & (author_capacity - 1);
+    }
+    if (!create) {
+        return NULL;
+    }
+    size_t len = strlen(key) + 1;
+    char *copy = malloc(len);                         // The table owns its keys
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, key, len);
+    author_table[pos].key = copy;
+    author_table[pos].hash = hash;
+    author_used++;
+    return &author_table[pos];
+}
+
+// Function to index a book under its author
+void author_index_add(int id, const char *author) {
+    const char *key = normalize_author(author);
+    AuthorPosting *posting = key ? author_lookup(key, 1) : NULL;
+    if (posting != NULL) {                            // (out of memory: the book stays unindexed)
+        id_list_insert_sorted(&posting->ids, id);
+    }
+}
+
+// Function to remove a book from its author's posting list
+void author_index_remove(int id, const char *author) {
+    const char *key = normalize_author(author);
+    AuthorPosting *posting = key ? author_lookup(key, 0) : NULL;
+    if (posting != NULL) {
+        id_list_remove_sorted(&posting->ids, id);     // The (possibly empty) entry is kept for reuse
+    }
+}
+
+// Function to remove every entry from the index
+void author_index_clear() {
+    for (int i = 0; i < author_capacity; i++) {
+        if (author_table[i].key != NULL) {
+            free(author_table[i].key);
+            id_list_free(&author_table[i].ids);
+            author_table[i].key = NULL;
+        }
+    }
+    author_used = 0;
+}
+
+// Function to get the books of one author (name compared after normalization)
+// Returns NULL if no book by that author is indexed.
+const IdList* author_index_lookup(const char *author) {
+    const char *key = normalize_author(author);
+    AuthorPosting *posting = key ? author_lookup(key, 0) : NULL;
+    return (posting != NULL && posting->ids.count > 0) ? &posting->ids : NULL;
+}
+
+// ==================== year_index.h ====================
+#ifndef YEAR_INDEX_H           // Include guard to prevent multiple inclusions
+#define YEAR_INDEX_H           // Define the include guard macro
+
+#include "book.h"              // Include IdList definition
+
+// Sorted index on publication year.
+// Distinct years are kept in ascending order, each with the sorted IDs of its
+// books, so a range query is two binary searches plus the books it returns.
+void year_index_add(int id, int year);                 // Index a book under its year
+void year_index_remove(int id, int year);              // Un-index a book
+void year_index_clear();                               // Remove every entry
+int year_index_range(int from, int to, IdList *out);   // IDs (sorted) of books published in [from, to]; 0 if out of memory
+int year_index_count_range(int from, int to);          // Number of books published in [from, to]
+
+#endif // YEAR_INDEX_H         // End of include guard
+
+// ==================== year_index.c ====================
+#include <stdlib.h>            // For realloc function
+#include <string.h>            // For memmove function
+
+#include "year_index.h"        // Include our index declarations
+
+// All books published in one year
+typedef struct {
+    int year;                  // The publication year
+    IdList ids;                // Sorted IDs of the books from that year
+} YearBucket;
+
+static YearBucket *year_buckets = NULL; // One bucket per distinct year, ascending by year
+static int year_bucket_count = 0;       // Number of buckets in use
+static int year_bucket_capacity = 0;    // Number of buckets allocated
+
+// Position of the first bucket whose year is >= year (binary search)
+static int lower_bound_year(int year) {
+    int lo = 0, hi = year_bucket_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (year_buckets[mid].year < year) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// Position of the first bucket whose year is > year (no year + 1, which overflows at INT_MAX)
+static int upper_bound_year(int year) {
+    int lo = 0, hi = year_bucket_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (year_buckets[mid].year <= year) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// Function to index a book under its publication year
+void year_index_add(int id, int year) {
+    int pos = lower_bound_year(year);                 // Where the year is, or belongs
+    if (pos == year_bucket_count || year_buckets[pos].year != year) { // First book of this year
+        if (year_bucket_count == year_bucket_capacity) { // Grow the bucket array
+            int new_capacity = year_bucket_capacity ? year_bucket_capacity * 2 : 64;
+            YearBucket *grown = realloc(year_buckets, (size_t) new_capacity * sizeof(YearBucket));
+            if (grown == NULL) {                      // Out of memory: the book stays unindexed
+                return;
+            }
+            year_buckets = grown;
+            year_bucket_capacity = new_capacity;
+        }
+        memmove(&year_buckets[pos + 1], &year_buckets[pos], // Open a gap to keep years sorted
+                (size_t) (year_bucket_count - pos) * sizeof(YearBucket));
+        year_buckets[pos].year = year;
+        year_buckets[pos].ids = (IdList) {0};
+        year_bucket_count++;
+    }
+    id_list_insert_sorted(&year_buckets[pos].ids, id); // Usually an append: new IDs are the largest
+}
+
+// Function to remove a book from its year's bucket
+void year_index_remove(int id, int year) {
+    int pos = lower_bound_year(year);
+    if (pos < year_bucket_count && year_buckets[pos].year == year) {
+        id_list_remove_sorted(&year_buckets[pos].ids, id); // An emptied bucket is kept for reuse
+    }
+}
+
+// Function to remove every entry from the index
+void year_index_clear() {
+    for (int b = 0; b < year_bucket_count; b++) {
+        id_list_free(&year_buckets[b].ids);
+    }
+    year_bucket_count = 0;
+}
+
+// Function to collect the books published between two years (inclusive)
+// The result is sorted by ID, ready to intersect with other result sets.
+// Returns 0 (with the books gathered so far) if out of memory.
+int year_index_range(int from, int to, IdList *out) {
+    out->count = 0;                                   // Start with no results
+    int end = upper_bound_year(to);                   // First bucket past the range
+    int buckets = 0;                                  // Buckets that contributed IDs
+    int ok = 1;
+    for (int b = lower_bound_year(from); b < end && ok; b++) {
+        for (int i = 0; i < year_buckets[b].ids.count && ok; i++) {
+            ok = id_list_push(out, year_buckets[b].ids.ids[i]);
+        }
+        buckets += year_buckets[b].ids.count > 0;
+    }
+    if (buckets > 1) {                                // Each bucket is sorted, but not across buckets
+        id_list_sort(out);
+    }
+    return ok;
+}
+
+// Function to count the books published between two years (inclusive)
+// Costs one binary search plus one step per distinct year in the range.
+int year_index_count_range(int from, int to) {
+    int count = 0;
+    int end = upper_bound_year(to);
+    for (int b = lower_bound_year(from); b < end; b++) {
+        count += year_buckets[b].ids.count;
+    }
+    return count;
+}
+
+// ==================== text_search.h ====================
+#ifndef TEXT_SEARCH_H          // Include guard to prevent multiple inclusions
+#define TEXT_SEARCH_H          // Define the include guard macro
+
+// Case-insensitive (ASCII) substring search without temporary buffers.
+// Uses AVX2 or SSE2 when the compiler targets them, and plain C otherwise.
+const char* find_ignore_case(const char *text, const char *pattern); // First match of pattern in text, or NULL
+const char* find_ignore_case_scalar(const char *text, const char *pattern); // Same, never vectorized (for benchmarks)
+
+#endif // TEXT_SEARCH_H        // End of include guard
+
+// ==================== text_search.c ====================
+#include <string.h>            // For strlen function
+#include <stddef.h>            // For size_t type
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>         // For SSE2/AVX2 intrinsics
+#endif
+
+#include "text_search.h"       // Include our search declarations
+
+// Fold one ASCII letter to lowercase (other bytes are left alone)
+static inline unsigned char fold_byte(unsigned char c) {
+    return (unsigned char) ((unsigned int) (c - 'A') < 26u ? c + ('a' - 'A') : c);
+}
+
+// Compare len bytes of a and b, ignoring ASCII case
+static int equal_ignore_case(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (fold_byte((unsigned char) a[i]) != fold_byte((unsigned char) b[i])) {
+            return 0;                                 // First difference: not equal
+        }
+    }
+    return 1;
+}
+
+// Check for a full match at text[i], knowing the first and last characters already match
+static int match_at(const char *text, size_t i, const char *pattern, size_t m) {
+    return m <= 2 || equal_ignore_case(text + i + 1, pattern + 1, m - 2); // Only the middle is left
+}
+
+// Plain C search over positions [start, n - m]
+static const char* find_scalar_from(const char *text, size_t n, const char *pattern, size_t m, size_t start) {
+    unsigned char first = fold_byte((unsigned char) pattern[0]); // Folded first character of the pattern
+    unsigned char last = fold_byte((unsigned char) pattern[m - 1]); // Folded last character of the pattern
+    for (size_t i = start; i + m <= n; i++) {
+        if (fold_byte((unsigned char) text[i]) == first &&
+            fold_byte((unsigned char) text[i + m - 1]) == last &&
+            match_at(text, i, pattern, m)) {
+            return text + i;                          // Found a match
+        }
+    }
+    return NULL;
+}
+
+#if defined(__AVX2__)
+// Fold 32 bytes to lowercase: add 0x20 to every byte in 'A'..'Z'
+static inline __m256i fold_256(__m256i x) {
+    __m256i shifted = _mm256_xor_si256(_mm256_sub_epi8(x, _mm256_set1_epi8('A')), _mm256_set1_epi8((char) 0x80));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (0x80 + 26)), shifted); // Unsigned (x - 'A') < 26
+    return _mm256_add_epi8(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+#elif defined(__SSE2__)
+// Fold 16 bytes to lowercase: add 0x20 to every byte in 'A'..'Z'
+static inline __m128i fold_128(__m128i x) {
+    __m128i shifted = _mm_xor_si128(_mm_sub_epi8(x, _mm_set1_epi8('A')), _mm_set1_epi8((char) 0x80));
+    __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (0x80 + 26))); // Unsigned (x - 'A') < 26
+    return _mm_add_epi8(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+// Function to find the first case-insensitive occurrence of pattern in text
+// Compares the pattern's first and last characters against a whole vector of
+// starting positions at once, and only checks the middle where both match.
+const char* find_ignore_case(const char *text, const char *pattern) {
+    size_t m = strlen(pattern);                       // Pattern length
+    if (m == 0) {                                     // Empty pattern matches at the start
+        return text;
+    }
+    size_t n = strlen(text);                          // Text length (loads never go past it)
+    if (m > n) {                                      // Pattern longer than the text
+        return NULL;
+    }
+    size_t i = 0;                                     // Next starting position to check
+#if defined(__AVX2__)
+    __m256i first = _mm256_set1_epi8((char) fold_byte((unsigned char) pattern[0]));
+    __m256i last = _mm256_set1_epi8((char) fold_byte((unsigned char) pattern[m - 1]));
+    for (; i + m - 1 + 32 <= n; i += 32) {            // 32 starting positions per step
+        __m256i head = fold_256(_mm256_loadu_si256((const __m256i *) (text + i)));
+        __m256i tail = fold_256(_mm256_loadu_si256((const __m256i *) (text + i + m - 1)));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+        while (mask != 0) {                           // Check each position where both ends match
+            size_t pos = i + (size_t) __builtin_ctz(mask);
+            if (match_at(text, pos, pattern, m)) {
+                return text + pos;
+            }
+            mask &= mask - 1;                         // Clear the lowest set bit
+        }
+    }
+#elif defined(__SSE2__)
+    __m128i first = _mm_set1_epi8((char) fold_byte((unsigned char) pattern[0]));
+    __m128i last = _mm_set1_epi8((char) fold_byte((unsigned char) pattern[m - 1]));
+    for (; i + m - 1 + 16 <= n; i += 16) {            // 16 starting positions per step
+        __m128i head = fold_128(_mm_loadu_si128((const __m128i *) (text + i)));
+        __m128i tail = fold_128(_mm_loadu_si128((const __m128i *) (text + i + m - 1)));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        while (mask != 0) {                           // Check each position where both ends match
+            size_t pos = i + (size_t) __builtin_ctz(mask);
+            if (match_at(text, pos, pattern, m)) {
+                return text + pos;
+            }
+            mask &= mask - 1;                         // Clear the lowest set bit
+        }
+    }
+#endif
+    return find_scalar_from(text, n, pattern, m, i);  // Remaining positions (or all, without SIMD)
+}
+
+// Function to run the same search with the plain C loop only
+const char* find_ignore_case_scalar(const char *text, const char *pattern) {
+    size_t m = strlen(pattern);
+    if (m == 0) {
+        return text;
+    }
+    size_t n = strlen(text);
+    return m > n ? NULL : find_scalar_from(text, n, pattern, m, 0);
+}
+
+// ==================== query_cache.h ====================
+#ifndef QUERY_CACHE_H          // Include guard to prevent multiple inclusions
+#define QUERY_CACHE_H          // Define the include guard macro
+
+#include "book.h"              // Include IdList definition
+
+// Bounded LRU cache of search results, keyed by the kind of search and the
+// lowercased query. Each entry remembers the catalog generation it was
+// computed at (see get_catalog_generation): once a book is added or removed,
+// older entries stop matching. Only IDs are cached, so the borrowed status
+// is still read live when the results are printed.
+#define QUERY_CACHE_ENTRIES 256        // Queries kept; the least recently used is replaced first
+#define QUERY_CACHE_BUCKETS 512        // Hash chains (a power of two)
+#define QUERY_CACHE_MAX_KEY 128        // Longer queries are not cached (including the null terminator)
+#define QUERY_CACHE_MAX_RESULTS 32768  // Larger result lists are not cached
+
+#define QUERY_TITLE 0                  // search_by_title
+#define QUERY_AUTHOR 1                 // search_by_author
+
+// Copies the cached results of a query into `out`; returns 1 on a hit, 0 otherwise
+int query_cache_get(int kind, const char *query, unsigned long long generation, IdList *out);
+// Remembers the results of a query computed at `generation`
+void query_cache_put(int kind, const char *query, unsigned long long generation, const IdList *results);
+void query_cache_counts(unsigned long long *hits, unsigned long long *misses); // Lookups answered and not answered
+void query_cache_clear();                      // Forget every entry (benchmarks measure cold searches with it)
+
+#endif // QUERY_CACHE_H        // End of include guard
+
+// ==================== query_cache.c ====================
+#include <string.h>            // For strcmp, memcpy functions
+#include <ctype.h>             // For tolower function
+#include <pthread.h>           // For the cache mutex
+
+#include "query_cache.h"       // Include cache declarations
+
+// One cached query. Entries are linked into a hash chain and into the LRU list.
+typedef struct {
+    int kind;                          // QUERY_TITLE or QUERY_AUTHOR
+    char key[QUERY_CACHE_MAX_KEY];     // Lowercased query
+    unsigned int hash;                 // Hash of kind and key
+    unsigned long long generation;     // Catalog generation the results belong to
+    IdList results;                    // Matching IDs (the memory is reused when the entry is replaced)
+    int chain_next;                    // Next entry in the same hash chain plus one (0 = end of chain)
+    int newer;                         // Neighbours in the LRU list, or -1
+    int older;
+} CacheEntry;
+
+#define QUERY_CACHE_NO_GENERATION (~0ULL) // Generation of an entry whose results could not be copied
+
+static CacheEntry entries[QUERY_CACHE_ENTRIES];
+static int entry_count = 0;                    // Entries handed out so far
+static int buckets[QUERY_CACHE_BUCKETS];       // First entry of each chain plus one (0 = empty)
+static int newest = -1;                        // Most recently used entry
+static int oldest = -1;                        // Next entry to replace
+static unsigned long long hits = 0, misses = 0;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER; // Server workers search concurrently
+
+// Lowercase `query` into `key`; returns 0 if it is too long to cache
+static int make_key(const char *query, char *key) {
+    size_t i = 0;
+    for (; query[i] != '\0'; i++) {
+        if (i + 1 >= QUERY_CACHE_MAX_KEY) {
+            return 0;
+        }
+        key[i] = (char) tolower((unsigned char) query[i]);
+    }
+    key[i] = '\0';
+    return 1;
+}
+
+// FNV-1a over the kind and the key
+static unsigned int key_hash(int kind, const char *key) {
+    unsigned int hash = 2166136261u ^ (unsigned int) kind;
+    for (; *key != '\0'; key++) {
+        hash = (hash ^ (unsigned char) *key) * 16777619u;
+    }
+    return hash;
+}
+
+// Entry holding a key, or -1
+static int find_entry(int kind, const char *key, unsigned int hash) {
+    for (int e = buckets[hash & (QUERY_CACHE_BUCKETS - 1)] - 1; e != -1; e = entries[e].chain_next - 1) {
+        if (entries[e].hash == hash && entries[e].kind == kind && strcmp(entries[e].key, key) == 0) {
+            return e;
+        }
+    }
+    return -1;
+}
+
+// Take an entry out of the LRU list
+static void unlink_lru(int e) {
+    if (entries[e].newer != -1) entries[entries[e].newer].older = entries[e].older; else newest = entries[e].older;
+    if (entries[e].older != -1) entries[entries[e].older].newer = entries[e].newer; else oldest = entries[e].newer;
+}
+
+// Put an entry at the front of the LRU list
+static void push_newest(int e) {
+    entries[e].newer = -1;
+    entries[e].older = newest;
+    if (newest != -1) entries[newest].newer = e; else oldest = e;
+    newest = e;
+}
+
+// Put an entry at the back of the LRU list (replaced first)
+static void push_oldest(int e) {
+    entries[e].older = -1;
+    entries[e].newer = oldest;
+    if (oldest != -1) entries[oldest].older = e; else newest = e;
+    oldest = e;
+}
+
+// Take an entry out of its hash chain
+static void unlink_chain(int e) {
+    int *link = &buckets[entries[e].hash & (QUERY_CACHE_BUCKETS - 1)];
+    while (*link - 1 != e) {                   // Find the link that points at the entry
+        link = &entries[*link - 1].chain_next;
+    }
+    *link = entries[e].chain_next;
+}
+
+// Copy a list's IDs into another list; 0 if out of memory
+static int copy_ids(IdList *to, const IdList *from) {
+    to->count = 0;
+    for (int i = 0; i < from->count; i++) {
+        if (!id_list_push(to, from->ids[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int query_cache_get(int kind, const char *query, unsigned long long generation, IdList *out) {
+    char key[QUERY_CACHE_MAX_KEY];
+    if (!make_key(query, key)) {
+        return 0;
+    }
+    unsigned int hash = key_hash(kind, key);
+    pthread_mutex_lock(&cache_lock);
+    int e = find_entry(kind, key, hash);
+    int hit = e != -1 && entries[e].generation == generation; // An older catalog's results do not count
+    if (hit) {
+        unlink_lru(e);                         // Now the most recently used
+        push_newest(e);
+        hit = copy_ids(out, &entries[e].results); // Out of memory: the caller searches instead
+    }
+    if (hit) {
+        hits++;
+    } else {
+        misses++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return hit;
+}
+
+void query_cache_put(int kind, const char *query, unsigned long long generation, const IdList *results) {
+    char key[QUERY_CACHE_MAX_KEY];
+    if (results->count > QUERY_CACHE_MAX_RESULTS || !make_key(query, key)) {
+        return;
+    }
+    unsigned int hash = key_hash(kind, key);
+    pthread_mutex_lock(&cache_lock);
+    int e = find_entry(kind, key, hash);
+    if (e != -1) {                             // Refresh a stale entry in place
+        unlink_lru(e);
+    } else {
+        if (entry_count < QUERY_CACHE_ENTRIES) { // Use a fresh entry while there are any
+            e = entry_count++;
+        } else {                               // Replace the least recently used one
+            e = oldest;
+            unlink_lru(e);
+            unlink_chain(e);
+        }
+        entries[e].kind = kind;
+        memcpy(entries[e].key, key, strlen(key) + 1);
+        entries[e].hash = hash;
+        int *head = &buckets[hash & (QUERY_CACHE_BUCKETS - 1)];
+        entries[e].chain_next = *head;
+        *head = e + 1;
+    }
+    if (copy_ids(&entries[e].results, results)) {
+        entries[e].generation = generation;
+        push_newest(e);
+    } else {                                   // Out of memory: keep the entry, but never as a hit
+        entries[e].generation = QUERY_CACHE_NO_GENERATION;
+        push_oldest(e);
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// Function to forget every entry (their result lists are kept for reuse)
+void query_cache_clear() {
+    pthread_mutex_lock(&cache_lock);
+    memset(buckets, 0, sizeof(buckets));
+    entry_count = 0;
+    newest = -1;
+    oldest = -1;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void query_cache_counts(unsigned long long *hit_count, unsigned long long *miss_count) {
+    pthread_mutex_lock(&cache_lock);
+    *hit_count = hits;
+    *miss_count = misses;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+// ==================== render.h ====================
+#ifndef RENDER_H               // Include guard to prevent multiple inclusions
+#define RENDER_H               // Define the include guard macro
+
+#include <stdio.h>             // For FILE
+#include "book.h"              // Include Book structure definition
+
+// Shared output layer for book listings.
+// Records are formatted by hand into a large buffer that is written out in
+// big blocks, instead of several printf calls per book.
+#define RENDER_HUMAN 0         // Multi-line records for reading on screen
+#define RENDER_COMPACT 1       // One line per book for reading on screen
+#define RENDER_TSV 2           // id, title, author, year, borrowed separated by tabs
+#define RENDER_JSONL 3         // One JSON object per line
+#define RENDER_TEXT 4          // Semicolon text file format (ID;Title;Author;Year;IsBorrowed)
+
+#define RENDER_BUFFER_SIZE (64 * 1024) // Bytes collected before each write
+#define RENDER_PAGE_SIZE 20            // Books per page when paging on a terminal
+
+// One listing being written
+typedef struct {
+    FILE *out;                 // Where the listing goes
+    int format;                // One of the RENDER_ formats
+    long long offset;          // Books to skip before the first one shown
+    long long limit;           // Books to show after the offset (-1 = all)
+    int page_size;             // Books per page before asking to continue (0 = never ask)
+    long long offered;         // Books passed to render_book so far
+    long long shown;           // Books written so far
+    int failed;                // Set once a write fails
+    size_t used;               // Bytes waiting in buffer
+    char buffer[RENDER_BUFFER_SIZE]; // Formatted output not written yet
+} Renderer;
+
+void render_begin(Renderer *r, FILE *out, int format, long long offset, long long limit); // Start a listing
+void render_pause_on_terminal(Renderer *r);       // Ask before each new page if the user is at a terminal
+int render_book(Renderer *r, const Book *book, int is_borrowed); // Add a book; returns 0 once no more are wanted
+int render_end(Renderer *r);                      // Write what is left; returns 0 if any write failed
+int parse_render_format(const char *name);        // "human", "compact", "tsv", "jsonl" or "text"; -1 if unknown
+
+#endif // RENDER_H             // End of include guard
+
+// ==================== render.c ====================
+#include <stdio.h>             // For fwrite, fflush, scanf functions
+#include <string.h>            // For memcpy, strlen, strcmp functions
+#include <unistd.h>            // For isatty function
+
+#include "render.h"            // Include our renderer declarations
+#include "author_dict.h"       // Include interned author names
+
+// Write out the buffered bytes
+static void render_flush(Renderer *r) {
+    if (r->used > 0 && fwrite(r->buffer, 1, r->used, r->out) != r->used) {
+        r->failed = 1;
+    }
+    r->used = 0;
+}
+
+// Append raw bytes, flushing whenever the buffer fills
+static void put_bytes(Renderer *r, const char *data, size_t size) {
+    while (size > 0) {
+        if (r->used == RENDER_BUFFER_SIZE) {
+            render_flush(r);
+        }
+        size_t room = RENDER_BUFFER_SIZE - r->used;
+        size_t n = size < room ? size : room;
+        memcpy(r->buffer + r->used, data, n);
+        r->used += n;
+        data += n;
+        size -= n;
+    }
+}
+
+// Append a null-terminated string as it is
+static void put_string(Renderer *r, const char *text) {
+    put_bytes(r, text, strlen(text));
+}
+
+// Append one character
+static void put_char(Renderer *r, char c) {
+    if (r->used == RENDER_BUFFER_SIZE) {
+        render_flush(r);
+    }
+    r->buffer[r->used++] = c;
+}
+
+// Append an int in decimal (no printf)
+static void put_int(Renderer *r, int value) {
+    char digits[12];                                 // Enough for "-2147483648"
+    int pos = sizeof(digits);
+    unsigned int v = value < 0 ? 0u - (unsigned int) value : (unsigned int) value;
+    do {                                             // Digits come out last to first
+        digits[--pos] = (char) ('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+    put_bytes(r, digits + pos, sizeof(digits) - (size_t) pos);
+}
+
+// Append a string with tabs, newlines and backslashes escaped (TSV field)
+static void put_tsv_string(Renderer *r, const char *text) {
+    const char *run = text;                          // Start of the characters not yet copied
+    for (; *text; text++) {
+        char escape = *text == '\t' ? 't' : *text == '\n' ? 'n' : *text == '\r' ? 'r' : *text == '\\' ? '\\' : 0;
+        if (escape) {
+            put_bytes(r, run, (size_t) (text - run)); // Copy the plain run in one go
+            put_char(r, '\\');
+            put_char(r, escape);
+            run = text + 1;
+        }
+    }
+    put_bytes(r, run, (size_t) (text - run));
+}
+
+// Append a string as a quoted JSON string
+static void put_json_string(Renderer *r, const char *text) {
+    static const char hex[] = "0123456789abcdef";
+    put_char(r, '"');
+    const char *run = text;                          // Start of the characters not yet copied
+    for (; *text; text++) {
+        unsigned char c = (unsigned char) *text;
+        if (c >= 0x20 && c != '"' && c != '\\') {    // Most characters need no escaping
+            continue;
+        }
+        put_bytes(r, run, (size_t) (text - run));
+        put_char(r, '\\');
+        if (c == '"' || c == '\\') {
+            put_char(r, (char) c);
+        } else if (c == '\n') {
+            put_char(r, 'n');
+        } else if (c == '\t') {
+            put_char(r, 't');
+        } else {                                     // Other control characters as \u00XX
+            put_string(r, "u00");
+            put_char(r, hex[c >> 4]);
+            put_char(r, hex[c & 15]);
+        }
+        run = text + 1;
+    }
+    put_bytes(r, run, (size_t) (text - run));
+    put_char(r, '"');
+}
+
+// Function to start a listing
+// `offset` books are skipped, then at most `limit` are written (-1 = no limit).
+void render_begin(Renderer *r, FILE *out, int format, long long offset, long long limit) {
+    r->out = out;
+    r->format = format;
+    r->offset = offset < 0 ? 0 : offset;
+    r->limit = limit;
+    r->page_size = 0;
+    r->offered = 0;
+    r->shown = 0;
+    r->failed = 0;
+    r->used = 0;
+}
+
+// Function to page the listing when a person is reading it
+// On a terminal the first page appears at once and the user is asked before
+// each further page; piped output is written in one go.
+void render_pause_on_terminal(Renderer *r) {
+    if (isatty(fileno(r->out)) && isatty(fileno(stdin))) {
+        r->page_size = RENDER_PAGE_SIZE;
+    }
+}
+
+// Ask whether to show another page; returns 1 to continue
+static int ask_for_next_page(Renderer *r) {
+    render_flush(r);                                 // The page must be visible before asking
+    fprintf(r->out, "-- %lld shown. Next page? (y/n): ", r->shown);
+    fflush(r->out);
+    char answer;
+    if (scanf(" %c", &answer) != 1) {                // Input closed: stop
+        return 0;
+    }
+    return answer == 'y' || answer == 'Y';
+}
+
+// Function to add one book to the listing
+// Returns 1 while more books are wanted, 0 once the limit is reached or the
+// user stops paging (the caller should stop offering books).
+int render_book(Renderer *r, const Book *book, int is_borrowed) {
+    if (r->offered++ < r->offset) {                  // Still skipping
+        return 1;
+    }
+    if (r->limit >= 0 && r->shown >= r->limit) {     // Page is complete
+        return 0;
+    }
+    if (r->page_size > 0 && r->shown > 0 && r->shown % r->page_size == 0 && !ask_for_next_page(r)) {
+        r->limit = r->shown;                         // User has seen enough
+        return 0;
+    }
+    const char *author = author_dict_name(book->author_id); // Interned name of the author
+    switch (r->format) {
+        case RENDER_HUMAN:
+            put_string(r, "ID: ");
+            put_int(r, book->id);
+            put_string(r, "\nTitle: ");
+            put_string(r, book->title);
+            put_string(r, "\nAuthor: ");
+            put_string(r, author);
+            put_string(r, "\nYear: ");
+            put_int(r, book->publication_year);
+            put_string(r, is_borrowed ? "\nStatus: Borrowed\n\n" : "\nStatus: Available\n\n");
+            break;
+        case RENDER_COMPACT:
+            put_string(r, "ID: ");
+            put_int(r, book->id);
+            put_string(r, " | ");
+            put_string(r, book->title);
+            put_string(r, " by ");
+            put_string(r, author);
+            put_string(r, " (");
+            put_int(r, book->publication_year);
+            put_string(r, is_borrowed ? ") [Borrowed]\n" : ")\n");
+            break;
+        case RENDER_TSV:
+            put_int(r, book->id);
+            put_char(r, '\t');
+            put_tsv_string(r, book->title);
+            put_char(r, '\t');
+            put_tsv_string(r, author);
+            put_char(r, '\t');
+            put_int(r, book->publication_year);
+            put_string(r, is_borrowed ? "\t1\n" : "\t0\n");
+            break;
+        case RENDER_JSONL:
+            put_string(r, "{\"id\":");
+            put_int(r, book->id);
+            put_string(r, ",\"title\":");
+            put_json_string(r, book->title);
+            put_string(r, ",\"author\":");
+            put_json_string(r, author);
+            put_string(r, ",\"year\":");
+            put_int(r, book->publication_year);
+            put_string(r, is_borrowed ? ",\"borrowed\":true}\n" : ",\"borrowed\":false}\n");
+            break;
+        default:                                     // RENDER_TEXT
+            put_int(r, book->id);
+            put_char(r, ';');
+            put_string(r, book->title);
+            put_char(r, ';');
+            put_string(r, author);
+            put_char(r, ';');
+            put_int(r, book->publication_year);
+            put_string(r, is_borrowed ? ";1\n" : ";0\n");
+            break;
+    }
+    r->shown++;
+    return 1;
+}
+
+// Function to finish a listing
+int render_end(Renderer *r) {
+    render_flush(r);
+    return !r->failed;
+}
+
+// Function to turn a format name into a RENDER_ format
+int parse_render_format(const char *name) {
+    static const char *names[] = {"human", "compact", "tsv", "jsonl", "text"}; // Indexed by format
+    for (int f = 0; f < (int) (sizeof(names) / sizeof(names[0])); f++) {
+        if (strcmp(name, names[f]) == 0) {
+            return f;
+        }
+    }
+    return -1;
+}
+
+// ==================== stats.h ====================
+#ifndef STATS_H                // Include guard to prevent multiple inclusions
+#define STATS_H                // Define the include guard macro
+
+#include <stdio.h>             // Include FILE
+
+// Timing and counters for the core operations. Each call adds its duration
+// to a histogram with one bucket per power of two nanoseconds, plus the number
+// of results it produced and the number of books or candidates it looked at.
+// Each thread updates its own copy of the counters (no locked instructions),
+// and readers add the copies up, so the counters can stay on in production.
+#define STAT_SEARCH_TITLE 0            // search_by_title
+#define STAT_SEARCH_AUTHOR 1           // search_by_author
+#define STAT_SEARCH_YEARS 2            // search_by_year_range
+#define STAT_FILTER_AUTHOR 3           // filterByAuthor (filtering only, not printing)
+#define STAT_FILTER_YEAR 4             // filterByYear (filtering only, not printing)
+#define STAT_BORROW 5                  // borrow_book
+#define STAT_RETURN 6                  // return_book
+#define STAT_ADD 7                     // add_book
+#define STAT_REMOVE 8                  // remove_book
+#define STAT_LOAD 9                    // bulk_import_books (load_books, importBooks)
+#define STAT_SAVE 10                   // save_books
+#define STAT_SNAPSHOT_LOAD 11          // load_snapshot
+#define STAT_SNAPSHOT_SAVE 12          // save_snapshot
+#define STAT_SEARCH_RANKED 13          // search_ranked
+#define STAT_SCAN 14                   // scan_books (full scans, also inside searches)
+#define STAT_COMPLETE 15               // prefix_complete (autocomplete)
+#define STAT_MERGE 16                  // stream_merge_books (merging a feed)
+#define STAT_EXPORT 17                 // stream_export_books (filtered export)
+#define STAT_OPERATIONS 18             // Number of operations above
+
+#define STATS_BUCKETS 40               // Bucket b counts calls that took [2^(b-1), 2^b) ns; the last also holds longer ones
+#define STATS_DUMP_INTERVAL 60         // Seconds between dumps written by the background thread
+
+unsigned long long stats_now();        // Monotonic clock in nanoseconds (pass to stats_record as `start`)
+// Record one call that began at `start`, produced `results` and examined `scanned` items
+void stats_record(int operation, unsigned long long start, long long results, long long scanned);
+void stats_print(FILE *out);           // Table of every operation (for the Statistics menu entry)
+int stats_dump(const char *filename);  // Write every operation as a JSON line (temporary file, then rename)
+int stats_start_dump(const char *filename, int interval_seconds); // Dump every interval from a background thread
+void stats_stop_dump();                // Stop the background thread, writing one last dump
+
+#endif // STATS_H              // End of include guard
+
+// ==================== stats.c ====================
+#include <stdio.h>             // For fprintf, fopen, rename functions
+#include <stdlib.h>            // For calloc function
+#include <string.h>            // For strncpy function
+#include <time.h>              // For clock_gettime, time functions
+#include <pthread.h>           // For the dump thread
+
+#include "stats.h"             // Include stats declarations
+
+// Counters for one operation (written by one thread, read by any)
+typedef struct {
+    unsigned long long calls;          // Calls recorded
+    unsigned long long total_ns;       // Sum of their durations
+    unsigned long long max_ns;         // Longest call
+    unsigned long long results;        // Sum of results produced
+    unsigned long long scanned;        // Sum of books or candidates examined
+    unsigned long long buckets[STATS_BUCKETS]; // Duration histogram
+} OperationStats;
+
+static const char *operation_names[STAT_OPERATIONS] = { // Names used in the table and the dump
+    "search_title", "search_author", "search_years", "filter_author", "filter_year",
+    "borrow", "return", "add", "remove", "load", "save", "snapshot_load", "snapshot_save", "search_ranked", "scan", "complete",
+    "merge", "export"
+};
+
+// One thread's counters. Shards are never freed, so the counts of threads
+// that have finished (such as server workers) are kept.
+typedef struct StatsShard {
+    OperationStats operations[STAT_OPERATIONS];
+    struct StatsShard *next;           // Next shard in the list of all shards
+} StatsShard;
+
+static StatsShard *shards = NULL;              // Every thread's shard
+static StatsShard fallback_shard;              // Shared by threads whose shard could not be allocated
+static pthread_mutex_t shards_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local StatsShard *thread_shard = NULL;
+
+static pthread_t dump_thread;                  // Background dumper, if started
+static int dump_running = 0;                   // Set while the thread runs
+static int dump_stop = 0;                      // Asks the thread to finish
+static int dump_interval = STATS_DUMP_INTERVAL;
+static char dump_path[1024];                   // File the thread writes
+static pthread_mutex_t dump_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dump_wake = PTHREAD_COND_INITIALIZER;
+
+unsigned long long stats_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + (unsigned long long) ts.tv_nsec;
+}
+
+// The calling thread's shard, created and linked in on first use
+static StatsShard *local_shard() {
+    if (thread_shard == NULL) {
+        StatsShard *shard = calloc(1, sizeof(StatsShard));
+        if (shard == NULL) {
+            thread_shard = &fallback_shard;    // Counts may be lost if threads collide here
+            return thread_shard;
+        }
+        pthread_mutex_lock(&shards_lock);
+        shard->next = shards;
+        shards = shard;
+        pthread_mutex_unlock(&shards_lock);
+        thread_shard = shard;
+    }
+    return thread_shard;
+}
+
+// Add to a counter only this thread writes: a plain load and store, but atomic
+// so that readers never see a torn value
+static void add_counter(unsigned long long *counter, unsigned long long amount) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+void stats_record(int operation, unsigned long long start, long long results, long long scanned) {
+    unsigned long long elapsed = stats_now() - start;
+    OperationStats *op = &local_shard()->operations[operation];
+    int bucket = elapsed == 0 ? 0 : 64 - __builtin_clzll(elapsed); // Position of the highest set bit
+    if (bucket >= STATS_BUCKETS) {
+        bucket = STATS_BUCKETS - 1;
+    }
+    add_counter(&op->calls, 1);
+    add_counter(&op->total_ns, elapsed);
+    add_counter(&op->results, (unsigned long long) results);
+    add_counter(&op->scanned, (unsigned long long) scanned);
+    add_counter(&op->buckets[bucket], 1);
+    if (elapsed > __atomic_load_n(&op->max_ns, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&op->max_ns, elapsed, __ATOMIC_RELAXED);
+    }
+}
+
+// Add one shard's counters for an operation into `total`
+static void add_shard(const OperationStats *op, OperationStats *total) {
+    total->calls += __atomic_load_n(&op->calls, __ATOMIC_RELAXED);
+    total->total_ns += __atomic_load_n(&op->total_ns, __ATOMIC_RELAXED);
+    unsigned long long max = __atomic_load_n(&op->max_ns, __ATOMIC_RELAXED);
+    total->max_ns = max > total->max_ns ? max : total->max_ns;
+    total->results += __atomic_load_n(&op->results, __ATOMIC_RELAXED);
+    total->scanned += __atomic_load_n(&op->scanned, __ATOMIC_RELAXED);
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        total->buckets[b] += __atomic_load_n(&op->buckets[b], __ATOMIC_RELAXED);
+    }
+}
+
+// Sum one operation's counters over every thread (the result is not a single instant)
+static void read_operation(int operation, OperationStats *copy) {
+    memset(copy, 0, sizeof(*copy));
+    pthread_mutex_lock(&shards_lock);
+    for (const StatsShard *shard = shards; shard != NULL; shard = shard->next) {
+        add_shard(&shard->operations[operation], copy);
+    }
+    pthread_mutex_unlock(&shards_lock);
+    add_shard(&fallback_shard.operations[operation], copy);
+}
+
+// Upper bound of the bucket holding the given fraction of calls (within a factor of two)
+static unsigned long long histogram_percentile(const OperationStats *op, double fraction) {
+    unsigned long long total = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) total += op->buckets[b];
+    unsigned long long target = (unsigned long long) (fraction * (double) total + 0.5);
+    unsigned long long seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += op->buckets[b];
+        if (total > 0 && seen >= target) {
+            unsigned long long bound = 1ULL << b;
+            return b == STATS_BUCKETS - 1 || bound > op->max_ns ? op->max_ns : bound; // Never above the slowest call
+        }
+    }
+    return 0;
+}
+
+void stats_print(FILE *out) {
+    fprintf(out, "%-14s %10s %10s %10s %10s %10s %12s %12s\n",
+            "Operation", "Calls", "Mean us", "p50 us", "p99 us", "Max us", "Results", "Scanned");
+    for (int o = 0; o < STAT_OPERATIONS; o++) {
+        OperationStats op;
+        read_operation(o, &op);
+        double mean = op.calls > 0 ? (double) op.total_ns / (double) op.calls : 0.0;
+        fprintf(out, "%-14s %10llu %10.1f %10.1f %10.1f %10.1f %12llu %12llu\n",
+                operation_names[o], op.calls, mean / 1e3,
+                (double) histogram_percentile(&op, 0.50) / 1e3, (double) histogram_percentile(&op, 0.99) / 1e3,
+                (double) op.max_ns / 1e3, op.results, op.scanned);
+    }
+    fprintf(out, "Percentiles are bucket upper bounds (within a factor of two).\n");
+}
+
+int stats_dump(const char *filename) {
+    char temp_name[1040];                      // Written in full, then renamed over the old dump
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", filename);
+    FILE *file = fopen(temp_name, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    long long now = (long long) time(NULL);
+    for (int o = 0; o < STAT_OPERATIONS; o++) {
+        OperationStats op;
+        read_operation(o, &op);
+        fprintf(file, "{\"time\":%lld,\"operation\":\"%s\",\"calls\":%llu,\"total_ns\":%llu,\"max_ns\":%llu,"
+                      "\"p50_ns\":%llu,\"p99_ns\":%llu,\"results\":%llu,\"scanned\":%llu,\"buckets\":[",
+                now, operation_names[o], op.calls, op.total_ns, op.max_ns,
+                histogram_percentile(&op, 0.50), histogram_percentile(&op, 0.99), op.results, op.scanned);
+        int last = STATS_BUCKETS - 1;          // Leave out the empty buckets at the top
+        while (last >= 0 && op.buckets[last] == 0) last--;
+        for (int b = 0; b <= last; b++) {
+            fprintf(file, b == 0 ? "%llu" : ",%llu", op.buckets[b]);
+        }
+        fprintf(file, "]}\n");
+    }
+    int ok = !ferror(file);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(temp_name, filename) != 0) {
+        remove(temp_name);
+        return 0;
+    }
+    return 1;
+}
+
+// Dump thread: write the file every interval until asked to stop
+static void *dump_loop(void *arg) {
+    (void) arg;
+    pthread_mutex_lock(&dump_lock);
+    while (!dump_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += dump_interval;
+        while (!dump_stop && pthread_cond_timedwait(&dump_wake, &dump_lock, &deadline) == 0) {
+        }
+        if (!dump_stop) {
+            stats_dump(dump_path);
+        }
+    }
+    pthread_mutex_unlock(&dump_lock);
+    return NULL;
+}
+
+int stats_start_dump(const char *filename, int interval_seconds) {
+    if (dump_running) {
+        return 1;
+    }
+    strncpy(dump_path, filename, sizeof(dump_path) - 1);
+    dump_interval = interval_seconds > 0 ? interval_seconds : STATS_DUMP_INTERVAL;
+    dump_stop = 0;
+    if (pthread_create(&dump_thread, NULL, dump_loop, NULL) != 0) {
+        return 0;
+    }
+    dump_running = 1;
+    return 1;
+}
+
+void stats_stop_dump() {
+    if (!dump_running) {
+        return;
+    }
+    pthread_mutex_lock(&dump_lock);
+    dump_stop = 1;
+    pthread_cond_signal(&dump_wake);
+    pthread_mutex_unlock(&dump_lock);
+    pthread_join(dump_thread, NULL);
+    dump_running = 0;
+    stats_dump(dump_path);                     // Final numbers, including the save on exit
+}
+
+// ==================== admin.h ====================
+#ifndef ADMIN_H                // Include guard to prevent multiple inclusions
+#define ADMIN_H                // Define the include guard macro
+
+#include <stdio.h>             // Include standard I/O functions
+#include "book.h"              // Include Book structure definition
+
+// Function declarations only - actual implementations are in admin.c
+int find_book_by_id(int id);                           // Find book index by ID
+void addBook();                                         // Add a new book to library
+void removeBook();                                      // Remove a book from library
+void countTotalBooks();                                 // Display book statistics
+void admin_mode();                                      // Admin menu interface
+void view_all_books();                                 // Display every book (from a point-in-time view)
+void view_borrowed_books(const Book books[], int count); // Display only borrowed books in the first `count` slots
+void invalid_choice();                                  // Handle invalid menu choices
+void importBooks();                                     // Replace the library with a text file's books
+void exportBooks();                                     // Write the library to a text file
+void showStatistics();                                  // Display operation timings and counters
+void circulationReport();                               // Display loan figures from the loan ledger
+void mergeBooks();                                      // Add a text file's books that the library does not have
+void exportMatchingBooks();                             // Write the books matching a filter to a text file
+
+// Operations without prompts (used by the menus and by batch mode)
+int add_book(const char *title, const char *author, int year); // Add an available book; returns its new ID, or -1 if out of memory or the text is refused
+const char *book_text_error(const char *title, const char *author); // Why the text file could not hold these, or NULL
+int remove_book(int id);                               // Remove a book by ID; returns 1, or 0 if there is no such book
+
+// Function declarations to get addresses of global variables from admin.c
+Book* get_library_address();                           // Returns pointer to library array
+int* get_book_count_address();                         // Returns pointer to book_count variable
+int* get_next_id_address();                            // Returns pointer to next_id variable
+
+// Functions that change the set of books (keep the ID index and columns in sync)
+Book* append_book(int id, const char *title, const char *author, int year, int is_borrowed); // Add a book at the end, growing the library
+Book* append_book_in_place(int id, const char *title, unsigned int author_id, int year, int is_borrowed); // Same, but keeps the given title and an interned author
+int reserve_books(int count);                          // Make room for `count` more books in one allocation
+void remove_book_at(int slot);                         // Remove the book stored in a slot (leaves a tombstone)
+void clear_library();                                  // Remove every book and free their strings
+
+// Slot map: a removed book leaves a tombstone in its slot instead of shifting
+// the books after it, so every other book keeps its slot. New books reuse
+// tombstoned slots first. Once tombstones pass a quarter of the slots, the
+// live books are slid down over them (compact_library).
+#define COMPACT_MIN_TOMBSTONES 1024                    // Never compact for fewer tombstones than this
+int get_slot_count();                                  // Slots in use, live or tombstoned (scan slots below this)
+int is_slot_live(int slot);                            // 1 if a slot holds a book, 0 if it is a tombstone
+int next_live_slot(int start);                         // First slot >= start holding a book, or -1
+void compact_library();                                // Close the gaps left by removed books
+unsigned long long get_catalog_generation();           // Changes whenever a book is added or removed (for cached results)
+
+// Hot columns: contiguous per-slot data that scans read instead of whole Book records
+const int* get_book_id_column();                       // ID of each slot
+const int* get_book_year_column();                     // Publication year of each slot
+int is_book_borrowed(int slot);                        // 1 if the book in a slot is borrowed, 0 if available
+void set_book_borrowed(int slot, int borrowed);        // Change the borrowed status bit of a slot (no loan is recorded)
+int change_book_borrowed(int slot, int borrowed, unsigned int time); // Atomically flip the status if it differs and record the loan; returns 1 if changed
+int count_borrowed_books();                            // Number of borrowed books (a counter kept by the loan ledger)
+int next_book_with_status(int start, int borrowed);    // First slot >= start with the given status, or -1
+
+#endif                         // End of include guard
+
+// ==================== admin.c ====================
+#include <stdio.h>             // Include for printf, scanf, fgets functions
+#include <stdlib.h>            // Include for realloc function
+#include <string.h>            // Include for strcspn function (string operations)
+#include <ctype.h>             // Include for character type functions (not used here but included)
+#include "book.h"              // Include Book structure and related functions
+#include "admin.h"             // Include admin function declarations
+#include "data_handler.h"      // Include text import/export functions
+#include "render.h"            // Include the shared listing renderer
+#include "journal.h"           // Include change journaling
+#include "id_index.h"          // Include ID -> slot hash index
+#include "title_index.h"       // Include trigram index over titles
+#include "author_index.h"      // Include normalized author index
+#include "author_dict.h"       // Include interned author names
+#include "year_index.h"        // Include sorted publication year index
+#include "prefix_index.h"      // Include the autocomplete indexes
+#include "stats.h"             // Include operation timing
+#include "query_cache.h"       // Include the search result cache (for its counters)
+#include "catalog_view.h"      // Include copy-on-write views (saves and listings)
+#include "loan_ledger.h"       // Include loan events and circulation figures
+#include "scan.h"              // Include ScanQuery (filtered exports)
+#include "user.h"              // Include parse_year_range
+
+#define BITS_PER_WORD 64       // Number of slots tracked by one word of the borrowed bitset
+
+Book *library = NULL;          // Global array to store all books in the library (grows on demand)
+int book_count = 0;           // Global variable tracking number of books currently in library
+int next_id = 1;              // Global variable for generating unique book IDs
+static int library_capacity = 0; // Number of book slots currently allocated (a multiple of 64)
+static int slot_count = 0;       // Slots handed out so far; books and tombstones live below this
+static unsigned long long catalog_generation = 0; // Bumped by every add, remove and clear
+
+// Tombstoned slots waiting to be reused (used as a stack)
+static int *free_slots = NULL;
+static int free_count = 0;       // Slots on the stack
+static int free_capacity = 0;    // Slots the stack has room for
+
+// Hot columns, indexed by slot like library[]. Status reports and filters only
+// touch these small arrays, so many books fit in one cache line.
+static int *book_ids = NULL;   // ID of each book (copy of library[i].id)
+static int *book_years = NULL; // Publication year of each book (copy of library[i].publication_year)
+static unsigned long long *borrowed_bits = NULL; // Bit i is set if the book in slot i is borrowed
+static unsigned long long *live_bits = NULL;     // Bit i is set if slot i holds a book (clear = tombstone)
+
+// Functions to get addresses of global variables - allows other files to access these variables
+Book* get_library_address() {
+    return library;            // Return pointer to the first element of library array
+}
+
+int* get_book_count_address() {
+    return &book_count;        // Return address of book_count variable
+}
+
+int* get_next_id_address() {
+    return &next_id;           // Return address of next_id variable
+}
+
+// Make room for at least `needed` books, doubling the array when it is full
+// The array may move, so callers must re-read get_library_address() afterwards.
+static int ensure_library_capacity(int needed) {
+    if (needed <= library_capacity) {                // Enough slots already
+        return 1;
+    }
+    int new_capacity = library_capacity ? library_capacity : INITIAL_LIBRARY_CAPACITY;
+    while (new_capacity < needed) {                  // Double until the request fits
+        new_capacity *= 2;
+    }
+    catalog_view_before_move(new_capacity);          // Open views stop reading the arrays that move
+    Book *grown = realloc(library, (size_t) new_capacity * sizeof(Book)); // Grow (and maybe move) the array
+    if (grown == NULL) {                             // If allocation failed
+        return 0;                                    // The old array is still valid
+    }
+    library = grown;                                 // Use the grown array
+
+    int *ids = realloc(book_ids, (size_t) new_capacity * sizeof(int)); // Grow the ID column
+    if (ids == NULL) {
+        return 0;
+    }
+    book_ids = ids;
+    int *years = realloc(book_years, (size_t) new_capacity * sizeof(int)); // Grow the year column
+    if (years == NULL) {
+        return 0;
+    }
+    book_years = years;
+
+    int old_words = library_capacity / BITS_PER_WORD; // Grow the borrowed bitset
+    int new_words = new_capacity / BITS_PER_WORD;
+    unsigned long long *bits = realloc(borrowed_bits, (size_t) new_words * sizeof(unsigned long long));
+    if (bits == NULL) {
+        return 0;
+    }
+    memset(bits + old_words, 0, (size_t) (new_words - old_words) * sizeof(unsigned long long)); // New slots start available
+    borrowed_bits = bits;
+    bits = realloc(live_bits, (size_t) new_words * sizeof(unsigned long long)); // Grow the live bitset
+    if (bits == NULL) {
+        return 0;
+    }
+    memset(bits + old_words, 0, (size_t) (new_words - old_words) * sizeof(unsigned long long)); // New slots start empty
+    live_bits = bits;
+
+    library_capacity = new_capacity;                 // Record its size once every array has grown
+    return 1;
+}
+
+// Function to make room for `count` more books up front (used before bulk loads)
+int reserve_books(int count) {
+    return ensure_library_capacity(slot_count + count); // One allocation instead of repeated doubling
+}
+
+// Function to append a book to the library
+// Copies the title into the string store, interns the author and indexes the
+// book by ID. Returns the stored book, or NULL if memory ran out.
+Book* append_book(int id, const char *title, const char *author, int year, int is_borrowed) {
+    const char *stored_title = store_string(title);  // Keep only the characters actually used
+    unsigned int author_id = author_dict_intern(author); // A known author costs no new string
+    if (stored_title == NULL || author_id == AUTHOR_INVALID) { // String store ran out of memory
+        return NULL;
+    }
+    return append_book_in_place(id, stored_title, author_id, year, is_borrowed);
+}
+
+// Function to append a book whose title is already stored somewhere durable
+// (for example a memory-mapped snapshot) and whose author is already interned.
+// The title is used as it is and must stay valid until the library is cleared.
+Book* append_book_in_place(int id, const char *title, unsigned int author_id, int year, int is_borrowed) {
+    int slot;                                        // Slot for the new book
+    if (free_count > 0) {                            // Reuse the most recently freed slot
+        slot = free_slots[--free_count];
+    } else {
+        if (!ensure_library_capacity(slot_count + 1)) { // Grow the array if it is full
+            return NULL;
+        }
+        slot = slot_count++;                         // Take a fresh slot at the end
+    }
+    catalog_view_before_write(slot);                 // Open views keep the slot as it was
+    Book *book = &library[slot];
+    book->title = title;                             // Point at the caller's title
+    book->author_id = author_id;                     // and at the shared author name
+    book->id = id;                                   // Fill in the remaining fields
+    book->publication_year = year;
+    book_ids[slot] = id;                             // Mirror the hot fields into their columns
+    book_years[slot] = year;
+    set_book_borrowed(slot, is_borrowed);
+    ledger_book_added(author_id, year, is_borrowed); // A book arriving on loan counts as on loan
+    live_bits[slot / BITS_PER_WORD] |= 1ULL << (slot % BITS_PER_WORD); // The slot holds a book now
+    id_index_put(id, slot);                          // Index the new book by its ID
+    title_index_add(id, book->title);                // and by the trigrams of its title
+    const char *author = author_dict_name(author_id);
+    trigram_index_add(TRIGRAM_AUTHORS, id, author);  // and of its author (for fuzzy search)
+    author_index_add(id, author);                    // and under its author
+    prefix_index_add(PREFIX_TITLES, id, title);      // and for completing titles and authors
+    prefix_index_add(PREFIX_AUTHORS, id, author);
+    year_index_add(id, year);                        // and under its publication year
+    book_count++;                                    // Increment total book count
+    catalog_generation++;                            // Cached search results are out of date
+    if (id >= next_id) {                             // Never hand out an ID that is already used
+        next_id = id + 1;
+    }
+    return book;
+}
+
+// Function to remove the book stored in a slot
+// The slot becomes a tombstone: no other book moves, so the slots held by
+// the ID index stay valid, and the removal costs the same for any slot.
+void remove_book_at(int slot) {
+    catalog_view_before_write(slot);                 // Open views keep the book
+    id_index_remove(library[slot].id);               // Drop the removed book from the ID index
+    title_index_remove(library[slot].id, library[slot].title); // and from the title index
+    const char *author = author_dict_name(library[slot].author_id);
+    trigram_index_remove(TRIGRAM_AUTHORS, library[slot].id, author); // and from the author trigrams
+    author_index_remove(library[slot].id, author);   // and from the author index
+    prefix_index_remove(PREFIX_TITLES, library[slot].id, library[slot].title); // and from the autocomplete indexes
+    prefix_index_remove(PREFIX_AUTHORS, library[slot].id, author);
+    year_index_remove(library[slot].id, library[slot].publication_year); // and from the year index
+    ledger_book_removed(library[slot].id, library[slot].author_id, library[slot].publication_year,
+                        is_book_borrowed(slot));     // and its loans from the circulation figures
+
+    set_book_borrowed(slot, 0);                      // Tombstones are never borrowed
+    live_bits[slot / BITS_PER_WORD] &= ~(1ULL << (slot % BITS_PER_WORD)); // and are skipped by scans
+    library[slot].id = 0;                            // IDs are positive, so 0 marks the tombstone
+    library[slot].title = "";                        // Its strings stay in the string store
+    library[slot].author_id = AUTHOR_NONE;
+    book_ids[slot] = 0;
+    book_count--;                                    // One book fewer
+    catalog_generation++;                            // Cached search results are out of date
+
+    if (free_count == free_capacity) {               // Grow the free-slot stack
+        int capacity = free_capacity ? free_capacity * 2 : INITIAL_LIBRARY_CAPACITY;
+        int *grown = realloc(free_slots, (size_t) capacity * sizeof(int));
+        if (grown != NULL) {                         // Otherwise the slot waits for compaction
+            free_slots = grown;
+            free_capacity = capacity;
+        }
+    }
+    if (free_count < free_capacity) {
+        free_slots[free_count++] = slot;             // Next new book goes here
+    }
+
+    int tombstones = slot_count - book_count;
+    if (tombstones >= COMPACT_MIN_TOMBSTONES && tombstones > slot_count / 4) { // Scans waste too much time on gaps
+        compact_library();
+    }
+}
+
+// Function to close the gaps left by removed books
+// Live books slide down in slot order, so each moves at most once and the
+// pass is linear; it runs only after a quarter of the slots became
+// tombstones, so removals stay O(1) amortized. Only moved books are
+// re-pointed in the ID index.
+void compact_library() {
+    catalog_view_before_move(library_capacity);      // Open views keep every slot as it was
+    int kept = 0;                                    // Next slot to fill
+    for (int slot = next_live_slot(0); slot != -1; slot = next_live_slot(slot + 1)) {
+        if (slot != kept) {                          // Move the book and its columns down
+            library[kept] = library[slot];
+            book_ids[kept] = book_ids[slot];
+            book_years[kept] = book_years[slot];
+            set_book_borrowed(kept, is_book_borrowed(slot));
+            id_index_put(book_ids[kept], kept);
+        }
+        kept++;
+    }
+    int words = (slot_count + BITS_PER_WORD - 1) / BITS_PER_WORD; // Words that held any slot
+    for (int w = 0; w < words; w++) {                // Slots below `kept` are live, the rest empty
+        int first = w * BITS_PER_WORD;
+        unsigned long long live = kept >= first + BITS_PER_WORD ? ~0ULL :
+                                  kept > first ? (1ULL << (kept - first)) - 1 : 0;
+        live_bits[w] = live;
+        borrowed_bits[w] &= live;
+    }
+    slot_count = kept;
+    free_count = 0;                                  // No tombstones left to reuse
+}
+
+// Function to remove every book from the library
+void clear_library() {
+    catalog_view_wait_closed();                      // Views point at the strings freed below
+    if (borrowed_bits != NULL) {                     // Every slot becomes available and empty again
+        memset(borrowed_bits, 0, (size_t) (library_capacity / BITS_PER_WORD) * sizeof(unsigned long long));
+        memset(live_bits, 0, (size_t) (library_capacity / BITS_PER_WORD) * sizeof(unsigned long long));
+    }
+    book_count = 0;                                  // No books left
+    slot_count = 0;
+    free_count = 0;
+    catalog_generation++;                            // Cached search results are out of date
+    id_index_clear();                                // Nothing to look up
+    title_index_clear();
+    trigram_index_clear(TRIGRAM_AUTHORS);
+    author_index_clear();
+    year_index_clear();
+    prefix_index_clear();
+    ledger_clear();                                  // Loans of the old books no longer apply
+    author_dict_clear();                             // Forget every author name
+    release_strings();                               // Free all titles and authors at once
+}
+
+const int* get_book_id_column() {
+    return book_ids;           // Return the ID column
+}
+
+const int* get_book_year_column() {
+    return book_years;         // Return the publication year column
+}
+
+// Function to check the borrowed status of a slot
+int is_book_borrowed(int slot) {
+    unsigned long long word = __atomic_load_n(&borrowed_bits[slot / BITS_PER_WORD], __ATOMIC_RELAXED); // May change concurrently
+    return (int) ((word >> (slot % BITS_PER_WORD)) & 1); // Read the slot's bit
+}
+
+// Function to set or clear the borrowed status of a slot
+void set_book_borrowed(int slot, int borrowed) {
+    catalog_view_before_write(slot);                 // Open views keep the old status
+    unsigned long long mask = 1ULL << (slot % BITS_PER_WORD); // The slot's bit inside its word
+    if (borrowed) {
+        borrowed_bits[slot / BITS_PER_WORD] |= mask;  // Mark as borrowed
+    } else {
+        borrowed_bits[slot / BITS_PER_WORD] &= ~mask; // Mark as available
+    }
+}
+
+// Function to flip the borrowed status of a slot only if it is not already set that way
+// The bitset word is updated with an atomic compare-and-swap, so threads that
+// share the library under a read lock can never both borrow the same book.
+// A change is recorded in the loan ledger at `time` (seconds since the epoch).
+// Returns 1 if this call changed the status, 0 if it already had it.
+int change_book_borrowed(int slot, int borrowed, unsigned int time) {
+    catalog_view_before_write(slot);                 // Open views keep the old status
+    unsigned long long *word = &borrowed_bits[slot / BITS_PER_WORD]; // Word holding the slot's bit
+    unsigned long long mask = 1ULL << (slot % BITS_PER_WORD);
+    unsigned long long old = __atomic_load_n(word, __ATOMIC_RELAXED);
+    do {
+        if (((old & mask) != 0) == (borrowed != 0)) { // Someone else got there first
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(word, &old, borrowed ? old | mask : old & ~mask, 1,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)); // Retry if a neighbour's bit changed
+    ledger_record(library[slot].id, library[slot].author_id, library[slot].publication_year, borrowed, time);
+    return 1;
+}
+
+// Function to count borrowed books
+// The ledger counts books as they go on loan, come back, arrive or leave, so this is O(1).
+int count_borrowed_books() {
+    return ledger_on_loan();
+}
+
+#define SCAN_AVAILABLE 0       // Live slots whose book is available
+#define SCAN_BORROWED 1        // Slots whose book is borrowed
+#define SCAN_LIVE 2            // Every live slot
+
+// Bits of word `w` that match a scan
+static unsigned long long scan_word(int w, int scan) {
+    switch (scan) {
+        case SCAN_AVAILABLE: return live_bits[w] & ~borrowed_bits[w];
+        case SCAN_BORROWED: return borrowed_bits[w];
+        default: return live_bits[w];
+    }
+}
+
+// First slot >= start matching a scan, skipping 64 non-matching slots per step
+static int next_slot(int start, int scan) {
+    if (start >= slot_count) {                       // Past the last slot
+        return -1;
+    }
+    int words = (slot_count + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    int w = start / BITS_PER_WORD;                   // Word containing the start slot
+    unsigned long long word = scan_word(w, scan) & (~0ULL << (start % BITS_PER_WORD)); // Ignore slots before start
+    while (word == 0) {                              // No match in this word
+        if (++w >= words) {
+            return -1;
+        }
+        word = scan_word(w, scan);
+    }
+    return w * BITS_PER_WORD + __builtin_ctzll(word); // Position of the lowest matching bit
+}
+
+// Function to find the next slot (starting at `start`) whose status matches `borrowed`
+// Tombstones are skipped; returns -1 when there are no more.
+int next_book_with_status(int start, int borrowed) {
+    return next_slot(start, borrowed ? SCAN_BORROWED : SCAN_AVAILABLE);
+}
+
+// Function to find the next slot (starting at `start`) that holds a book
+int next_live_slot(int start) {
+    return next_slot(start, SCAN_LIVE);
+}
+
+int is_slot_live(int slot) {
+    return (int) ((live_bits[slot / BITS_PER_WORD] >> (slot % BITS_PER_WORD)) & 1);
+}
+
+int get_slot_count() {
+    return slot_count;
+}
+
+unsigned long long get_catalog_generation() {
+    return catalog_generation;
+}
+
+// Function to find book by ID (without pointers)
+// Uses the ID hash index, so the cost does not depend on the number of books.
+int find_book_by_id(int id) {
+    return id_index_get(id);                         // Return the index of the found book, or -1 if not found
+}
+
+// Function to check that a title and author can be saved as a text line
+// A title may contain ';' (the importer takes the other fields from the
+// right), an author may not, and neither may break the line.
+// Returns NULL if they are fine, or what is wrong.
+const char *book_text_error(const char *title, const char *author) {
+    if (strpbrk(title, "\r\n") != NULL) {
+        return "title must not contain a line break";
+    }
+    if (strpbrk(author, ";\r\n") != NULL) {
+        return "author must not contain ';' or a line break";
+    }
+    return NULL;
+}
+
+// Function to add an available book under the next free ID
+// Returns the new ID, or -1 if memory ran out or book_text_error() refuses the text.
+int add_book(const char *title, const char *author, int year) {
+    if (book_text_error(title, author) != NULL) {    // The text file could not hold it
+        return -1;
+    }
+    unsigned long long start = stats_now();          // Time the call
+    Book *book = append_book(next_id, title, author, year, 0); // Store the book as available (not borrowed)
+    stats_record(STAT_ADD, start, book != NULL, 0);
+    return book ? book->id : -1;
+}
+
+// Function to remove a book by ID
+// Returns 1 if it was removed, 0 if no book has that ID.
+int remove_book(int id) {
+    unsigned long long start = stats_now();          // Time the call
+    int index = find_book_by_id(id);                 // Find the book's slot
+    if (index != -1) {
+        remove_book_at(index);                       // Tombstone its slot
+    }
+    stats_record(STAT_REMOVE, start, index != -1, 0);
+    return index != -1;
+}
+
+// Function to add a book
+void addBook() {
+    char title[MAX_TITLE_LEN];                      // Buffer for the title being typed
+    char author[MAX_AUTHOR_LEN];                    // Buffer for the author being typed
+    int year;                                       // Publication year being typed
+
+    printf("\n Add New Book \n");                   // Display section header
+    
+    clear_input_buffer();                           // Clear any leftover input from previous scanf
+    
+    printf("Enter the book title: ");               // Prompt user for title
+    fgets(title, sizeof(title), stdin);             // Read title including spaces
+    title[strcspn(title, "\n")] = 0;                // Remove newline character
+    
+    printf("Enter author name: ");                  // Prompt user for author
+    fgets(author, sizeof(author), stdin);           // Read author name including spaces
+    author[strcspn(author, "\n")] = 0;              // Remove newline character
+    
+    printf("Enter publication year: ");             // Prompt user for year
+    scanf("%d", &year);                             // Read publication year as integer
+
+    const char *error = book_text_error(title, author); // Would the book survive a save and reload?
+    if (error != NULL) {
+        printf("Book not added: %s.\n", error);     // Display error message
+        return;                                     // Exit function early
+    }
+    int id = add_book(title, author, year);         // Store the book as available (not borrowed)
+    if (id == -1) {                                 // If the library could not grow
+        printf("Not enough memory to add the book.\n"); // Display error message
+        return;                                     // Exit function early
+    }
+    journal_log_add(id, title, author, year);       // Record the change
+
+    printf("Book added successfully! (ID: %d)\n", id); // Confirm addition with ID
+}
+
+// Function to remove books
+void removeBook() {
+    if (book_count == 0) {                          // Check if library is empty
+        printf("No books in this library to remove.\n"); // Display message
+        return;                                      // Exit function early
+    }
+    
+    int id;                                         // Variable to store book ID to remove
+    printf("\n Remove Book\n");                    // Display section header
+    printf("Enter book ID to remove: ");           // Prompt for book ID
+    scanf("%d", &id);                              // Read book ID
+
+    int index = find_book_by_id(id);               // Find the book's index in array
+    if (index == -1) {                             // If book not found
+        printf("Book with ID %d not found.\n", id); // Display error message
+        return;                                     // Exit function
+    }
+    printf("Book was found: \"%s\" by %s\n", library[index].title, author_dict_name(library[index].author_id)); // Show found book
+
+    printf("Are you sure you wanna remove this book? (y/n): "); // Confirmation prompt
+    char confirm;                                   // Variable to store user's confirmation
+    scanf(" %c", &confirm);                        // Read confirmation (space before %c to skip whitespace)
+
+    if (confirm == 'y' || confirm == 'Y') {        // If user confirms removal
+        remove_book(id);                            // Remove it (its slot becomes a tombstone)
+        journal_log_remove(id);                     // Record the change
+        printf("Book with ID %d removed successfully.\n", id); // Confirm removal
+    } else {                                        // If user cancels
+        printf("Book removal canceled.\n");        // Display cancellation message
+    }
+}
+
+// Function to read a file name typed by the user
+static void read_file_name(const char *prompt, char *name, int size) {
+    printf("%s", prompt);                           // Prompt for the file name
+    clear_input_buffer();                           // Clear any leftover input from previous scanf
+    fgets(name, size, stdin);                       // Read the name including spaces
+    name[strcspn(name, "\n")] = 0;                  // Remove newline character
+}
+
+// Function to import books from a semicolon-separated text file
+void importBooks() {
+    char filename[256];                             // Name of the file to import
+    read_file_name("Enter text file to import (replaces the library): ", filename, sizeof(filename));
+    ImportStats stats;                              // Counts reported by the import
+    if (bulk_import_books(filename, 1, &stats)) {   // Replace the library with the file's books
+        journal_checkpoint();                       // Start the journal over from the imported library
+        printf("Imported %lld books from %s (%lld lines, %lld skipped).\n", // Confirm import
+               stats.imported, filename, stats.lines, stats.errors);
+    } else {
+        printf("Could not import %s.\n", filename); // Display error message
+    }
+}
+
+// Function to export the library to a semicolon-separated text file
+void exportBooks() {
+    char filename[256];                             // Name of the file to write
+    read_file_name("Enter text file to export to: ", filename, sizeof(filename));
+    if (save_books(filename)) {                     // Write every book
+        printf("Exported %d books to %s.\n", book_count, filename); // Confirm export
+    }
+}
+
+// Progress line for merges and exports, rewritten in place
+static void print_stream_progress(const StreamProgress *progress, void *context) {
+    const char *what = context;                     // "merged" or "exported"
+    int percent = progress->total > 0 ? (int) (progress->done * 100 / progress->total) : 100;
+    printf("\r%3d%% done, %lld books %s", percent, progress->books, what);
+    fflush(stdout);
+}
+
+// Function to merge a text file into the library, skipping books it already has
+void mergeBooks() {
+    char filename[256];                             // Name of the feed to merge
+    read_file_name("Enter text file to merge into the library: ", filename, sizeof(filename));
+    ImportStats stats;                              // Counts reported by the merge
+    int ok = stream_merge_books(filename, &stats, print_stream_progress, "merged");
+    printf("\n");                                  // End the progress line
+    if (ok) {
+        journal_checkpoint();                       // Start the journal over from the merged library
+        printf("Merged %lld books from %s (%lld lines, %lld duplicates, %lld skipped).\n", // Confirm merge
+               stats.imported, filename, stats.lines, stats.duplicates, stats.errors);
+    } else {
+        printf("Could not merge %s (%lld books were added).\n", filename, stats.imported); // Display error message
+        if (stats.imported > 0) {
+            journal_checkpoint();                   // Keep the books that were added
+        }
+    }
+}
+
+// Function to export the books matching a filter to a text file
+void exportMatchingBooks() {
+    char title[MAX_TITLE_LEN], author[MAX_AUTHOR_LEN], years[64], status[32];
+    char format[32], filename[256];
+    read_file_name("Title contains (blank for any): ", title, sizeof(title));
+    printf("Author contains (blank for any): ");    // Later prompts follow a full line: nothing to clear
+    fgets(author, sizeof(author), stdin);
+    author[strcspn(author, "\n")] = 0;
+    printf("Years (e.g. 1990-2005, blank for any): ");
+    fgets(years, sizeof(years), stdin);
+    years[strcspn(years, "\n")] = 0;
+    printf("Status (all, borrowed or available): ");
+    fgets(status, sizeof(status), stdin);
+    status[strcspn(status, "\n")] = 0;
+    printf("Format (text, tsv, jsonl, compact or human): ");
+    fgets(format, sizeof(format), stdin);
+    format[strcspn(format, "\n")] = 0;
+    printf("Enter text file to export to: ");
+    fgets(filename, sizeof(filename), stdin);
+    filename[strcspn(filename, "\n")] = 0;
+
+    ScanQuery query;                                // Empty fields match every book
+    scan_query_init(&query);
+    query.title = title;
+    query.author = author;
+    if (years[0] != '\0' && !parse_year_range(years, &query.year_from, &query.year_to)) {
+        printf("Invalid year range.\n");
+        return;
+    }
+    query.status = strcmp(status, "borrowed") == 0 ? 1 : strcmp(status, "available") == 0 ? 0 : SCAN_ANY_STATUS;
+    int render_format = format[0] == '\0' ? RENDER_TEXT : parse_render_format(format);
+    if (render_format == -1) {
+        printf("Unknown format.\n");
+        return;
+    }
+    FILE *file = fopen(filename, "w");              // Open file for writing (clears old content)
+    if (file == NULL) {
+        perror("Error opening file for export");
+        return;
+    }
+    setvbuf(file, NULL, _IOFBF, STREAM_EXPORT_BUFFER); // Large writes to the file
+    long long written = stream_export_books(file, NULL, &query, render_format, print_stream_progress, "exported");
+    printf("\n");                                  // End the progress line
+    if (fclose(file) != 0 || written < 0) {
+        perror("Error writing file");
+        return;
+    }
+    printf("Exported %lld books to %s.\n", written, filename); // Confirm export
+}
+
+// Function to count total books
+void countTotalBooks() {
+    printf("\n Book Count \n");                    // Display section header
+    printf("Total books in library: %d\n", book_count); // Display total count
+
+    int borrowed = count_borrowed_books();         // Counter kept by the loan ledger
+    int available = book_count - borrowed;         // Every other book is available
+
+    printf("Available books: %d\n", available);    // Display available count
+    printf("Borrowed books: %d\n", borrowed);      // Display borrowed count
+}
+
+// Function to display how often each core operation ran and how long it took
+void showStatistics() {
+    printf("\n Statistics \n");                    // Display section header
+    stats_print(stdout);                           // Calls, latency, results and books scanned per operation
+    unsigned long long hits, misses;
+    query_cache_counts(&hits, &misses);            // Searches answered from the cache
+    printf("Query cache: %llu hits, %llu misses\n", hits, misses);
+}
+
+// Function to display circulation figures from the loan ledger
+// Every figure is kept up to date as loans happen, so nothing here scans the catalog.
+void circulationReport() {
+    LoanRank ranks[LEDGER_DEFAULT_RESULTS];        // Top books, then top authors
+    DecadeLoans decades[LEDGER_DECADES];           // Decades with any loan
+    long long events = ledger_event_count();       // Borrows and returns recorded
+    printf("\n Circulation \n");                   // Display section header
+    printf("Loan events recorded: %lld\n", events);
+    printf("Books on loan: %d of %d\n", count_borrowed_books(), book_count);
+
+    int count = ledger_top_books(LEDGER_DEFAULT_RESULTS, ranks);
+    printf("Most borrowed books:\n");
+    for (int i = 0; i < count; i++) {
+        int slot = find_book_by_id((int) ranks[i].key);
+        if (slot == -1) {                          // Removed since the ranking was read
+            continue;
+        }
+        printf("  %d loans: \"%s\" by %s (ID %u)\n", ranks[i].count, library[slot].title,
+               author_dict_name(library[slot].author_id), ranks[i].key);
+    }
+    count = ledger_top_authors(LEDGER_DEFAULT_RESULTS, ranks);
+    printf("Authors with the most books on loan:\n");
+    for (int i = 0; i < count; i++) {
+        int on_loan;
+        long long loans;
+        ledger_author(ranks[i].key, &on_loan, &loans);
+        printf("  %d on loan (%lld loans): %s\n", on_loan, loans, author_dict_name(ranks[i].key));
+    }
+    count = ledger_decades(decades);
+    printf("Loans by decade of publication:\n");
+    for (int i = 0; i < count; i++) {
+        printf("  %ds: %d on loan, %lld loans\n", decades[i].first_year, decades[i].on_loan, decades[i].loans);
+    }
+    if (count == 0) {                              // Nothing borrowed yet
+        printf("  No loans yet.\n");
+    }
+}
+
+// View all books
+void view_all_books() {
+    if (book_count == 0) {                         // Check if no books exist
+        printf(" No books in the library.\n");     // Display message
+        return;                                     // Exit function
+    }
+    CatalogView *view = catalog_view_open();       // The catalog as it is now, however long paging takes
+    if (view == NULL) {
+        printf(" Out of memory.\n");
+        return;
+    }
+
+    printf(" All Books in the Library:\n");        // Display section header
+    printf("--------------------------------------------------\n"); // Display separator
+
+    Renderer r;                                    // Buffered output, one page at a time on a terminal
+    render_begin(&r, stdout, RENDER_HUMAN, 0, -1);
+    render_pause_on_terminal(&r);
+    const Book *book;
+    int borrowed;
+    while ((book = catalog_view_next(view, &borrowed)) != NULL) { // Every book, skipping tombstones
+        if (!render_book(&r, book, borrowed)) {    // Stop when the user has seen enough
+            break;
+        }
+    }
+    render_end(&r);
+    catalog_view_close(view);
+}
+
+// View borrowed books
+void view_borrowed_books(const Book books[], int count) {
+    printf(" Borrowed Books:\n");                  // Display section header
+    printf("--------------------------------------------------\n"); // Display separator
+
+    Renderer r;                                    // Buffered output, one page at a time on a terminal
+    render_begin(&r, stdout, RENDER_HUMAN, 0, -1);
+    render_pause_on_terminal(&r);
+    // Jump from borrowed book to borrowed book using the bitset
+    for (int i = next_book_with_status(0, 1); i != -1 && i < count; i = next_book_with_status(i + 1, 1)) {
+        if (!render_book(&r, &books[i], 1)) {      // Stop when the user has seen enough
+            break;
+        }
+    }
+    render_end(&r);
+
+    if (r.shown == 0) {                            // If no borrowed books found
+        printf(" No books are currently borrowed.\n"); // Display message
+    }
+}
+
+// ==================== catalog_view.h ====================
+#ifndef CATALOG_VIEW_H         // Include guard to prevent multiple inclusions
+#define CATALOG_VIEW_H         // Define the include guard macro
+
+#include "book.h"              // Include Book structure
+
+// Point-in-time views of the catalog (copy-on-write).
+// Opening a view costs O(1): it only records an epoch. The slots are grouped
+// into pages of VIEW_PAGE_SLOTS; the first change to a page after a view
+// opened copies the page for the newest view before the change is made.
+// Readers of a view take each page from the oldest copy made at or after
+// their epoch, or from the live library if the page has not changed since, so
+// a save or listing sees one consistent catalog while borrows, returns, adds
+// and removals carry on. Copies are handed to the next older view, or freed,
+// when their view closes.
+#define VIEW_PAGE_SLOTS 1024           // Slots per copy-on-write page
+#define VIEW_PAGE_WORDS (VIEW_PAGE_SLOTS / 64) // Bitset words per page
+
+typedef struct CatalogView CatalogView;
+
+// Opens a view of the catalog as it is now; NULL if out of memory
+// No change may be in progress (the server opens views holding every status lock).
+CatalogView *catalog_view_open();
+void catalog_view_close(CatalogView *view);    // Release a view (any thread)
+const Book *catalog_view_next(CatalogView *view, int *is_borrowed); // Next book of the view in slot order, or NULL at the end
+void catalog_view_rewind(CatalogView *view);   // Start again from the first slot
+int catalog_view_book_count(const CatalogView *view); // Books in the view
+int catalog_view_next_id(const CatalogView *view);    // ID counter when the view opened
+long long catalog_view_loan_count(const CatalogView *view); // Loan ledger events when the view opened
+int catalog_view_ok(const CatalogView *view);  // 0 if a page could not be copied (out of memory): the view may be torn
+
+// Called by admin.c (with no other change in progress for the last two)
+void catalog_view_before_write(int slot);      // A slot's book or status is about to change
+void catalog_view_before_move(int capacity);   // Slots are about to move or be reallocated (for `capacity` slots)
+void catalog_view_wait_closed();               // Wait until no view is open (before strings are freed)
+
+#endif // CATALOG_VIEW_H       // End of include guard
+
+// ==================== catalog_view.c ====================
+#include <stdlib.h>            // For malloc, calloc, realloc, free functions
+#include <string.h>            // For memcpy, memset functions
+#include <pthread.h>           // For mutex and condition variable
+
+#include "catalog_view.h"      // Include our declarations
+#include "admin.h"             // Include the slot map
+#include "loan_ledger.h"       // Include the loan event count
+
+// Copy of one page of slots
+typedef struct {
+    Book books[VIEW_PAGE_SLOTS];
+    unsigned long long live[VIEW_PAGE_WORDS];     // Bit set if the slot held a book
+    unsigned long long borrowed[VIEW_PAGE_WORDS]; // Bit set if that book was borrowed
+} ViewPage;
+
+struct CatalogView {
+    unsigned long long epoch;  // Order in which views were opened
+    int slot_count;            // Slots when the view opened
+    int book_count;            // Books when the view opened
+    int next_id;               // ID counter when the view opened
+    long long loan_count;      // Loan ledger events when the view opened (the ledger only grows)
+    int failed;                // A page could not be copied
+    int page_count;            // Pages covering slot_count
+    ViewPage **pages;          // Pages copied for this view (NULL: look in newer views, then the library)
+    CatalogView *older;        // Previously opened view still open
+    CatalogView *newer;        // Next view opened
+    int slot;                  // Reader position
+    int loaded;                // Page held in `current` (-1 = none)
+    ViewPage current;          // Reader's copy of the page being read
+};
+
+static pthread_mutex_t view_lock = PTHREAD_MUTEX_INITIALIZER; // Guards the chain, copies and live page reads
+static pthread_cond_t views_closed = PTHREAD_COND_INITIALIZER; // Signalled when the last view closes
+static CatalogView *newest = NULL;             // Most recently opened view still open
+static unsigned long long newest_epoch = 0;    // Its epoch (0 = no view), read without the lock
+static unsigned long long epoch_counter = 0;   // Last epoch handed out
+static unsigned long long *page_epochs = NULL; // Per page: newest epoch it has been copied for
+static int page_epoch_count = 0;               // Pages page_epochs covers
+
+// Copy the slots of a page below `slot_count` from the live library (view_lock held)
+static void copy_live_page(int page, int slot_count, ViewPage *out) {
+    const Book *library = get_library_address();
+    int first = page * VIEW_PAGE_SLOTS;
+    int count = slot_count - first;                // Slots of the page in use
+    if (count > VIEW_PAGE_SLOTS) count = VIEW_PAGE_SLOTS;
+    if (count < 0) count = 0;
+    memcpy(out->books, library + first, (size_t) count * sizeof(Book));
+    memset(out->live, 0, sizeof(out->live));
+    memset(out->borrowed, 0, sizeof(out->borrowed));
+    for (int i = 0; i < count; i++) {
+        if (is_slot_live(first + i)) {
+            out->live[i / 64] |= 1ULL << (i % 64);
+            if (is_book_borrowed(first + i)) out->borrowed[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+// Copy of a page as `view` saw it, or NULL if it is unchanged in the library (view_lock held)
+static const ViewPage *preserved_page(const CatalogView *view, int page) {
+    for (; view != NULL; view = view->newer) {     // Oldest copy made after the view opened
+        if (page < view->page_count && view->pages[page] != NULL) {
+            return view->pages[page];
+        }
+    }
+    return NULL;
+}
+
+// Make sure `view` (and every older view) keeps its version of a page (view_lock held)
+static void preserve_page(CatalogView *view, int page) {
+    if (page >= view->page_count || preserved_page(view, page) != NULL) {
+        return;
+    }
+    ViewPage *copy = malloc(sizeof(ViewPage));
+    if (copy == NULL) {                            // The views reading this page would see the change
+        for (CatalogView *v = view; v != NULL; v = v->older) v->failed = 1;
+        return;
+    }
+    copy_live_page(page, get_slot_count(), copy);  // Only writers get here: the slot count is stable
+    view->pages[page] = copy;
+}
+
+CatalogView *catalog_view_open() {
+    CatalogView *view = malloc(sizeof(CatalogView));
+    if (view == NULL) {
+        return NULL;
+    }
+    view->slot_count = get_slot_count();
+    view->book_count = *get_book_count_address();
+    view->next_id = *get_next_id_address();
+    view->loan_count = ledger_event_count();
+    view->failed = 0;
+    view->page_count = (view->slot_count + VIEW_PAGE_SLOTS - 1) / VIEW_PAGE_SLOTS;
+    view->pages = calloc((size_t) (view->page_count > 0 ? view->page_count : 1), sizeof(ViewPage *));
+    if (view->pages == NULL) {
+        free(view);
+        return NULL;
+    }
+    pthread_mutex_lock(&view_lock);
+    if (view->page_count > page_epoch_count) {     // Page table could not grow: changes there are not copied
+        view->failed = 1;
+    }
+    view->epoch = ++epoch_counter;
+    view->older = newest;
+    view->newer = NULL;
+    if (newest != NULL) newest->newer = view;
+    newest = view;
+    __atomic_store_n(&newest_epoch, view->epoch, __ATOMIC_RELEASE); // Writers copy pages from now on
+    pthread_mutex_unlock(&view_lock);
+    catalog_view_rewind(view);
+    return view;
+}
+
+void catalog_view_close(CatalogView *view) {
+    pthread_mutex_lock(&view_lock);
+    CatalogView *older = view->older;
+    for (int p = 0; p < view->page_count; p++) {   // An older view without its own copy saw the same page
+        if (view->pages[p] == NULL) {
+            continue;
+        }
+        if (older != NULL && p < older->page_count && older->pages[p] == NULL) {
+            older->pages[p] = view->pages[p];
+        } else {
+            free(view->pages[p]);
+        }
+    }
+    if (older != NULL) older->newer = view->newer;
+    if (view->newer != NULL) {
+        view->newer->older = older;
+    } else {                                       // Closing the newest view
+        newest = older;
+        __atomic_store_n(&newest_epoch, older != NULL ? older->epoch : 0, __ATOMIC_RELEASE);
+    }
+    if (newest == NULL) {
+        pthread_cond_broadcast(&views_closed);
+    }
+    pthread_mutex_unlock(&view_lock);
+    free(view->pages);
+    free(view);
+}
+
+void catalog_view_rewind(CatalogView *view) {
+    view->slot = 0;
+    view->loaded = -1;
+}
+
+const Book *catalog_view_next(CatalogView *view, int *is_borrowed) {
+    while (view->slot < view->slot_count) {
+        int page = view->slot / VIEW_PAGE_SLOTS;
+        if (page != view->loaded) {                // Fetch the page as it was when the view opened
+            pthread_mutex_lock(&view_lock);
+            const ViewPage *copy = preserved_page(view, page);
+            if (copy != NULL) {
+                memcpy(&view->current, copy, sizeof(ViewPage));
+            } else {
+                copy_live_page(page, view->slot_count, &view->current); // Later slots may be filling up
+            }
+            pthread_mutex_unlock(&view_lock);
+            view->loaded = page;
+        }
+        int i = view->slot++ % VIEW_PAGE_SLOTS;
+        unsigned long long bit = 1ULL << (i % 64);
+        if (view->current.live[i / 64] & bit) {
+            *is_borrowed = (view->current.borrowed[i / 64] & bit) != 0;
+            return &view->current.books[i];
+        }
+    }
+    return NULL;
+}
+
+int catalog_view_book_count(const CatalogView *view) {
+    return view->book_count;
+}
+
+int catalog_view_next_id(const CatalogView *view) {
+    return view->next_id;
+}
+
+long long catalog_view_loan_count(const CatalogView *view) {
+    return view->loan_count;
+}
+
+int catalog_view_ok(const CatalogView *view) {
+    return !view->failed;
+}
+
+void catalog_view_before_write(int slot) {
+    int page = slot / VIEW_PAGE_SLOTS;
+    unsigned long long epoch = __atomic_load_n(&newest_epoch, __ATOMIC_ACQUIRE);
+    if (epoch == 0 || page >= page_epoch_count ||  // No view open, or a page no view covers
+        __atomic_load_n(&page_epochs[page], __ATOMIC_ACQUIRE) >= epoch) { // Already copied for the newest view
+        return;
+    }
+    pthread_mutex_lock(&view_lock);
+    if (newest != NULL && page_epochs[page] < newest->epoch) {
+        preserve_page(newest, page);
+        __atomic_store_n(&page_epochs[page], newest->epoch, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&view_lock);
+}
+
+void catalog_view_before_move(int capacity) {
+    pthread_mutex_lock(&view_lock);
+    for (CatalogView *view = newest; view != NULL; view = view->older) { // Nothing may be read from the library afterwards
+        for (int p = 0; p < view->page_count; p++) {
+            preserve_page(view, p);
+        }
+    }
+    int pages = (capacity + VIEW_PAGE_SLOTS - 1) / VIEW_PAGE_SLOTS;
+    if (pages > page_epoch_count) {                // Cover the grown library
+        unsigned long long *grown = realloc(page_epochs, (size_t) pages * sizeof(unsigned long long));
+        if (grown != NULL) {                       // Otherwise the extra pages are never copied
+            memset(grown + page_epoch_count, 0, (size_t) (pages - page_epoch_count) * sizeof(unsigned long long));
+            page_epochs = grown;
+            page_epoch_count = pages;
+        }
+    }
+    pthread_mutex_unlock(&view_lock);
+}
+
+void catalog_view_wait_closed() {
+    pthread_mutex_lock(&view_lock);
+    while (newest != NULL) {
+        pthread_cond_wait(&views_closed, &view_lock);
+    }
+    pthread_mutex_unlock(&view_lock);
+}
+
+// ==================== scan.h ====================
+#ifndef SCAN_H                 // Include guard to prevent multiple inclusions
+#define SCAN_H                 // Define the include guard macro
+
+#include "book.h"              // Include IdList
+
+// Parallel full scan for queries no index answers (short title terms, partial
+// author names, combined filters). The slots are cut into chunks of
+// SCAN_CHUNK_SLOTS; each thread of a small pool starts with an even share of
+// the chunks and, once done, steals chunks from the back of the others'
+// shares. A chunk is filtered one test at a time over a list of candidate
+// slots, cheapest test first (status bit, year column, author, title), and its
+// matches are gathered in chunk order, so the result is the same whatever
+// thread ran which chunk.
+#define SCAN_CHUNK_SLOTS 4096          // Slots per work item (its ID and year columns fit in L1)
+#define SCAN_MAX_THREADS 64            // Upper bound on scan threads (the caller included)
+#define SCAN_PARALLEL_MIN 65536        // Fewer slots than this are scanned by the caller alone
+#define SCAN_ANY_STATUS -1             // ScanQuery.status: borrowed or not
+
+// What a scan looks for; every condition that is set must hold
+typedef struct {
+    const char *title;         // Text the title contains (any case), or NULL
+    const char *author;        // Text the author contains (any case), or NULL
+    int year_from;             // Earliest publication year (inclusive)
+    int year_to;               // Latest publication year (inclusive)
+    int status;                // 1 borrowed, 0 available, or SCAN_ANY_STATUS
+} ScanQuery;
+
+void scan_query_init(ScanQuery *query);        // A query that matches every book
+// Replaces `out` with the IDs of the matching books, sorted
+// Returns 1, or 0 if memory ran out (`out` is then incomplete).
+int scan_books(const ScanQuery *query, IdList *out);
+// Sets how many threads a scan uses (0 = one per core); returns the previous setting
+int scan_set_threads(int threads);
+
+// A query prepared for testing books one at a time (streaming export).
+// The author condition is decided once per distinct author when prepared;
+// authors interned afterwards are compared by name.
+typedef struct {
+    ScanQuery query;           // Conditions to test
+    unsigned long long *authors; // Authors that match query.author (a bit per ID), or NULL to compare names
+    unsigned int author_count; // IDs covered by `authors`
+} ScanFilter;
+
+void scan_filter_init(ScanFilter *filter, const ScanQuery *query); // Out of memory only makes author tests slower
+int scan_filter_match(const ScanFilter *filter, const Book *book, int is_borrowed); // 1 if the book meets every condition
+void scan_filter_free(ScanFilter *filter);
+
+#endif // SCAN_H               // End of include guard
+
+// ==================== scan.c ====================
+#include <stdlib.h>            // For malloc, free functions
+#include <limits.h>            // For INT_MIN, INT_MAX
+#include <unistd.h>            // For sysconf
+#include <pthread.h>           // For the thread pool
+
+#include "scan.h"              // Include our declarations
+#include "admin.h"             // Include the slot map and hot columns
+#include "author_dict.h"       // Include interned author names
+#include "text_search.h"       // Include find_ignore_case
+#include "stats.h"             // Include operation timing
+
+// One step of a compiled query
+#define TEST_STATUS 0          // Borrowed bit equals `value`
+#define TEST_YEAR 1            // Year column within [from, to]
+#define TEST_AUTHOR 2          // Author contains `text` (a bit per author ID in `authors` when set)
+#define TEST_TITLE 3           // Title contains `text`
+
+typedef struct {
+    int kind;                  // One of the TEST_ kinds
+    int from, to;              // Year range (TEST_YEAR) or status (TEST_STATUS uses `from`)
+    const char *text;          // Substring (TEST_AUTHOR, TEST_TITLE)
+    const unsigned long long *authors; // Authors that contain `text` (TEST_AUTHOR), or NULL to compare names
+} ScanTest;
+
+// A query compiled into the tests it needs, cheapest first
+typedef struct {
+    ScanTest tests[4];
+    int count;
+} ScanProgram;
+
+// One thread's share of the chunks: [next, end), packed as end << 32 | next
+// so the owner (taking from the front) and thieves (taking from the back)
+// agree with one compare-and-swap.
+typedef struct {
+    unsigned long long range;
+    char padding[64 - sizeof(unsigned long long)]; // Keep shares on separate cache lines
+} ScanShare;
+
+// Matches of one chunk: a run of some thread's result list
+typedef struct {
+    int thread;                // Thread that scanned the chunk (-1 until one does)
+    int first;                 // Position of its first match in that thread's list
+    int count;                 // Number of matches
+} ScanChunkResult;
+
+// One scan in progress
+typedef struct {
+    ScanProgram program;
+    const Book *books;         // Library array
+    const int *ids;            // ID column
+    const int *years;          // Year column
+    int slot_count;            // Slots to scan
+    int chunk_count;           // Chunks they are cut into
+    int threads;               // Threads taking part
+    ScanShare shares[SCAN_MAX_THREADS];
+    IdList found[SCAN_MAX_THREADS]; // Matches of each thread, chunk after chunk
+    int out_of_memory[SCAN_MAX_THREADS]; // Set if a thread could not keep all of a chunk's matches
+    ScanChunkResult *chunks;   // Where each chunk's matches are
+} ScanJob;
+
+static int scan_threads = 0;                   // Configured thread count (0 = one per core)
+static pthread_mutex_t scan_busy = PTHREAD_MUTEX_INITIALIZER; // Held while the pool runs a scan
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;   // A job was posted
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;   // A worker finished its part
+static int pool_started = 0;                   // Worker threads running (they never exit)
+static unsigned long long pool_round = 0;      // Incremented for every job posted
+static ScanJob *pool_job = NULL;               // Job being run
+static int pool_working = 0;                   // Workers still on the current job
+
+void scan_query_init(ScanQuery *query) {
+    query->title = NULL;
+    query->author = NULL;
+    query->year_from = INT_MIN;
+    query->year_to = INT_MAX;
+    query->status = SCAN_ANY_STATUS;
+}
+
+int scan_set_threads(int threads) {
+    int previous = scan_threads;
+    scan_threads = threads < 0 ? 0 : threads > SCAN_MAX_THREADS ? SCAN_MAX_THREADS : threads;
+    return previous;
+}
+
+// Turn a query into its tests, cheapest first; unset conditions need no test
+// An author test is decided once per distinct author, up front, when there
+// are fewer authors than slots; each slot then only checks a bit.
+static void compile_query(const ScanQuery *query, int slot_count, ScanProgram *program) {
+    program->count = 0;
+    if (query->status != SCAN_ANY_STATUS) {        // One bit per slot
+        program->tests[program->count++] = (ScanTest) { TEST_STATUS, query->status != 0, 0, NULL, NULL };
+    }
+    if (query->year_from != INT_MIN || query->year_to != INT_MAX) { // One int per slot
+        program->tests[program->count++] = (ScanTest) { TEST_YEAR, query->year_from, query->year_to, NULL, NULL };
+    }
+    if (query->author != NULL && query->author[0] != '\0') { // Authors are shorter than titles
+        const unsigned long long *authors = author_dict_count() < (unsigned int) slot_count ?
+                                            author_dict_matching(query->author) : NULL; // (out of memory: compare names)
+        program->tests[program->count++] = (ScanTest) { TEST_AUTHOR, 0, 0, query->author, authors };
+    }
+    if (query->title != NULL && query->title[0] != '\0') {
+        program->tests[program->count++] = (ScanTest) { TEST_TITLE, 0, 0, query->title, NULL };
+    }
+}
+
+void scan_filter_init(ScanFilter *filter, const ScanQuery *query) {
+    filter->query = *query;
+    filter->authors = NULL;
+    filter->author_count = 0;
+    if (query->author != NULL && query->author[0] != '\0') {
+        filter->author_count = author_dict_count(); // Taken first: the bitset covers at least these
+        filter->authors = author_dict_matching(query->author); // (out of memory: compare names)
+    }
+}
+
+// Tests in the order compile_query runs them, cheapest first
+int scan_filter_match(const ScanFilter *filter, const Book *book, int is_borrowed) {
+    const ScanQuery *query = &filter->query;
+    if (query->status != SCAN_ANY_STATUS && is_borrowed != (query->status != 0)) {
+        return 0;
+    }
+    if (book->publication_year < query->year_from || book->publication_year > query->year_to) {
+        return 0;
+    }
+    if (query->author != NULL && query->author[0] != '\0') {
+        unsigned int a = book->author_id;
+        if (filter->authors != NULL && a < filter->author_count) {
+            if (!((filter->authors[a / 64] >> (a % 64)) & 1)) return 0;
+        } else if (!find_ignore_case(author_dict_name(a), query->author)) {
+            return 0;
+        }
+    }
+    return query->title == NULL || query->title[0] == '\0' || find_ignore_case(book->title, query->title) != NULL;
+}
+
+void scan_filter_free(ScanFilter *filter) {
+    free(filter->authors);
+    filter->authors = NULL;
+}
+
+// Keep the slots of `slots` that pass one test; returns how many are left
+static int run_test(const ScanJob *job, const ScanTest *test, int *slots, int count) {
+    int kept = 0;
+    switch (test->kind) {
+        case TEST_STATUS:
+            for (int s = 0; s < count; s++) {
+                if (is_book_borrowed(slots[s]) == test->from) slots[kept++] = slots[s];
+            }
+            break;
+        case TEST_YEAR:
+            for (int s = 0; s < count; s++) {
+                int year = job->years[slots[s]];
+                if (year >= test->from && year <= test->to) slots[kept++] = slots[s];
+            }
+            break;
+        case TEST_AUTHOR:
+            if (test->authors != NULL) {
+                for (int s = 0; s < count; s++) {
+                    unsigned int a = job->books[slots[s]].author_id;
+                    if ((test->authors[a / 64] >> (a % 64)) & 1) slots[kept++] = slots[s];
+                }
+            } else {
+                for (int s = 0; s < count; s++) {
+                    if (find_ignore_case(author_dict_name(job->books[slots[s]].author_id), test->text)) slots[kept++] = slots[s];
+                }
+            }
+            break;
+        default:                                   // TEST_TITLE
+            for (int s = 0; s < count; s++) {
+                if (find_ignore_case(job->books[slots[s]].title, test->text)) slots[kept++] = slots[s];
+            }
+            break;
+    }
+    return kept;
+}
+
+// Scan one chunk into the thread's result list
+static void scan_chunk(ScanJob *job, int thread, int chunk, int *slots) {
+    int begin = chunk * SCAN_CHUNK_SLOTS;
+    int end = begin + SCAN_CHUNK_SLOTS < job->slot_count ? begin + SCAN_CHUNK_SLOTS : job->slot_count;
+    int count = 0;
+    for (int i = begin; i < end; i++) {            // Live slots (tombstones have ID 0)
+        if (job->ids[i] != 0) slots[count++] = i;
+    }
+    for (int t = 0; t < job->program.count && count > 0; t++) {
+        count = run_test(job, &job->program.tests[t], slots, count);
+    }
+    IdList *found = &job->found[thread];
+    job->chunks[chunk] = (ScanChunkResult) { thread, found->count, count };
+    for (int s = 0; s < count; s++) {
+        if (!id_list_push(found, job->ids[slots[s]])) {
+            job->out_of_memory[thread] = 1;
+            job->chunks[chunk].count = s;
+            return;
+        }
+    }
+}
+
+// Take the next chunk of the thread's own share, or steal one from the back of another's; -1 when none are left
+static int take_chunk(ScanJob *job, int thread) {
+    for (int k = 0; k < job->threads; k++) {
+        int victim = (thread + k) % job->threads; // Own share first
+        unsigned long long *range = &job->shares[victim].range;
+        unsigned long long old = __atomic_load_n(range, __ATOMIC_ACQUIRE);
+        while (1) {
+            unsigned int next = (unsigned int) old, end = (unsigned int) (old >> 32);
+            if (next >= end) {
+                break;                             // Empty: try the next share
+            }
+            unsigned long long taken = k == 0 ? ((unsigned long long) end << 32) | (next + 1) // Front
+                                              : ((unsigned long long) (end - 1) << 32) | next; // Back
+            if (__atomic_compare_exchange_n(range, &old, taken, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return k == 0 ? (int) next : (int) end - 1;
+            }
+        }
+    }
+    return -1;
+}
+
+// Scan chunks until none are left
+static void run_share(ScanJob *job, int thread) {
+    int *slots = malloc(SCAN_CHUNK_SLOTS * sizeof(int)); // Candidate slots of the current chunk
+    if (slots == NULL) {                           // Other threads steal this share; chunks nobody ran fail the scan
+        return;
+    }
+    int chunk;
+    while ((chunk = take_chunk(job, thread)) != -1) {
+        scan_chunk(job, thread, chunk, slots);
+    }
+    free(slots);
+}
+
+// Pool thread: run its part of every posted job
+static void *scan_worker(void *arg) {
+    int thread = (int) (long) arg;
+    unsigned long long seen = 0;                   // Last job this worker took part in
+    pthread_mutex_lock(&pool_lock);
+    while (1) {
+        while (pool_round == seen) {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+        seen = pool_round;
+        ScanJob *job = pool_job;
+        pthread_mutex_unlock(&pool_lock);
+        if (thread < job->threads) {
+            run_share(job, thread);
+        }
+        pthread_mutex_lock(&pool_lock);
+        if (--pool_working == 0) {
+            pthread_cond_signal(&pool_idle);
+        }
+    }
+    return NULL;
+}
+
+// Threads a scan of `slot_count` slots should use
+static int wanted_threads(int slot_count) {
+    if (slot_count < SCAN_PARALLEL_MIN) {
+        return 1;
+    }
+    int threads = scan_threads;
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int) cpus : 1;
+    }
+    int chunks = (slot_count + SCAN_CHUNK_SLOTS - 1) / SCAN_CHUNK_SLOTS;
+    if (threads > chunks) threads = chunks;
+    return threads > SCAN_MAX_THREADS ? SCAN_MAX_THREADS : threads;
+}
+
+// Run a job on the calling thread plus `job->threads - 1` pool threads
+static void run_parallel(ScanJob *job) {
+    pthread_mutex_lock(&pool_lock);
+    while (pool_started < job->threads - 1) {      // Grow the pool on first use
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, scan_worker, (void *) (long) (pool_started + 1)) != 0) {
+            break;
+        }
+        pthread_detach(thread);
+        pool_started++;
+    }
+    pool_job = job;
+    pool_working = pool_started;
+    pool_round++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    run_share(job, 0);                             // Missing threads' shares are stolen by the rest
+
+    pthread_mutex_lock(&pool_lock);
+    while (pool_working > 0) {
+        pthread_cond_wait(&pool_idle, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+int scan_books(const ScanQuery *query, IdList *out) {
+    unsigned long long start = stats_now();        // Time the scan
+    ScanJob scan;
+    ScanJob *job = &scan;
+    int slot_count = get_slot_count();
+    int threads = wanted_threads(slot_count);
+    int pooled = threads > 1 && pthread_mutex_trylock(&scan_busy) == 0; // Pool taken by another scan: go alone
+    if (!pooled) {
+        threads = 1;
+    }
+
+    compile_query(query, slot_count, &job->program);
+    job->books = get_library_address();
+    job->ids = get_book_id_column();
+    job->years = get_book_year_column();
+    job->slot_count = slot_count;
+    job->chunk_count = (slot_count + SCAN_CHUNK_SLOTS - 1) / SCAN_CHUNK_SLOTS;
+    job->threads = threads;
+    job->chunks = malloc((size_t) (job->chunk_count > 0 ? job->chunk_count : 1) * sizeof(ScanChunkResult));
+    int ok = job->chunks != NULL;
+    for (int c = 0; ok && c < job->chunk_count; c++) {
+        job->chunks[c].thread = -1;                // Not scanned yet
+    }
+    for (int t = 0; t < threads; t++) {            // Even shares of the chunks
+        unsigned int first = (unsigned int) ((long long) job->chunk_count * t / threads);
+        unsigned int last = (unsigned int) ((long long) job->chunk_count * (t + 1) / threads);
+        job->shares[t].range = ok ? ((unsigned long long) last << 32) | first : 0;
+        job->found[t] = (IdList) {0};
+        job->out_of_memory[t] = 0;
+    }
+    if (threads > 1) {
+        run_parallel(job);
+    } else {
+        run_share(job, 0);
+    }
+
+    for (int t = 0; t < threads; t++) ok = ok && !job->out_of_memory[t];
+    out->count = 0;                                // Gather in chunk order
+    for (int c = 0; ok && c < job->chunk_count; c++) {
+        const ScanChunkResult *chunk = &job->chunks[c];
+        if (chunk->thread < 0) {                   // Every thread ran out of memory before reaching it
+            ok = 0;
+            break;
+        }
+        const int *ids = job->found[chunk->thread].ids + chunk->first;
+        for (int i = 0; i < chunk->count && ok; i++) {
+            ok = id_list_push(out, ids[i]);
+        }
+    }
+    int sorted = 1;                                // Slots are usually in ID order already
+    for (int i = 1; i < out->count && sorted; i++) sorted = out->ids[i - 1] < out->ids[i];
+    if (!sorted) {
+        id_list_sort(out);
+    }
+    for (int t = 0; t < threads; t++) id_list_free(&job->found[t]);
+    for (int t = 0; t < job->program.count; t++) free((void *) job->program.tests[t].authors);
+    free(job->chunks);
+    if (pooled) {
+        pthread_mutex_unlock(&scan_busy);
+    }
+    stats_record(STAT_SCAN, start, out->count, *get_book_count_address());
+    return ok;
+}
+
+// ==================== prefix_index.h ====================
+#ifndef PREFIX_INDEX_H         // Include guard to prevent multiple inclusions
+#define PREFIX_INDEX_H         // Define the include guard macro
+
+// Prefix (autocomplete) indexes over titles and author names.
+// Each is an array of (text, book ID) entries sorted by case-folded text, so
+// the texts starting with a prefix are one run found by binary search. A
+// completion is a distinct text of that run (any case), returned in
+// alphabetical order with the number of books that have it.
+// New entries go to a small sorted side array, merged into the main one when
+// it fills up; removed entries are marked dead and swept out once they pass a
+// quarter of the array. An index is built from the library by the first
+// completion and kept up to date by append_book() and remove_book_at() from
+// then on, so loading a catalog costs nothing until someone asks.
+#define PREFIX_TITLES 0                // Index over titles
+#define PREFIX_AUTHORS 1               // Index over author names
+#define PREFIX_FIELDS 2                // Number of indexes
+#define PREFIX_DEFAULT_RESULTS 10      // Completions shown by the menu
+#define PREFIX_MAX_RESULTS 100         // Largest number of completions returned
+#define PREFIX_DELTA_MAX 4096          // Side array size (entries added since the last merge)
+
+// One completion of a prefix
+typedef struct {
+    const char *text;          // The title or author name (spelling of its first book)
+    int books;                 // Books with this text, ignoring case
+    int id;                    // One of those books
+} Completion;
+
+void prefix_index_add(int field, int id, const char *text);    // Index a book's title or author (once built)
+void prefix_index_remove(int field, int id, const char *text); // Un-index it
+void prefix_index_clear();                                     // Forget both indexes (rebuilt on next use)
+// Fills `out` with up to `limit` completions (at most PREFIX_MAX_RESULTS) of
+// `prefix` in one field, in alphabetical order; returns how many, or -1 if
+// out of memory. Callers must not change the library meanwhile (as for searches).
+int prefix_complete(int field, const char *prefix, int limit, Completion *out);
+
+#endif // PREFIX_INDEX_H       // End of include guard
+
+// ==================== prefix_index.c ====================
+#include <stdlib.h>            // For malloc, realloc, qsort, free functions
+#include <string.h>            // For memmove function
+#include <pthread.h>           // For the build lock
+
+#include "prefix_index.h"      // Include our declarations
+#include "admin.h"             // Include the slot map (to build from the library)
+#include "author_dict.h"       // Include interned author names
+#include "stats.h"             // Include operation timing
+
+// One indexed text
+typedef struct {
+    const char *text;          // Title or author name (owned by the library)
+    int id;                    // Book ID (0 = removed)
+} PrefixEntry;
+
+// A sorted array of entries
+typedef struct {
+    PrefixEntry *entries;
+    int count;                 // Entries in use, dead ones included
+    int capacity;              // Entries allocated
+} PrefixRun;
+
+typedef struct {
+    PrefixRun main;            // Most entries
+    PrefixRun delta;           // Entries added since the last merge (at most PREFIX_DELTA_MAX)
+    int dead;                  // Dead entries in both runs
+    int built;                 // Set once the index holds the library (read with acquire)
+} PrefixIndex;
+
+static PrefixIndex prefix_indexes[PREFIX_FIELDS];
+static pthread_mutex_t build_lock = PTHREAD_MUTEX_INITIALIZER; // Concurrent readers build an index only once
+
+static unsigned char fold(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char) (c + ('a' - 'A')) : c;
+}
+
+// Compare two texts ignoring (ASCII) case, like strcmp
+static int compare_folded(const char *a, const char *b) {
+    while (*a && fold((unsigned char) *a) == fold((unsigned char) *b)) {
+        a++;
+        b++;
+    }
+    return (int) fold((unsigned char) *a) - (int) fold((unsigned char) *b);
+}
+
+// 1 if `text` starts with `prefix`, ignoring case
+static int has_prefix(const char *text, const char *prefix) {
+    for (; *prefix; text++, prefix++) {
+        if (fold((unsigned char) *text) != fold((unsigned char) *prefix)) {
+            return 0;                                  // (also stops at the end of text)
+        }
+    }
+    return 1;
+}
+
+// Entry being sorted by the build, with its first 8 folded bytes as a number
+typedef struct {
+    unsigned long long key;    // Folded bytes 0-7, big-endian (zero after the end)
+    PrefixEntry entry;
+} SortEntry;
+
+static unsigned long long folded_key(const char *text) {
+    unsigned long long key = 0;
+    int i = 0;
+    for (; i < 8 && text[i]; i++) {
+        key = key << 8 | fold((unsigned char) text[i]);
+    }
+    return key << (8 * (8 - i));
+}
+
+// Sort order of the build: text, then ID, so equal texts list their books in ID order
+// Most pairs differ in their first 8 bytes and are decided by one integer compare.
+static int compare_entries(const void *a, const void *b) {
+    const SortEntry *x = a, *y = b;
+    int order = (x->key > y->key) - (x->key < y->key);
+    if (order == 0 && (x->key & 0xff) != 0) {         // Same first 8 bytes, neither ended: compare the rest
+        order = compare_folded(x->entry.text + 8, y->entry.text + 8);
+    }
+    return order != 0 ? order : (x->entry.id > y->entry.id) - (x->entry.id < y->entry.id);
+}
+
+// First position in [0, count) whose text is not below `text` (or, with
+// `after` set, above it)
+static int find_position(const PrefixEntry *entries, int count, const char *text, int after) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int order = compare_folded(entries[mid].text, text);
+        if (order < 0 || (after && order == 0)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// First position whose text is not below `prefix`, comparing only the prefix's length
+static int find_prefix(const PrefixEntry *entries, int count, const char *prefix) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const char *t = entries[mid].text, *p = prefix;
+        while (*p && fold((unsigned char) *t) == fold((unsigned char) *p)) {
+            t++;
+            p++;
+        }
+        if (*p != '\0' && fold((unsigned char) *t) < fold((unsigned char) *p)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int run_reserve(PrefixRun *run, int needed) {
+    if (needed <= run->capacity) {
+        return 1;
+    }
+    int capacity = run->capacity ? run->capacity : 1024;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    PrefixEntry *grown = realloc(run->entries, (size_t) capacity * sizeof(PrefixEntry));
+    if (grown == NULL) {
+        return 0;
+    }
+    run->entries = grown;
+    run->capacity = capacity;
+    return 1;
+}
+
+// Move the side array into the main one, dropping dead entries from both
+// Each side entry finds its place by binary search, then the main entries are
+// shifted up from the back, so every main entry moves at most once.
+static int merge_delta(PrefixIndex *index) {
+    PrefixRun *main = &index->main, *delta = &index->delta;
+    if (!run_reserve(main, main->count + delta->count)) {
+        return 0;
+    }
+    int end = main->count;                             // Main entries not yet placed: [0, end)
+    int write = main->count + delta->count;            // Next free position, from the back
+    for (int d = delta->count - 1; d >= 0; d--) {
+        int pos = find_position(main->entries, end, delta->entries[d].text, 1); // After equal texts
+        memmove(&main->entries[write - (end - pos)], &main->entries[pos], (size_t) (end - pos) * sizeof(PrefixEntry));
+        write -= end - pos;
+        main->entries[--write] = delta->entries[d];
+        end = pos;
+    }
+    main->count += delta->count;
+    delta->count = 0;
+    if (index->dead > main->count / 4) {               // Sweep out removed entries
+        int kept = 0;
+        for (int i = 0; i < main->count; i++) {
+            if (main->entries[i].id != 0) main->entries[kept++] = main->entries[i];
+        }
+        main->count = kept;
+        index->dead = 0;
+    }
+    return 1;
+}
+
+// Fill an index from the library (called once, by the first completion)
+static int build_index(int field, PrefixIndex *index) {
+    const Book *books = get_library_address();
+    PrefixRun *main = &index->main;
+    main->count = 0;
+    index->delta.count = 0;
+    index->dead = 0;
+    int count = *get_book_count_address();
+    SortEntry *sorting = malloc((size_t) (count > 0 ? count : 1) * sizeof(SortEntry));
+    if (sorting == NULL || !run_reserve(main, count)) {
+        free(sorting);
+        return 0;
+    }
+    int n = 0;
+    for (int slot = next_live_slot(0); slot != -1; slot = next_live_slot(slot + 1)) {
+        const char *text = field == PREFIX_TITLES ? books[slot].title : author_dict_name(books[slot].author_id);
+        sorting[n++] = (SortEntry) { folded_key(text), { text, books[slot].id } };
+    }
+    qsort(sorting, (size_t) n, sizeof(SortEntry), compare_entries);
+    for (int i = 0; i < n; i++) {
+        main->entries[i] = sorting[i].entry;
+    }
+    main->count = n;
+    free(sorting);
+    return 1;
+}
+
+// Function to index one text (nothing to do until the index is built)
+void prefix_index_add(int field, int id, const char *text) {
+    PrefixIndex *index = &prefix_indexes[field];
+    if (!index->built) {
+        return;
+    }
+    PrefixRun *delta = &index->delta;
+    if (delta->count == PREFIX_DELTA_MAX && !merge_delta(index)) {
+        index->built = 0;                              // Out of memory: rebuild on next use
+        return;
+    }
+    if (!run_reserve(delta, delta->count + 1)) {
+        index->built = 0;
+        return;
+    }
+    int pos = find_position(delta->entries, delta->count, text, 1); // Books of one text stay in ID order
+    memmove(&delta->entries[pos + 1], &delta->entries[pos], (size_t) (delta->count - pos) * sizeof(PrefixEntry));
+    delta->entries[pos] = (PrefixEntry) { text, id };
+    delta->count++;
+}
+
+// Mark the entry of `id` dead among the entries equal to `text`; returns 1 if found
+static int remove_from(PrefixRun *run, int id, const char *text) {
+    for (int i = find_position(run->entries, run->count, text, 0);
+         i < run->count && compare_folded(run->entries[i].text, text) == 0; i++) {
+        if (run->entries[i].id == id) {
+            run->entries[i].id = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to un-index one text
+void prefix_index_remove(int field, int id, const char *text) {
+    PrefixIndex *index = &prefix_indexes[field];
+    if (!index->built) {
+        return;
+    }
+    if (remove_from(&index->main, id, text) || remove_from(&index->delta, id, text)) {
+        index->dead++;
+    }
+}
+
+// Function to forget both indexes (the library was emptied)
+void prefix_index_clear() {
+    for (int f = 0; f < PREFIX_FIELDS; f++) {
+        prefix_indexes[f].built = 0;                   // Arrays are kept for the rebuild
+        prefix_indexes[f].main.count = 0;
+        prefix_indexes[f].delta.count = 0;
+        prefix_indexes[f].dead = 0;
+    }
+}
+
+// Collect completions from the prefix's run in both arrays, merged in order
+// `walked` counts the entries looked at.
+static int collect(const PrefixIndex *index, const char *prefix, int limit, Completion *out, int *walked) {
+    const PrefixRun *main = &index->main, *delta = &index->delta;
+    int m = find_prefix(main->entries, main->count, prefix);
+    int d = find_prefix(delta->entries, delta->count, prefix);
+    int found = 0;
+    while (1) {
+        const PrefixEntry *next;                       // Smaller of the two heads
+        int in_main = m < main->count && has_prefix(main->entries[m].text, prefix);
+        int in_delta = d < delta->count && has_prefix(delta->entries[d].text, prefix);
+        if (!in_main && !in_delta) {
+            break;                                     // Past the end of the prefix's run
+        }
+        if (in_main && (!in_delta || compare_folded(main->entries[m].text, delta->entries[d].text) <= 0)) {
+            next = &main->entries[m++];
+        } else {
+            next = &delta->entries[d++];
+        }
+        (*walked)++;
+        if (next->id == 0) {
+            continue;                                  // Removed book
+        }
+        if (found > 0 && compare_folded(out[found - 1].text, next->text) == 0) {
+            out[found - 1].books++;                    // Same text as the last completion
+        } else if (found == limit) {
+            break;                                     // A new text, but no room left
+        } else {
+            out[found++] = (Completion) { next->text, 1, next->id };
+        }
+    }
+    return found;
+}
+
+int prefix_complete(int field, const char *prefix, int limit, Completion *out) {
+    unsigned long long start = stats_now();            // Time the lookup
+    PrefixIndex *index = &prefix_indexes[field];
+    if (limit > PREFIX_MAX_RESULTS) limit = PREFIX_MAX_RESULTS;
+    if (!__atomic_load_n(&index->built, __ATOMIC_ACQUIRE)) { // First use: build it (once, if several readers race)
+        pthread_mutex_lock(&build_lock);
+        int ok = index->built || build_index(field, index);
+        if (ok && !index->built) {
+            __atomic_store_n(&index->built, 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&build_lock);
+        if (!ok) {
+            return -1;
+        }
+    }
+    int walked = 0;                                    // Entries of the prefix's run looked at
+    int found = limit > 0 ? collect(index, prefix, limit, out, &walked) : 0;
+    stats_record(STAT_COMPLETE, start, found, walked);
+    return found;
+}
+
+// ==================== loan_ledger.h ====================
+#ifndef LOAN_LEDGER_H          // Include guard to prevent multiple inclusions
+#define LOAN_LEDGER_H          // Define the include guard macro
+
+// Loan ledger: every borrow and return in the order they happened, and
+// circulation figures that each event updates as it is recorded.
+// The events are append-only columns (time, book ID, kind) filled a page at a
+// time. Pages never move, so a snapshot thread can read the events recorded
+// before its view opened while new ones are appended.
+// The figures cover the books in the catalog; a removed book takes its loans
+// out of them (its events stay in the ledger):
+//   - books on loan: in total, per author and per decade of publication
+//   - loans ever made: per book, per author and per decade
+// Books and authors are also kept in order of their counts, so the top N
+// costs O(N): a count only moves by one per event, and one swap with the edge
+// of its group of equal counts keeps the order.
+#define LEDGER_RETURN 0                // Event kinds
+#define LEDGER_BORROW 1
+#define LEDGER_PAGE_EVENTS 65536       // Events per page of the columns
+#define LEDGER_MAX_PAGES 32768         // Pages the ledger can hold (2^31 events)
+#define LEDGER_FIRST_YEAR 0            // First year of the first decade counted
+#define LEDGER_DECADES 256             // Decades counted (earlier and later years go to the first and last)
+#define LEDGER_DEFAULT_RESULTS 10      // Books and authors shown by reports
+
+// A book or author and its count
+typedef struct {
+    unsigned int key;          // Book ID, or author ID
+    int count;                 // Loans ever made (books), or books on loan now (authors)
+} LoanRank;
+
+// Figures of one decade of publication
+typedef struct {
+    int first_year;            // First year of the decade
+    int on_loan;               // Books from it on loan now
+    long long loans;           // Loans ever made of its books
+} DecadeLoans;
+
+// Called by admin.c as loans and books change
+void ledger_record(int id, unsigned int author_id, int year, int borrowed, unsigned int time); // A book was borrowed (1) or returned (0)
+void ledger_book_added(unsigned int author_id, int year, int borrowed); // A book joined the catalog (maybe on loan)
+void ledger_book_removed(int id, unsigned int author_id, int year, int borrowed); // A book left it
+void ledger_clear();                                   // Forget every event and figure
+
+// Events, for snapshots
+long long ledger_event_count();                        // Events recorded so far
+// Points at the events from `first` on that share one page (at most `count`
+// of them, all below a count read earlier); returns how many that is
+long long ledger_events(long long first, long long count, const unsigned int **times, const int **ids,
+                        const unsigned char **kinds);
+// Appends saved events and counts the loans of the books in the catalog; 0 if out of memory
+int ledger_load(const unsigned int *times, const int *ids, const unsigned char *kinds, long long count);
+
+// Figures
+int ledger_on_loan();                                  // Books on loan now
+int ledger_top_books(int limit, LoanRank *out);        // Most borrowed books, most loans first; returns how many
+int ledger_top_authors(int limit, LoanRank *out);      // Authors with the most books on loan now
+void ledger_author(unsigned int author_id, int *on_loan, long long *loans); // Figures of one author
+int ledger_decades(DecadeLoans *out);                  // Decades with any loan, oldest first (`out` holds LEDGER_DECADES)
+
+#endif // LOAN_LEDGER_H        // End of include guard
+
+// ==================== loan_ledger.c ====================
+#include <stdio.h>             // For fprintf function
+#include <stdlib.h>            // For malloc, calloc, realloc, free functions
+#include <string.h>            // For memcpy, memset functions
+#include <pthread.h>           // For the ledger lock
+
+#include "loan_ledger.h"       // Include our declarations
+#include "admin.h"             // Include the library (to count loaded events)
+
+#define RANK_EMPTY 0xFFFFFFFFu // Key of an unused hash table entry (never a book or author ID)
+#define RANK_MIN_SLOTS 64      // Smallest hash table (always a power of two)
+
+// One page of the event columns
+typedef struct {
+    unsigned int times[LEDGER_PAGE_EVENTS];   // Seconds since the epoch (0 = unknown)
+    int ids[LEDGER_PAGE_EVENTS];              // Book borrowed or returned
+    unsigned char kinds[LEDGER_PAGE_EVENTS];  // LEDGER_BORROW or LEDGER_RETURN
+} LedgerPage;
+
+// Entry of a ranking's hash table
+typedef struct {
+    unsigned int key;          // Book or author ID (RANK_EMPTY = unused)
+    int position;              // Where it is in the ranking
+} RankSlot;
+
+// Keys in order of a count that only moves by one at a time.
+// Entries with the same count are next to each other, highest count first;
+// the entries with count c start at above[c] (the number of entries counting
+// more than c). Keys whose count drops to 0 leave the ranking.
+typedef struct {
+    LoanRank *entries;         // Highest count first
+    int size;                  // Entries in use
+    int capacity;              // Entries allocated
+    int *above;                // above[c]: entries with a count above c
+    int above_capacity;        // Counts above[] covers
+    RankSlot *slots;           // Hash table from key to position (linear probing)
+    int slot_capacity;         // Entries in the table (power of two)
+    int slot_shift;            // 32 - log2(slot_capacity): keeps the top bits of a hash
+} Ranking;
+
+static LedgerPage *ledger_pages[LEDGER_MAX_PAGES]; // Event columns, allocated a page at a time
+static long long event_count = 0;          // Events recorded (published with release)
+static int on_loan = 0;                    // Books on loan now (read without the lock)
+static Ranking book_loans;                 // Books by loans ever made
+static Ranking author_on_loan;             // Authors by books on loan now
+static long long *author_loans = NULL;     // Author ID -> loans ever made
+static unsigned int author_capacity = 0;   // Authors author_loans covers
+static int decade_on_loan[LEDGER_DECADES]; // Books on loan per decade
+static long long decade_loans[LEDGER_DECADES]; // Loans ever made per decade
+static pthread_mutex_t ledger_lock = PTHREAD_MUTEX_INITIALIZER; // Reports run while borrows go on
+
+// Spread the bits of a key and map it into the table (Fibonacci hashing)
+static int rank_home(const Ranking *r, unsigned int key) {
+    return (int) ((key * 2654435769u) >> r->slot_shift);
+}
+
+// Hash table entry holding a key, or -1
+static int rank_find(const Ranking *r, unsigned int key) {
+    if (r->size == 0) {
+        return -1;
+    }
+    for (int pos = rank_home(r, key); r->slots[pos].key != RANK_EMPTY; pos = (pos + 1) & (r->slot_capacity - 1)) {
+        if (r->slots[pos].key == key) {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+static void rank_insert(Ranking *r, unsigned int key, int position) {
+    int pos = rank_home(r, key);
+    while (r->slots[pos].key != RANK_EMPTY) {
+        pos = (pos + 1) & (r->slot_capacity - 1);
+    }
+    r->slots[pos].key = key;
+    r->slots[pos].position = position;
+}
+
+// Remove a key from the hash table (backward-shift deletion, as in id_index.c)
+static void rank_erase(Ranking *r, int pos) {
+    int mask = r->slot_capacity - 1;
+    for (int next = (pos + 1) & mask; r->slots[next].key != RANK_EMPTY; next = (next + 1) & mask) {
+        int home = rank_home(r, r->slots[next].key);
+        if (((next - home) & mask) >= ((next - pos) & mask)) { // The hole lies on its probe path
+            r->slots[pos] = r->slots[next];
+            pos = next;
+        }
+    }
+    r->slots[pos].key = RANK_EMPTY;
+}
+
+// Make room for one more entry (the hash table stays at most half full)
+static int rank_reserve(Ranking *r) {
+    if (r->size == r->capacity) {
+        int capacity = r->capacity ? r->capacity * 2 : RANK_MIN_SLOTS;
+        LoanRank *grown = realloc(r->entries, (size_t) capacity * sizeof(LoanRank));
+        if (grown == NULL) {
+            return 0;
+        }
+        r->entries = grown;
+        r->capacity = capacity;
+    }
+    if ((r->size + 1) * 2 > r->slot_capacity) {       // Rebuild a larger table from the entries
+        int capacity = r->slot_capacity ? r->slot_capacity * 2 : RANK_MIN_SLOTS;
+        RankSlot *slots = malloc((size_t) capacity * sizeof(RankSlot));
+        if (slots == NULL) {
+            return 0;
+        }
+        for (int i = 0; i < capacity; i++) {
+            slots[i].key = RANK_EMPTY;
+        }
+        free(r->slots);
+        r->slots = slots;
+        r->slot_capacity = capacity;
+        r->slot_shift = 32 - __builtin_ctz((unsigned int) capacity);
+        for (int i = 0; i < r->size; i++) {
+            rank_insert(r, r->entries[i].key, i);
+        }
+    }
+    return 1;
+}
+
+// Exchange two entries and tell the hash table where they went
+static void rank_swap(Ranking *r, int a, int b) {
+    if (a == b) {
+        return;
+    }
+    LoanRank entry = r->entries[a];
+    r->entries[a] = r->entries[b];
+    r->entries[b] = entry;
+    r->slots[rank_find(r, r->entries[a].key)].position = a;
+    r->slots[rank_find(r, r->entries[b].key)].position = b;
+}
+
+// Add one to a key's count: it swaps places with the first entry of its
+// group and joins the group above. Returns 0 if out of memory.
+static int rank_increment(Ranking *r, unsigned int key) {
+    int slot = rank_find(r, key);
+    int c = slot == -1 ? 0 : r->entries[r->slots[slot].position].count;
+    if (c + 2 > r->above_capacity) {                  // above[c + 1] must exist (0: nobody counts more)
+        int capacity = r->above_capacity ? r->above_capacity * 2 : RANK_MIN_SLOTS;
+        int *grown = realloc(r->above, (size_t) capacity * sizeof(int));
+        if (grown == NULL) {
+            return 0;
+        }
+        memset(grown + r->above_capacity, 0, (size_t) (capacity - r->above_capacity) * sizeof(int));
+        r->above = grown;
+        r->above_capacity = capacity;
+    }
+    int p;
+    if (slot == -1) {                                 // New key: joins at the end with count 0
+        if (!rank_reserve(r)) {
+            return 0;
+        }
+        p = r->size++;
+        r->entries[p].key = key;
+        r->entries[p].count = 0;
+        rank_insert(r, key, p);
+    } else {
+        p = r->slots[slot].position;
+    }
+    int first = r->above[c];                          // First entry with count c
+    rank_swap(r, p, first);
+    r->above[c]++;                                    // It now counts more than c
+    r->entries[first].count = c + 1;
+    return 1;
+}
+
+// Take one from a key's count: it swaps places with the last entry of its
+// group and joins the group below; at 0 it leaves the ranking.
+static void rank_decrement(Ranking *r, unsigned int key) {
+    int slot = rank_find(r, key);
+    if (slot == -1) {
+        return;
+    }
+    int c = r->entries[r->slots[slot].position].count;
+    int last = r->above[c - 1] - 1;                   // Last entry with count c
+    rank_swap(r, r->slots[slot].position, last);
+    r->above[c - 1]--;
+    r->entries[last].count = c - 1;
+    if (c == 1) {                                     // Count 0 is the last entry: drop it
+        rank_erase(r, rank_find(r, key));
+        r->size--;
+    }
+}
+
+static int rank_count(const Ranking *r, unsigned int key) {
+    int slot = rank_find(r, key);
+    return slot == -1 ? 0 : r->entries[r->slots[slot].position].count;
+}
+
+static void rank_clear(Ranking *r) {
+    for (int i = 0; i < r->slot_capacity; i++) {
+        r->slots[i].key = RANK_EMPTY;
+    }
+    if (r->above != NULL) {
+        memset(r->above, 0, (size_t) r->above_capacity * sizeof(int));
+    }
+    r->size = 0;
+}
+
+static int rank_top(const Ranking *r, int limit, LoanRank *out) {
+    int count = limit < r->size ? limit : r->size;
+    memcpy(out, r->entries, (size_t) (count > 0 ? count : 0) * sizeof(LoanRank));
+    return count > 0 ? count : 0;
+}
+
+// Decade a publication year is counted in
+static int decade_of(int year) {
+    if (year < LEDGER_FIRST_YEAR) {
+        return 0;
+    }
+    int decade = (year - LEDGER_FIRST_YEAR) / 10;
+    return decade < LEDGER_DECADES ? decade : LEDGER_DECADES - 1;
+}
+
+// Loans-ever figures of an author, grown to cover every interned author
+static long long *author_loans_of(unsigned int author_id) {
+    if (author_id >= author_capacity) {
+        unsigned int capacity = author_capacity ? author_capacity : RANK_MIN_SLOTS;
+        while (capacity <= author_id) capacity *= 2;
+        long long *grown = realloc(author_loans, capacity * sizeof(long long));
+        if (grown == NULL) {
+            return NULL;
+        }
+        memset(grown + author_capacity, 0, (capacity - author_capacity) * sizeof(long long));
+        author_loans = grown;
+        author_capacity = capacity;
+    }
+    return &author_loans[author_id];
+}
+
+// Count `loans` more (or fewer) loans ever made of a book (with the lock held)
+// Returns 0 if out of memory: the totals are kept, but a ranking or the
+// author's figure may be short.
+static int count_loans(int id, unsigned int author_id, int year, int loans) {
+    int ok = 1;
+    for (int i = 0; i < loans && ok; i++) ok = rank_increment(&book_loans, (unsigned int) id);
+    for (int i = 0; i > loans; i--) rank_decrement(&book_loans, (unsigned int) id);
+    long long *author = author_loans_of(author_id);
+    if (author != NULL) *author += loans;
+    decade_loans[decade_of(year)] += loans;
+    return ok && author != NULL;
+}
+
+// A book went on loan (+1) or came back (-1) (with the lock held); 0 if out of memory
+static int count_on_loan(unsigned int author_id, int year, int change) {
+    int ok = 1;
+    if (change > 0) {
+        ok = rank_increment(&author_on_loan, author_id);
+    } else {
+        rank_decrement(&author_on_loan, author_id);
+    }
+    decade_on_loan[decade_of(year)] += change;
+    __atomic_store_n(&on_loan, on_loan + change, __ATOMIC_RELAXED); // Only changed under the lock
+    return ok;
+}
+
+// Say once that the rankings missed a change (with the lock held)
+// Borrows and returns cannot fail, so the books go on loan regardless.
+static void report_short_figures() {
+    static int reported = 0;
+    if (!reported) {
+        fprintf(stderr, "Warning: out of memory; circulation rankings are incomplete\n");
+        reported = 1;
+    }
+}
+
+// Append an event to the columns (with the lock held); 0 if out of memory
+static int append_event(int id, int kind, unsigned int time) {
+    long long n = event_count;
+    long long page = n / LEDGER_PAGE_EVENTS;
+    if (page >= LEDGER_MAX_PAGES) {                   // Ledger is full
+        return 0;
+    }
+    if (ledger_pages[page] == NULL && (ledger_pages[page] = malloc(sizeof(LedgerPage))) == NULL) {
+        return 0;
+    }
+    int i = (int) (n % LEDGER_PAGE_EVENTS);
+    ledger_pages[page]->times[i] = time;
+    ledger_pages[page]->ids[i] = id;
+    ledger_pages[page]->kinds[i] = (unsigned char) kind;
+    __atomic_store_n(&event_count, n + 1, __ATOMIC_RELEASE); // Publish the event once it is written
+    return 1;
+}
+
+// Function to record a borrow or return
+// The figures follow the book even if the event could not be stored.
+void ledger_record(int id, unsigned int author_id, int year, int borrowed, unsigned int time) {
+    pthread_mutex_lock(&ledger_lock);
+    append_event(id, borrowed ? LEDGER_BORROW : LEDGER_RETURN, time);
+    int ok = borrowed ? count_loans(id, author_id, year, 1) : 1;
+    if (!count_on_loan(author_id, year, borrowed ? 1 : -1) || !ok) {
+        report_short_figures();
+    }
+    pthread_mutex_unlock(&ledger_lock);
+}
+
+void ledger_book_added(unsigned int author_id, int year, int borrowed) {
+    if (!borrowed) {                                  // Nothing to count (most books)
+        return;
+    }
+    pthread_mutex_lock(&ledger_lock);
+    if (!count_on_loan(author_id, year, 1)) {
+        report_short_figures();
+    }
+    pthread_mutex_unlock(&ledger_lock);
+}
+
+void ledger_book_removed(int id, unsigned int author_id, int year, int borrowed) {
+    pthread_mutex_lock(&ledger_lock);
+    if (borrowed) {
+        count_on_loan(author_id, year, -1);
+    }
+    count_loans(id, author_id, year, -rank_count(&book_loans, (unsigned int) id));
+    pthread_mutex_unlock(&ledger_lock);
+}
+
+// Function to forget every event and figure (the pages are kept for reuse)
+void ledger_clear() {
+    pthread_mutex_lock(&ledger_lock);
+    __atomic_store_n(&event_count, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&on_loan, 0, __ATOMIC_RELAXED);
+    rank_clear(&book_loans);
+    rank_clear(&author_on_loan);
+    if (author_loans != NULL) {
+        memset(author_loans, 0, author_capacity * sizeof(long long));
+    }
+    memset(decade_on_loan, 0, sizeof(decade_on_loan));
+    memset(decade_loans, 0, sizeof(decade_loans));
+    pthread_mutex_unlock(&ledger_lock);
+}
+
+long long ledger_event_count() {
+    return __atomic_load_n(&event_count, __ATOMIC_ACQUIRE);
+}
+
+long long ledger_events(long long first, long long count, const unsigned int **times, const int **ids,
+                        const unsigned char **kinds) {
+    LedgerPage *page = ledger_pages[first / LEDGER_PAGE_EVENTS];
+    int offset = (int) (first % LEDGER_PAGE_EVENTS);
+    long long run = LEDGER_PAGE_EVENTS - offset;      // Events left in this page
+    *times = page->times + offset;
+    *ids = page->ids + offset;
+    *kinds = page->kinds + offset;
+    return run < count ? run : count;
+}
+
+// Function to append the events of a snapshot
+// Call once the snapshot's books are in the library: each borrow of a book
+// still in the catalog is counted as a loan ever made (books on loan were
+// already counted as they were added).
+int ledger_load(const unsigned int *times, const int *ids, const unsigned char *kinds, long long count) {
+    pthread_mutex_lock(&ledger_lock);
+    long long n = event_count;
+    for (long long done = 0; done < count; ) {       // Copy the columns a page at a time
+        long long page = (n + done) / LEDGER_PAGE_EVENTS;
+        if (page >= LEDGER_MAX_PAGES ||
+            (ledger_pages[page] == NULL && (ledger_pages[page] = malloc(sizeof(LedgerPage))) == NULL)) {
+            pthread_mutex_unlock(&ledger_lock);
+            return 0;
+        }
+        int offset = (int) ((n + done) % LEDGER_PAGE_EVENTS);
+        long long run = LEDGER_PAGE_EVENTS - offset < count - done ? LEDGER_PAGE_EVENTS - offset : count - done;
+        memcpy(ledger_pages[page]->times + offset, times + done, (size_t) run * sizeof(unsigned int));
+        memcpy(ledger_pages[page]->ids + offset, ids + done, (size_t) run * sizeof(int));
+        memcpy(ledger_pages[page]->kinds + offset, kinds + done, (size_t) run);
+        done += run;
+    }
+    __atomic_store_n(&event_count, n + count, __ATOMIC_RELEASE);
+
+    const Book *library = get_library_address();
+    int ok = 1;
+    for (long long e = 0; e < count && ok; e++) {    // Loans of the books still here
+        int slot = kinds[e] == LEDGER_BORROW ? find_book_by_id(ids[e]) : -1;
+        if (slot != -1) {
+            ok = count_loans(ids[e], library[slot].author_id, library[slot].publication_year, 1);
+        }
+    }
+    pthread_mutex_unlock(&ledger_lock);
+    return ok;
+}
+
+int ledger_on_loan() {
+    return __atomic_load_n(&on_loan, __ATOMIC_RELAXED);
+}
+
+int ledger_top_books(int limit, LoanRank *out) {
+    pthread_mutex_lock(&ledger_lock);
+    int count = rank_top(&book_loans, limit, out);
+    pthread_mutex_unlock(&ledger_lock);
+    return count;
+}
+
+int ledger_top_authors(int limit, LoanRank *out) {
+    pthread_mutex_lock(&ledger_lock);
+    int count = rank_top(&author_on_loan, limit, out);
+    pthread_mutex_unlock(&ledger_lock);
+    return count;
+}
+
+void ledger_author(unsigned int author_id, int *books_on_loan, long long *loans) {
+    pthread_mutex_lock(&ledger_lock);
+    *books_on_loan = rank_count(&author_on_loan, author_id);
+    *loans = author_id < author_capacity ? author_loans[author_id] : 0;
+    pthread_mutex_unlock(&ledger_lock);
+}
+
+int ledger_decades(DecadeLoans *out) {
+    int count = 0;
+    pthread_mutex_lock(&ledger_lock);
+    for (int d = 0; d < LEDGER_DECADES; d++) {
+        if (decade_on_loan[d] != 0 || decade_loans[d] != 0) {
+            out[count].first_year = LEDGER_FIRST_YEAR + 10 * d;
+            out[count].on_loan = decade_on_loan[d];
+            out[count].loans = decade_loans[d];
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&ledger_lock);
+    return count;
+}
+
+// ==================== user.h ====================
+#ifndef USER_H                 // Include guard to prevent multiple inclusions
+#define USER_H                 // Define the include guard macro
+
+#include "book.h"              // Include Book structure definition
+#include <stdio.h>             // Include standard I/O functions
+#include <stdlib.h>            // Include standard library functions
+#include <ctype.h>             // Include character type functions
+
+// Function declarations only (no definitions in header)
+void viewAvailableBooks();     // Display all available (non-borrowed) books
+void borrowBook();             // Allow user to borrow a book
+void returnBook();             // Allow user to return a borrowed book
+void searchByTitle();          // Search books by title
+void searchByAuthor();         // Search books by author
+void searchByYearRange();      // Search books by a range of publication years
+void filterByAuthor();         // Filter search results by author
+void filterByYear();           // Filter search results by publication year (or range of years)
+void rankedSearch();           // Ranked, typo-tolerant search over titles and authors
+void autocomplete();           // Complete the start of a title or author name
+void toLowerStr(char *str);    // Convert string to lowercase
+void init_user_pointers();     // Initialize pointers to admin data
+
+// Search functions without prompts (results are sorted book IDs, no size limit)
+int search_by_title(const char *title, IdList *out);    // Books whose title contains `title` (any case); 0 if out of memory
+int search_by_author(const char *author, IdList *out);  // Books by `author` (exact name, else partial match); 0 if out of memory
+int search_by_year_range(int from, int to, IdList *out); // Books published from `from` to `to` (inclusive); 0 if out of memory
+int parse_year_range(const char *text, int *from, int *to); // Read "1990-2005" or "1990" into a range
+
+// Borrowing without prompts; both return one of the LOAN_ results
+#define LOAN_OK 0              // Status changed
+#define LOAN_NOT_FOUND 1       // No book has that ID
+#define LOAN_UNCHANGED 2       // Book is already borrowed (borrow) or not borrowed (return)
+int borrow_book(int id);       // Mark a book as borrowed
+int return_book(int id);       // Mark a book as available again
+
+#endif                         // End of include guard
+
+// ==================== user.c ====================
+#include "user.h"              // Include user function declarations
+#include <string.h>            // For: strcspn function
+#include <ctype.h>             // For: tolower function
+#include <stdio.h>             // Include standard I/O functions
+#include <stdlib.h>            // Include standard library functions
+#include <time.h>              // For: time function (loan times)
+#include "book.h"              // Include Book structure and related functions
+#include "admin.h"             // Include admin functions to access global data
+#include "journal.h"           // Include change journaling
+#include "render.h"            // Include the shared listing renderer
+#include "title_index.h"       // Include trigram index for title search
+#include "text_search.h"       // Include case-insensitive substring search
+
+#include "author_index.h"      // Include normalized author index
+#include "author_dict.h"       // Include interned author names
+#include "year_index.h"        // Include sorted publication year index
+#include "stats.h"             // Include operation timing
+#include "query_cache.h"       // Include the search result cache
+#include "ranked_search.h"     // Include ranked fuzzy search
+#include "scan.h"              // Include the parallel full scan
+#include "prefix_index.h"      // Include the autocomplete indexes
+
+// Get pointers to admin data - these will point to global variables in admin.c
+// Only the menus use them (on the main thread); search_by_title() and
+// search_by_author() also run on daemon workers and read the library directly.
+static Book *library_ptr = NULL;      // Pointer to the library array
+static int *book_count_ptr = NULL;    // Pointer to book count variable
+static int *next_id_ptr = NULL;       // Pointer to next ID variable
+
+IdList searchResults = {0};           // IDs of the last search's results (sorted, no fixed limit)
+
+// Initialize pointers to admin data
+void init_user_pointers() {
+    library_ptr = get_library_address();      // Get address of library array from admin.c
+    book_count_ptr = get_book_count_address(); // Get address of book_count from admin.c
+    next_id_ptr = get_next_id_address();       // Get address of next_id from admin.c
+}
+
+// Function to convert string to lowercase
+void toLowerStr(char *str) {
+    for (int i = 0; str[i]; i++) {            // Loop through each character until null terminator
+        str[i] = tolower((unsigned char) str[i]); // Convert character to lowercase
+    }
+}
+
+// Function to display every book in a list of IDs, with its current status
+// Returns the number of books displayed.
+static int print_results(const IdList *results) {
+    Renderer r;                                // Buffered output, one page at a time on a terminal
+    render_begin(&r, stdout, RENDER_HUMAN, 0, -1);
+    render_pause_on_terminal(&r);
+    putchar('\n');                             // Blank line before the first result
+    for (int k = 0; k < results->count; k++) { // Loop through the result IDs
+        int i = find_book_by_id(results->ids[k]); // Look up the book's current slot
+        if (i == -1) {                         // Removed since the search ran
+            continue;
+        }
+        if (!render_book(&r, &library_ptr[i], is_book_borrowed(i))) { // Stop when the user has seen enough
+            break;
+        }
+    }
+    render_end(&r);
+    return (int) r.shown;
+}
+
+// Function to find every book whose title contains `title`, ignoring case
+// Returns 0 (with the books found so far) if out of memory.
+int search_by_title(const char *title, IdList *out) {
+    unsigned long long start = stats_now();    // Time the search
+    unsigned long long generation = get_catalog_generation(); // Catalog the results belong to
+    if (query_cache_get(QUERY_TITLE, title, generation, out)) { // Same query, no book added or removed since
+        stats_record(STAT_SEARCH_TITLE, start, out->count, 0);
+        return 1;
+    }
+    long long scanned;                         // Titles compared
+    const Book *library = get_library_address(); // Not the menu pointers: daemon workers search at once
+    int ok = 1;                                // Cleared if the results could not all be kept
+    out->count = 0;                            // Start with no results
+
+    // Titles are compared in place with find_ignore_case, so neither the term
+    // nor the titles need a lowercase copy.
+    IdList candidates = {0};                   // Books that contain every trigram of the search term
+    if (title_index_candidates(title, &candidates)) { // Term long enough for the index
+        scanned = candidates.count;
+        for (int c = 0; c < candidates.count && ok; c++) { // Verify each candidate against its full title
+            int i = find_book_by_id(candidates.ids[c]);
+            if (i != -1 && find_ignore_case(library[i].title, title)) {
+                ok = id_list_push(out, candidates.ids[c]); // Candidates are already in ID order
+            }
+        }
+    } else {                                   // Very short term: scan every title (on every core)
+        scanned = *get_book_count_address();
+        ScanQuery query;
+        scan_query_init(&query);
+        query.title = title;
+        ok = scan_books(&query, out);          // Sorted by ID; 0 if some chunks were not scanned
+    }
+    id_list_free(&candidates);                 // Release the candidate list
+    if (ok) {                                  // A truncated list must never be served as a hit
+        query_cache_put(QUERY_TITLE, title, generation, out); // Answer the next identical search from the cache
+    }
+    stats_record(STAT_SEARCH_TITLE, start, out->count, scanned);
+    return ok;
+}
+
+// Function to find the books of an author
+// An exact (normalized) name is a single index lookup; anything else falls
+// back to a case-insensitive partial match over every author.
+// Returns 0 (with the books found so far) if out of memory.
+int search_by_author(const char *author, IdList *out) {
+    unsigned long long start = stats_now();    // Time the search
+    out->count = 0;                            // Start with no results
+
+    const IdList *books = author_index_lookup(author); // Exact author name?
+    if (books != NULL) {
+        int ok = 1;
+        for (int r = 0; r < books->count && ok; r++) { // Copy the posting list (already sorted)
+            ok = id_list_push(out, books->ids[r]);
+        }
+        stats_record(STAT_SEARCH_AUTHOR, start, out->count, books->count);
+        return ok;
+    }
+    unsigned long long generation = get_catalog_generation(); // Catalog the results belong to
+    if (query_cache_get(QUERY_AUTHOR, author, generation, out)) { // Same partial name, no book added or removed since
+        stats_record(STAT_SEARCH_AUTHOR, start, out->count, 0);
+        return 1;
+    }
+    ScanQuery query;                           // Partial name: check every author (on every core)
+    scan_query_init(&query);
+    query.author = author;
+    int ok = scan_books(&query, out);          // Sorted by ID; 0 if some chunks were not scanned
+    if (ok) {                                  // A partial scan must never be served as a hit
+        query_cache_put(QUERY_AUTHOR, author, generation, out); // Partial matches scan every book: keep the answer
+    }
+    stats_record(STAT_SEARCH_AUTHOR, start, out->count, *get_book_count_address());
+    return ok;
+}
+
+// Function to find the books published in a range of years
+int search_by_year_range(int from, int to, IdList *out) {
+    unsigned long long start = stats_now();    // Time the search
+    int ok = year_index_range(from, to, out);  // Two binary searches in the year index
+    stats_record(STAT_SEARCH_YEARS, start, out->count, out->count);
+    return ok;
+}
+
+// Function to read a year range such as "1990-2005" or a single year "1990"
+// Returns 1 if the text held a valid range and nothing else, 0 otherwise.
+int parse_year_range(const char *text, int *from, int *to) {
+    int used = 0;                              // Characters consumed by the match
+    if (sscanf(text, " %d - %d %n", from, to, &used) != 2 || text[used] != '\0') { // Not two years alone
+        if (sscanf(text, " %d %n", from, &used) != 1 || text[used] != '\0') { // Nothing read, a dangling '-' or trailing text
+            return 0;
+        }
+        *to = *from;                           // A single year is a range of one
+    }
+    if (*from > *to) {                         // The range is backwards
+        return 0;
+    }
+    return 1;
+}
+
+// Function to read a year range typed by the user
+// Returns 1 if a valid range was entered, 0 otherwise.
+static int read_year_range(const char *prompt, int *from, int *to) {
+    char line[64];                             // Buffer for the typed range
+    printf("%s", prompt);                      // Prompt for the range
+    clear_input_buffer();                      // Clear input buffer
+    if (fgets(line, sizeof(line), stdin) == NULL || !parse_year_range(line, from, to)) {
+        printf("Invalid year range. Use a year (1990) or a range (1990-2005).\n"); // Display error message
+        return 0;
+    }
+    return 1;
+}
+
+// Function to offer the filter menu for the current search results
+static void offer_filters() {
+    int choice;                                // Variable to store user choice
+    printf("\nFilter search results:\n1. By Author\n2. By Year (or range)\n3. Exit\nChoice: "); // Display filter menu
+    scanf("%d", &choice);                      // Read user choice
+
+    switch (choice) {                          // Execute based on user choice
+        case 1: filterByAuthor(); break;       // Filter by author
+        case 2: filterByYear(); break;         // Filter by year
+        case 3: default: break;                // Exit or default case
+    }
+}
+
+//**************************Search By Title******************************//
+
+void searchByTitle() {
+    init_user_pointers();                      // Refresh pointers (the library array moves when it grows)
+    
+    char search_title[100];                    // Buffer to store search term
+    printf("Enter the book title to search: "); // Prompt user for search term
+    clear_input_buffer();                      // Clear input buffer
+    fgets(search_title, sizeof(search_title), stdin); // Read search term with spaces
+    search_title[strcspn(search_title, "\n")] = 0; // Remove newline character
+
+    printf("\nSearching through %d books...\n", *book_count_ptr); // Display search info
+    if (!search_by_title(search_title, &searchResults)) { // Collect the matching IDs
+        printf("Not enough memory; the results may be incomplete.\n"); // Display warning
+    }
+
+    if (print_results(&searchResults) == 0) {  // Display them; if no books found
+        printf("No books found with title containing \"%s\".\n", search_title); // Display message
+        return;                                 // Exit function
+    }
+
+    offer_filters();                           // Offer filter options
+}
+
+//**************************Search By Author******************************//
+
+void searchByAuthor() {
+    init_user_pointers();                      // Refresh pointers (the library array moves when it grows)
+
+    char author[MAX_AUTHOR_LEN];               // Buffer to store author name
+    printf("Enter the author's name to search: "); // Prompt user for author
+    clear_input_buffer();                      // Clear input buffer
+    fgets(author, sizeof(author), stdin);      // Read author name with spaces
+    author[strcspn(author, "\n")] = 0;         // Remove newline character
+
+    if (!search_by_author(author, &searchResults)) { // Collect the matching IDs
+        printf("Not enough memory; the results may be incomplete.\n"); // Display warning
+    }
+
+    if (print_results(&searchResults) == 0) {  // Display them; if no books found
+        printf("No books found by \"%s\".\n", author); // Display message
+        return;                                 // Exit function
+    }
+
+    offer_filters();                           // Offer filter options
+}
+
+//**************************Search By Year Range******************************//
+
+void searchByYearRange() {
+    init_user_pointers();                      // Refresh pointers (the library array moves when it grows)
+
+    int from, to;                              // Range of publication years
+    if (!read_year_range("Enter publication year range (e.g. 1990-2005): ", &from, &to)) {
+        return;                                 // Exit function
+    }
+
+    search_by_year_range(from, to, &searchResults); // Collect the matching IDs
+
+    if (print_results(&searchResults) == 0) {  // Display them; if no books found
+        printf("No books found published from %d to %d.\n", from, to); // Display message
+        return;                                 // Exit function
+    }
+
+    offer_filters();                           // Offer filter options
+}
+
+//**************************filter By Author******************************//
+
+void filterByAuthor() {
+    char author[100];                          // Buffer to store author name
+    printf("Enter author's name to filter: "); // Prompt for author name
+    clear_input_buffer();                      // Clear input buffer
+    fgets(author, sizeof(author), stdin);      // Read author name with spaces
+    author[strcspn(author, "\n")] = 0;         // Remove newline character
+
+    unsigned long long start = stats_now();    // Time the filtering (not the printing)
+    IdList filtered = {0};                     // Search results by that author
+    const IdList *books = author_index_lookup(author); // Exact author name?
+    if (books != NULL) {                       // Intersect the results with the author's books
+        for (int r = 0; r < searchResults.count; r++) {
+            id_list_push(&filtered, searchResults.ids[r]);
+        }
+        id_list_intersect(&filtered, books->ids, books->count);
+    } else {                                   // Partial name: check the results one by one
+        unsigned long long *matching = NULL;   // Authors whose name contains it (one bit per author ID)
+        if ((unsigned int) searchResults.count > author_dict_count()) { // Fewer names than results: test each name once
+            matching = author_dict_matching(author);
+        }
+        for (int r = 0; r < searchResults.count; r++) { // Loop through search results only
+            int i = find_book_by_id(searchResults.ids[r]);
+            if (i == -1) {
+                continue;
+            }
+            unsigned int a = library_ptr[i].author_id; // Interned author of the book
+            if (matching != NULL ? (int) ((matching[a / 64] >> (a % 64)) & 1)
+                                 : find_ignore_case(author_dict_name(a), author) != NULL) { // If author name found in book's author (any case)
+                id_list_push(&filtered, searchResults.ids[r]);
+            }
+        }
+        free(matching);
+    }
+    stats_record(STAT_FILTER_AUTHOR, start, filtered.count, searchResults.count);
+
+    if (print_results(&filtered) == 0) {       // Display them; if no books found by that author
+        printf("No books found by that author in the search results.\n"); // Display message
+    }
+    id_list_free(&filtered);                   // Release the filtered list
+}
+
+//**************************filter By Year******************************//
+
+void filterByYear() {
+    int from, to;                              // Range of publication years
+    if (!read_year_range("Enter publication year (or range, e.g. 1990-2005) to filter: ", &from, &to)) {
+        return;                                 // Exit function
+    }
+
+    unsigned long long start = stats_now();    // Time the filtering (not the printing)
+    IdList filtered = {0};                     // Search results from those years
+    year_index_range(from, to, &filtered);     // Books from the range (sorted by ID; not timed as a search of its own)
+    id_list_intersect(&filtered, searchResults.ids, searchResults.count); // Keep only the search results
+    stats_record(STAT_FILTER_YEAR, start, filtered.count, searchResults.count);
+
+    if (print_results(&filtered) == 0) {       // Display them; if no books found from that year
+        printf("No books found from that year in the search results.\n"); // Display message
+    }
+    id_list_free(&filtered);                   // Release the filtered list
+}
+
+//**************************Ranked Search******************************//
+
+void rankedSearch() {
+    init_user_pointers();                      // Refresh pointers (the library array moves when it grows)
+
+    char query[100];                           // Buffer to store the query
+    printf("Enter title or author words (typos are fine): "); // Prompt user for the query
+    clear_input_buffer();                      // Clear input buffer
+    fgets(query, sizeof(query), stdin);        // Read query with spaces
+    query[strcspn(query, "\n")] = 0;           // Remove newline character
+
+    RankedHit hits[RANKED_DEFAULT_RESULTS];    // Best matches, best first
+    int found = search_ranked(query, RANKED_DEFAULT_RESULTS, hits);
+    if (found == 0) {                          // Nothing close enough
+        printf("No books found matching \"%s\".\n", query); // Display message
+        return;                                 // Exit function
+    }
+
+    for (int h = 0; h < found; h++) {          // Display each hit with its score
+        int i = find_book_by_id(hits[h].id);
+        printf("\n%d. Score %.2f\n", h + 1, hits[h].score);
+        display_book(&library_ptr[i], is_book_borrowed(i));
+    }
+}
+
+//**************************Autocomplete******************************//
+
+// Print one field's completions under a heading
+static void print_completions(const char *heading, const Completion *completions, int count) {
+    if (count <= 0) {                          // Nothing (or out of memory) for this field
+        return;
+    }
+    printf("\n%s:\n", heading);                // Display section header
+    for (int c = 0; c < count; c++) {          // One line per distinct text
+        if (completions[c].books == 1) {
+            printf("  %s (ID %d)\n", completions[c].text, completions[c].id);
+        } else {
+            printf("  %s (%d books)\n", completions[c].text, completions[c].books);
+        }
+    }
+}
+
+void autocomplete() {
+    char prefix[100];                          // Buffer to store what was typed so far
+    printf("Start typing a title or author: "); // Prompt user for the prefix
+    clear_input_buffer();                      // Clear input buffer
+    fgets(prefix, sizeof(prefix), stdin);      // Read prefix with spaces
+    prefix[strcspn(prefix, "\n")] = 0;         // Remove newline character
+
+    Completion titles[PREFIX_DEFAULT_RESULTS];  // First titles starting with it, alphabetically
+    Completion authors[PREFIX_DEFAULT_RESULTS]; // and first authors
+    int title_count = prefix_complete(PREFIX_TITLES, prefix, PREFIX_DEFAULT_RESULTS, titles);
+    int author_count = prefix_complete(PREFIX_AUTHORS, prefix, PREFIX_DEFAULT_RESULTS, authors);
+    if (title_count <= 0 && author_count <= 0) { // Nothing starts that way
+        printf("No title or author starts with \"%s\".\n", prefix); // Display message
+        return;                                 // Exit function
+    }
+    print_completions("Titles", titles, title_count);
+    print_completions("Authors", authors, author_count);
+}
+
+//**************************User Borrowing Functions ******************************//
+
+// عرض جميع الكتب المتاحة (التي لم يتم استعارتها)
+// Display all available books (that haven't been borrowed)
+void viewAvailableBooks() {
+    init_user_pointers();                      // Refresh pointers (the library array moves when it grows)
+
+    if (*book_count_ptr == 0) {                // Check if library is empty
+        printf("No books found, currently.\n"); // Display message
+        return;                                 // Exit function
+    }
+
+    printf("\nAvailable book list:\n");        // Display section header
+    printf("--------------------------------------------------\n"); // Display separator
+    
+    Renderer r;                                // Buffered output, one page at a time on a terminal
+    render_begin(&r, stdout, RENDER_COMPACT, 0, -1); // One line per book
+    render_pause_on_terminal(&r);
+    // Jump from available book to available book using the borrowed bitset
+    for (int i = next_book_with_status(0, 0); i != -1; i = next_book_with_status(i + 1, 0)) {
+        if (!render_book(&r, &library_ptr[i], 0)) { // Stop when the user has seen enough
+            break;
+        }
+    }
+    render_end(&r);
+    
+    if (r.shown == 0) {                        // If no available books found
+        printf("No books are currently available for borrowing.\n"); // Display message
+    }
+}
+
+// Function to change a book's borrowed status if it is not already in that state
+static int set_loan_status(int id, int borrowed) {
+    int i = find_book_by_id(id);               // Look up the book's slot through the ID index
+    if (i == -1) {                             // No such book
+        return LOAN_NOT_FOUND;
+    }
+    if (!change_book_borrowed(i, borrowed, (unsigned int) time(NULL))) { // Compare-and-swap the status bit (and record the loan)
+        return LOAN_UNCHANGED;                 // Already in that state
+    }
+    return LOAN_OK;
+}
+
+int borrow_book(int id) {
+    unsigned long long start = stats_now();    // Time the call
+    int status = set_loan_status(id, 1);       // Available -> borrowed
+    stats_record(STAT_BORROW, start, status == LOAN_OK, 1);
+    return status;
+}
+
+int return_book(int id) {
+    unsigned long long start = stats_now();    // Time the call
+    int status = set_loan_status(id, 0);       // Borrowed -> available
+    stats_record(STAT_RETURN, start, status == LOAN_OK, 1);
+    return status;
+}
+
+void borrowBook() {
+    init_user_pointers();                      // Refresh pointers (the library array moves when it grows)
+
+    int id;                                    // Variable for book ID
+
+    if (*book_count_ptr == 0) {                // Check if library is empty
+        printf("No books in the library.\n");  // Display message
+        return;                                 // Exit function
+    }
+
+    printf("Enter the book ID you desire to borrow: "); // Prompt for book ID
+    scanf("%d", &id);                          // Read book ID
+
+    int status = borrow_book(id);              // Try to borrow it
+    if (status == LOAN_NOT_FOUND) {            // If book not found
+        printf("The book with ID %d is not found.\n", id); // Display error message
+        return;                                 // Exit function
+    }
+    const Book *book = &library_ptr[find_book_by_id(id)]; // Book being borrowed
+    if (status == LOAN_OK) {                   // If book was available
+        journal_log_borrowed(id, 1);           // Record the change
+        printf("The book \"%s\" by %s is borrowed successfully.\n", // Confirm borrowing
+               book->title, author_dict_name(book->author_id));
+    } else {                                   // If book is already borrowed
+        printf("The book \"%s\" is already borrowed.\n", book->title); // Display message
+    }
+}
+
+void returnBook() {
+    init_user_pointers();                      // Refresh pointers (the library array moves when it grows)
+
+    int id;                                    // Variable for book ID
+
+    if (*book_count_ptr == 0) {                // Check if library is empty
+        printf("No books in the library.\n");  // Display message
+        return;                                 // Exit function
+    }
+
+    printf("Enter the book ID you want to return: "); // Prompt for book ID
+    scanf("%d", &id);                          // Read book ID
+
+    int status = return_book(id);              // Try to return it
+    if (status == LOAN_NOT_FOUND) {            // If book not found
+        printf("The book with ID %d is not found.\n", id); // Display error message
+        return;                                 // Exit function
+    }
+    const Book *book = &library_ptr[find_book_by_id(id)]; // Book being returned
+    if (status == LOAN_OK) {                   // If book was borrowed
+        journal_log_borrowed(id, 0);           // Record the change
+        printf("The book \"%s\" by %s is returned successfully.\n", // Confirm return
+               book->title, author_dict_name(book->author_id));
+    } else {                                   // If book is not borrowed
+        printf("The book \"%s\" is not currently borrowed.\n", book->title); // Display message
+    }
+}
+
+// ==================== ranked_search.h ====================
+#ifndef RANKED_SEARCH_H        // Include guard to prevent multiple inclusions
+#define RANKED_SEARCH_H        // Define the include guard macro
+
+// Ranked, typo-tolerant search over titles and authors.
+// The query is split into words. Candidates come from the trigram indexes:
+// books whose title or author shares enough trigrams with the query's most
+// selective word (one or two typos still leave most trigrams intact). Each
+// candidate is scored word by word against the words of its title and author:
+//   exact word 1.0, prefix of a word 0.8, one edit 0.75, two edits 0.5
+// plus RANKED_PHRASE_BONUS when the title contains the query as typed. The
+// best books are kept in a fixed-size heap, so memory does not grow with the
+// number of matches.
+#define RANKED_DEFAULT_RESULTS 10      // Results shown by the menu
+#define RANKED_MAX_RESULTS 100         // Largest number of results returned
+#define RANKED_MAX_WORDS 8             // Query words that are scored (the rest are ignored)
+#define RANKED_MAX_WORD_LEN 32         // Longer words are cut to this length
+#define RANKED_PHRASE_BONUS 1.0        // Added when the title contains the whole query
+
+// One ranked result
+typedef struct {
+    int id;                    // Book ID
+    double score;              // Higher is better
+} RankedHit;
+
+// Fills `hits` with up to `limit` books (at most RANKED_MAX_RESULTS), best first; returns how many
+int search_ranked(const char *query, int limit, RankedHit *hits);
+
+#endif // RANKED_SEARCH_H      // End of include guard
+
+// ==================== ranked_search.c ====================
+#include <stdlib.h>            // For qsort, abs functions
+#include <string.h>            // For memcmp function
+#include <ctype.h>             // For isalnum, tolower functions
+
+#include "ranked_search.h"     // Include our declarations
+#include "book.h"              // Include Book structure
+#include "admin.h"             // Include find_book_by_id and the slot map
+#include "title_index.h"       // Include the trigram indexes (candidate generation)
+#include "author_dict.h"       // Include interned author names
+#include "text_search.h"       // Include find_ignore_case (phrase bonus)
+#include "stats.h"             // Include operation timing
+
+// Lowercased words of a query
+typedef struct {
+    char text[RANKED_MAX_WORDS][RANKED_MAX_WORD_LEN + 1];
+    int length[RANKED_MAX_WORDS];
+    int count;
+} QueryWords;
+
+// State shared by the candidate visits of one search
+typedef struct {
+    const char *query;         // Query as typed (for the phrase bonus)
+    const QueryWords *words;   // Query words
+    const Book *books;         // Library array
+    RankedHit *heap;           // Min-heap of the best hits so far (worst at the root)
+    int size;                  // Hits in the heap
+    int limit;                 // Heap capacity
+    long long scored;          // Candidates scored
+} RankedSearch;
+
+// Copy the next lowercase letter/digit run of `*text` into `word`; returns its length (0 at the end)
+static int next_word(const char **text, char *word) {
+    const char *p = *text;
+    while (*p != '\0' && !isalnum((unsigned char) *p)) p++; // Skip spaces and punctuation
+    int length = 0;
+    for (; isalnum((unsigned char) *p); p++) {
+        if (length < RANKED_MAX_WORD_LEN) {
+            word[length++] = (char) tolower((unsigned char) *p);
+        }
+    }
+    word[length] = '\0';
+    *text = p;
+    return length;
+}
+
+// Typos tolerated in a word of this length
+static int allowed_edits(int length) {
+    return length <= 3 ? 0 : length <= 7 ? 1 : 2;
+}
+
+// Edit distance counting insertions, deletions, substitutions and swaps of
+// neighbouring letters ("smiht" -> "smith") as one edit each; returns max + 1
+// as soon as the distance must exceed `max`
+static int bounded_edit_distance(const char *a, int a_len, const char *b, int b_len, int max) {
+    if (abs(a_len - b_len) > max) {                // Length difference alone is too much
+        return max + 1;
+    }
+    int rows[3][RANKED_MAX_WORD_LEN + 1];          // Distances for a[0..i-2), a[0..i-1) and a[0..i)
+    int *before = rows[0], *previous = rows[1], *row = rows[2];
+    for (int j = 0; j <= b_len; j++) previous[j] = j;
+    for (int i = 1; i <= a_len; i++) {
+        int best = row[0] = i;                     // Smallest value in this row
+        for (int j = 1; j <= b_len; j++) {
+            int cost = previous[j - 1] + (a[i - 1] != b[j - 1]);
+            if (previous[j] + 1 < cost) cost = previous[j] + 1;
+            if (row[j - 1] + 1 < cost) cost = row[j - 1] + 1;
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && before[j - 2] + 1 < cost) {
+                cost = before[j - 2] + 1;          // Swapped neighbours
+            }
+            row[j] = cost;
+            if (cost < best) best = cost;
+        }
+        if (best > max) {                          // Every path already costs too much
+            return max + 1;
+        }
+        int *oldest = before;                      // Rotate the rows
+        before = previous;
+        previous = row;
+        row = oldest;
+    }
+    return previous[b_len];
+}
+
+// How well a query word matches one word of a title or author
+static double word_similarity(const char *q, int q_len, const char *w, int w_len) {
+    if (q_len == w_len && memcmp(q, w, (size_t) q_len) == 0) {
+        return 1.0;                                // Exact
+    }
+    if (q_len >= 3 && q_len < w_len && memcmp(q, w, (size_t) q_len) == 0) {
+        return 0.8;                                // Start of a longer word ("kingd" -> "kingdom")
+    }
+    int max = allowed_edits(q_len);
+    if (max == 0) {
+        return 0.0;
+    }
+    int distance = bounded_edit_distance(q, q_len, w, w_len, max);
+    return distance <= max ? 1.0 - 0.25 * distance : 0.0;
+}
+
+// Best similarity of each query word against the words of `text`, added into `best`
+static void match_words(const QueryWords *words, const char *text, double *best) {
+    char word[RANKED_MAX_WORD_LEN + 1];
+    int length;
+    while ((length = next_word(&text, word)) > 0) {
+        for (int q = 0; q < words->count; q++) {
+            if (best[q] < 1.0) {                   // Already exact: nothing better to find
+                double similarity = word_similarity(words->text[q], words->length[q], word, length);
+                if (similarity > best[q]) best[q] = similarity;
+            }
+        }
+    }
+}
+
+// 1 if hit `a` ranks below hit `b` (lower score, or same score and higher ID)
+static int ranks_below(const RankedHit *a, const RankedHit *b) {
+    return a->score < b->score || (a->score == b->score && a->id > b->id);
+}
+
+// Restore the heap below `i` (worst hit at the root)
+static void sift_down(RankedHit *heap, int size, int i) {
+    while (1) {
+        int worst = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && ranks_below(&heap[left], &heap[worst])) worst = left;
+        if (right < size && ranks_below(&heap[right], &heap[worst])) worst = right;
+        if (worst == i) {
+            return;
+        }
+        RankedHit swap = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = swap;
+        i = worst;
+    }
+}
+
+// Offer a hit to the heap; it is kept if there is room or it beats the worst one
+static void offer_hit(RankedSearch *search, RankedHit hit) {
+    for (int h = 0; h < search->size; h++) {       // Found through both title and author: keep once
+        if (search->heap[h].id == hit.id) {
+            return;
+        }
+    }
+    if (search->size < search->limit) {            // Room left: sift the new hit up
+        int i = search->size++;
+        search->heap[i] = hit;
+        while (i > 0 && ranks_below(&search->heap[i], &search->heap[(i - 1) / 2])) {
+            RankedHit swap = search->heap[i];
+            search->heap[i] = search->heap[(i - 1) / 2];
+            search->heap[(i - 1) / 2] = swap;
+            i = (i - 1) / 2;
+        }
+    } else if (ranks_below(&search->heap[0], &hit)) { // Replace the worst hit
+        search->heap[0] = hit;
+        sift_down(search->heap, search->size, 0);
+    }
+}
+
+// Score the book in a slot and offer it to the heap
+static void score_slot(RankedSearch *search, int slot) {
+    const Book *book = &search->books[slot];
+    double best[RANKED_MAX_WORDS] = {0};           // Best match of each query word
+    match_words(search->words, book->title, best);
+    match_words(search->words, author_dict_name(book->author_id), best);
+    double score = 0;
+    for (int q = 0; q < search->words->count; q++) score += best[q];
+    search->scored++;
+    if (score <= 0) {                              // Shared trigrams, but no word close enough
+        return;
+    }
+    if (find_ignore_case(book->title, search->query)) {
+        score += RANKED_PHRASE_BONUS;
+    }
+    RankedHit hit = { book->id, score };
+    offer_hit(search, hit);
+}
+
+// Candidate visit from the trigram index
+static void visit_candidate(int id, void *context) {
+    RankedSearch *search = context;
+    int slot = find_book_by_id(id);
+    if (slot != -1) {
+        score_slot(search, slot);
+    }
+}
+
+// Sort hits best first for qsort
+static int compare_hits(const void *a, const void *b) {
+    const RankedHit *x = a, *y = b;
+    return ranks_below(x, y) - ranks_below(y, x);
+}
+
+int search_ranked(const char *query, int limit, RankedHit *hits) {
+    unsigned long long start = stats_now();        // Time the search
+    QueryWords words;
+    words.count = 0;
+    const char *p = query;
+    int length;
+    char word[RANKED_MAX_WORD_LEN + 1];
+    while (words.count < RANKED_MAX_WORDS && (length = next_word(&p, word)) > 0) {
+        memcpy(words.text[words.count], word, (size_t) length + 1);
+        words.length[words.count++] = length;
+    }
+    if (limit > RANKED_MAX_RESULTS) limit = RANKED_MAX_RESULTS;
+    RankedSearch search = { query, &words, get_library_address(), hits, 0, limit, 0 };
+    if (words.count == 0 || limit <= 0) {
+        stats_record(STAT_SEARCH_RANKED, start, 0, 0);
+        return 0;
+    }
+
+    long long cost[RANKED_MAX_WORDS];              // Postings a candidate pass over each word reads
+    int indexable = 0;                             // Words long enough for trigrams
+    for (int q = 0; q < words.count; q++) {
+        cost[q] = -1;                              // Too short to lead
+        if (words.length[q] >= TRIGRAM_LEN) {
+            cost[q] = trigram_index_cost(TRIGRAM_TITLES, words.text[q]) +
+                      trigram_index_cost(TRIGRAM_AUTHORS, words.text[q]);
+            indexable++;
+        }
+    }
+    // Candidates come from the most selective word; if nothing close to it
+    // exists (a garbled word), the next most selective word leads instead.
+    while (search.size == 0) {
+        int pick = -1;
+        for (int q = 0; q < words.count; q++) {
+            if (cost[q] > 0 && (pick == -1 || cost[q] < cost[pick])) { // No shared trigram: cannot lead
+                pick = q;
+            }
+        }
+        if (pick == -1) {
+            break;
+        }
+        const char *lead = words.text[pick];       // Count filter: one typo (or swap) changes at most 4 trigrams
+        int min_shared = trigram_count(lead) - (TRIGRAM_LEN + 1) * allowed_edits(words.length[pick]);
+        trigram_index_similar(TRIGRAM_TITLES, lead, min_shared, visit_candidate, &search);
+        trigram_index_similar(TRIGRAM_AUTHORS, lead, min_shared, visit_candidate, &search);
+        cost[pick] = -1;                           // Tried
+    }
+    if (indexable == 0) {                          // Only short words: score every book
+        for (int i = next_live_slot(0); i != -1; i = next_live_slot(i + 1)) {
+            score_slot(&search, i);
+        }
+    }
+    qsort(hits, (size_t) search.size, sizeof(RankedHit), compare_hits);
+    stats_record(STAT_SEARCH_RANKED, start, search.size, search.scored);
+    return search.size;
+}
+
+// ==================== data_handler.h ====================
+#ifndef DATA_HANDLER_H         // Include guard to prevent multiple inclusions
+#define DATA_HANDLER_H         // Define the include guard macro
+
+#include <stdio.h>             // For FILE
+#include "book.h"              // Include header for Book structure
+#include "catalog_view.h"      // Include CatalogView (snapshots are written from a view)
+#include "scan.h"              // Include ScanQuery (filtered exports)
+
+// Function declarations for data handling
+// Loads book data from a file into the library (replaces its current contents)
+int load_books(const char *filename);
+
+// Bulk text import: the file is mapped, split at line boundaries and parsed by
+// several threads at once; the parsed books are then added in file order.
+#define IMPORT_MAX_THREADS 16          // Upper bound on parser threads
+#define IMPORT_MIN_CHUNK (1 << 20)     // Files are not split into chunks smaller than this
+#define IMPORT_MAX_REPORTED_ERRORS 20  // Bad lines printed per import (all are counted)
+
+// Outcome of a bulk import or a merge
+typedef struct {
+    long long lines;           // Lines read (blank lines included)
+    long long imported;        // Books added to the library
+    long long errors;          // Lines skipped: malformed fields or an ID already in use
+    long long duplicates;      // Lines skipped by a merge: the library already has the book
+} ImportStats;
+
+// Adds every book in a text file to the library (after emptying it if `replace`)
+int bulk_import_books(const char *filename, int replace, ImportStats *stats);
+// Saves the library's book data to a file
+int save_books(const char *filename);
+
+// Streaming merge and export, for files larger than memory.
+// A merge reads the file in blocks of STREAM_BLOCK_SIZE on a reader thread
+// that parses each block while the caller adds the previous one, with at most
+// STREAM_BLOCKS blocks in flight. A book is skipped as a duplicate when the
+// library (or an earlier line) already has the same title, author and year,
+// compared ignoring case and runs of whitespace; the comparison uses a set of
+// 64-bit hashes (16 bytes per book at most), not the strings. Merged books get
+// new IDs: the IDs in a feed belong to another catalog.
+// An export walks a catalog view, writes the books that match a query and
+// never holds more than one render buffer of output.
+#define STREAM_BLOCK_SIZE (256 * 1024)  // Bytes read per block (also the longest line accepted)
+#define STREAM_BLOCKS 3                 // Blocks in flight between the reader and the caller
+#define STREAM_MIN_LINE 9               // Shortest valid line ("1;T;A;1;0"), which bounds the rows per block
+#define STREAM_EXPORT_BUFFER (1 << 20)  // stdio buffer for exports (render blocks are written through it)
+#define STREAM_EXPORT_PROGRESS 65536    // Books looked at between export progress reports
+
+// Progress of a merge or an export, reported after each block (merge) or
+// every STREAM_EXPORT_PROGRESS books (export), and once at the end
+typedef struct {
+    long long done;            // Bytes of the file merged, or books of the view looked at
+    long long total;           // Size of the file, or books in the view
+    long long books;           // Books added, or written
+} StreamProgress;
+typedef void (*StreamProgressFn)(const StreamProgress *progress, void *context);
+
+// Adds the books of a text file that the library does not have yet (progress may be NULL)
+// Returns 1 if the whole file was read, 0 if it could not be opened or read, or memory ran out.
+int stream_merge_books(const char *filename, ImportStats *stats, StreamProgressFn progress, void *context);
+// Writes the books of `view` that match `query` to `out` in a RENDER_ format
+// (NULL view: the catalog as it is now). Returns the number written, or -1 on failure.
+long long stream_export_books(FILE *out, CatalogView *view, const ScanQuery *query, int format,
+                              StreamProgressFn progress, void *context);
+
+// Binary snapshot format (native byte order):
+//   SnapshotHeader, then book_count fixed-width SnapshotRecords, then the
+//   author table (author_count heap offsets, one per distinct author), then
+//   the loan ledger as three columns of loan_count entries (times as unsigned
+//   ints, book IDs as ints, kinds as bytes), then a heap of null-terminated
+//   strings: every title, then every author once.
+// Loading maps the file and uses the strings where they lie, without parsing.
+#define SNAPSHOT_MAGIC "LIBSNAP"   // First 8 bytes of every snapshot (with its null terminator)
+#define SNAPSHOT_VERSION 3         // Bumped whenever the layout changes
+#define SNAPSHOT_OLDEST_VERSION 1  // Oldest version still loaded (version 2 is version 3 without loans)
+
+typedef struct {
+    char magic[8];                 // SNAPSHOT_MAGIC
+    unsigned int version;          // SNAPSHOT_VERSION
+    unsigned int record_size;      // sizeof(SnapshotRecord), to catch mismatched builds
+    unsigned long long book_count; // Number of records
+    unsigned long long author_count; // Entries in the author table
+    unsigned long long heap_size;  // Bytes in the string heap
+    unsigned long long checksum;   // Checksum of the records and the heap
+    int next_id;                   // Next ID to hand out
+    unsigned int generation;       // Increases with every snapshot (journals record which one they follow)
+    unsigned long long loan_count; // Events in the loan ledger (zero before version 3)
+    int reserved[2];               // Zero; room for later fields
+} SnapshotHeader;
+
+typedef struct {
+    int id;                        // Book ID
+    int publication_year;          // Year the book was published
+    unsigned long long title_offset;  // Offset of the title in the string heap
+    unsigned int author;           // Index into the author table
+    unsigned int flags;            // Bit 0: borrowed
+} SnapshotRecord;
+
+// Version 1 layout (before authors were interned): no author table, no loan
+// columns, and every record holds its author's heap offset. Still loaded, so
+// a library saved by an older build survives the upgrade.
+typedef struct {
+    char magic[8];                 // SNAPSHOT_MAGIC
+    unsigned int version;          // 1
+    unsigned int record_size;      // sizeof(SnapshotRecordV1)
+    unsigned long long book_count; // Number of records
+    unsigned long long heap_size;  // Bytes in the string heap
+    unsigned long long checksum;   // Checksum of the records and the heap
+    int next_id;                   // Next ID to hand out
+    unsigned int generation;       // Generation the journal follows
+    int reserved[4];               // Zero
+} SnapshotHeaderV1;
+
+typedef struct {
+    int id;                        // Book ID
+    int publication_year;          // Year the book was published
+    unsigned long long title_offset;  // Offset of the title in the string heap
+    unsigned long long author_offset; // Offset of the author in the string heap
+    unsigned int flags;            // Bit 0: borrowed
+    unsigned int reserved;         // Zero
+} SnapshotRecordV1;
+
+// Loads a binary snapshot into the library (replaces its current contents)
+int load_snapshot(const char *filename);
+// Saves the library as a binary snapshot (written to a temporary file, then renamed)
+int save_snapshot(const char *filename);
+// Saves a view as snapshot `generation` without changing get_snapshot_generation()
+// (for a background thread: the library may change meanwhile)
+int save_snapshot_view(const char *filename, CatalogView *view, unsigned int generation);
+// Generation of the snapshot the library was last loaded from or saved to (0 = none)
+unsigned int get_snapshot_generation();
+void set_snapshot_generation(unsigned int generation);
+
+#endif // DATA_HANDLER_H       // End of include guard
+
+// ==================== data_handler.c ====================
+#include <stdio.h>             // For fopen, fclose, fscanf, fprintf functions
+#include <stdlib.h>            // For general utilities (though not directly used here)
+#include <string.h>            // For strcspn, memcmp, strlen functions
+#include <fcntl.h>             // For open function
+#include <unistd.h>            // For close function
+#include <sys/mman.h>          // For mmap, munmap functions
+#include <sys/stat.h>          // For fstat function
+#include <limits.h>            // For INT_MAX, INT_MIN constants
+#include <pthread.h>           // For pthread_create, pthread_join functions
+#include <errno.h>             // For EINTR
+
+#include "data_handler.h"      // Include our data handler declarations
+#include "admin.h"             // Include append_book and clear_library
+#include "author_dict.h"       // Include interned author names
+#include "scan.h"              // Include ScanFilter (filtered exports)
+#include "loan_ledger.h"       // Include the loan ledger (saved in snapshots)
+#include "render.h"            // Include the renderer used for text export
+#include "stats.h"             // Include operation timing
+
+#define SNAPSHOT_WRITE_BUFFER (1 << 20) // stdio buffer used while writing a snapshot
+
+static unsigned int snapshot_generation = 0; // Generation of the last snapshot loaded or saved
+static void *snapshot_map = NULL;   // Mapping of the loaded snapshot (the library points into it)
+static size_t snapshot_map_size = 0; // Size of that mapping
+
+// Unmap the previously loaded snapshot once the library no longer uses it
+static void release_snapshot_map() {
+    if (snapshot_map != NULL) {
+        munmap(snapshot_map, snapshot_map_size);
+        snapshot_map = NULL;
+        snapshot_map_size = 0;
+    }
+}
+
+// Running 64-bit checksum: FNV-1a over 8-byte words of the byte stream.
+// Bytes are buffered until a word is complete, so the result does not depend
+// on how the stream is split into checksum_update calls.
+typedef struct {
+    unsigned long long hash;       // Hash of every complete word so far
+    unsigned char pending[8];      // Bytes of the word being assembled
+    size_t pending_count;          // Number of bytes in pending
+} Checksum;
+
+#define FNV_PRIME 1099511628211ULL              // FNV-1a 64-bit prime
+#define FNV_OFFSET 14695981039346656037ULL      // FNV-1a 64-bit offset basis
+
+// Mix one 8-byte word into the hash
+static void checksum_word(Checksum *sum, const unsigned char *bytes) {
+    unsigned long long word;
+    memcpy(&word, bytes, 8);                         // Unaligned-safe load
+    sum->hash = (sum->hash ^ word) * FNV_PRIME;
+}
+
+// Add `size` bytes to the checksum
+static void checksum_update(Checksum *sum, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    size_t i = 0;
+    while (sum->pending_count > 0 && i < size) {     // Finish a word started by an earlier call
+        sum->pending[sum->pending_count++] = bytes[i++];
+        if (sum->pending_count == 8) {
+            checksum_word(sum, sum->pending);
+            sum->pending_count = 0;
+        }
+    }
+    for (; i + 8 <= size; i += 8) {                  // Whole words straight from the data
+        checksum_word(sum, bytes + i);
+    }
+    for (; i < size; i++) {                          // Keep the leftover bytes for later
+        sum->pending[sum->pending_count++] = bytes[i];
+    }
+}
+
+// Mix in the last partial word and return the final checksum
+static unsigned long long checksum_finish(Checksum *sum) {
+    for (size_t i = 0; i < sum->pending_count; i++) {
+        sum->hash = (sum->hash ^ sum->pending[i]) * FNV_PRIME;
+    }
+    sum->pending_count = 0;
+    return sum->hash;
+}
+
+// Function to load books from a text file
+int load_books(const char *filename) {
+    ImportStats stats;                         // Counts are not needed here
+    return bulk_import_books(filename, 1, &stats); // Replace the library with the file's books
+}
+
+// One parsed line, pointing into the mapped file
+typedef struct {
+    const char *title;         // Title characters (not null-terminated)
+    const char *author;        // Author characters (not null-terminated)
+    unsigned int title_length; // Length of the title
+    unsigned int author_length; // Length of the author
+    int id;                    // Book ID
+    int year;                  // Publication year
+    int is_borrowed;           // Borrowed status (0 or 1)
+    long long line;            // Line number within the chunk (from 1)
+} ImportRow;
+
+// One bad line within a chunk
+typedef struct {
+    long long line;            // Line number within the chunk (from 1)
+    const char *message;       // What is wrong with it
+} ImportError;
+
+// Work and results of one parser thread
+typedef struct {
+    const char *start;         // First byte of the chunk (at the start of a line)
+    const char *end;           // One past its last byte (just after a newline, or end of file)
+    ImportRow *rows;           // Parsed lines, in file order
+    long long row_count;       // Number of parsed lines
+    long long row_capacity;    // Rows allocated
+    ImportError errors[IMPORT_MAX_REPORTED_ERRORS]; // First bad lines of the chunk
+    long long error_count;     // Every bad line of the chunk (may exceed the stored ones)
+    long long line_count;      // Lines in the chunk
+    int out_of_memory;         // Set if rows could not grow
+} ImportChunk;
+
+// Parse a decimal integer filling the whole field [p, end); returns 0 if it is not one
+static int parse_int_field(const char *p, const char *end, int *value) {
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {       // Optional sign
+        negative = (*p == '-');
+        p++;
+    }
+    if (p == end) {                                  // No digits
+        return 0;
+    }
+    long long v = 0;
+    for (; p < end; p++) {
+        unsigned int digit = (unsigned int) (*p - '0');
+        if (digit > 9) {                             // Not a digit
+            return 0;
+        }
+        v = v * 10 + digit;
+        if (v > (long long) INT_MAX + 1) {           // Too large for an int
+            return 0;
+        }
+    }
+    v = negative ? -v : v;
+    if (v > INT_MAX || v < INT_MIN) {
+        return 0;
+    }
+    *value = (int) v;
+    return 1;
+}
+
+// Split one line (without its newline) into a row
+// Layout: ID;Title;Author;Year;IsBorrowed. ID is taken from the left and
+// Author, Year and IsBorrowed from the right, so a title may itself contain
+// ';' (an author may not). Carriage returns are refused, as by add_book().
+// Returns NULL on success, or what is wrong.
+static const char *parse_line(const char *p, const char *end, ImportRow *row) {
+    const char *first = memchr(p, ';', (size_t) (end - p)); // End of the ID
+    if (first == NULL) {
+        return "expected 5 fields separated by ';'";
+    }
+    const char *seps[3];                             // Last three separators, right to left
+    const char *q = end;
+    for (int n = 0; n < 3; n++) {
+        do {
+            q--;
+        } while (q > first && *q != ';');
+        if (q <= first) {
+            return "expected 5 fields separated by ';'";
+        }
+        seps[n] = q;
+    }
+    if (!parse_int_field(p, first, &row->id) || row->id <= 0) {
+        return "ID is not a positive number";
+    }
+    if (!parse_int_field(seps[1] + 1, seps[0], &row->year)) {
+        return "year is not a number";
+    }
+    if (seps[0] + 2 != end || (seps[0][1] != '0' && seps[0][1] != '1')) {
+        return "borrowed status is not 0 or 1";
+    }
+    row->is_borrowed = seps[0][1] - '0';
+    row->title = first + 1;
+    row->title_length = (unsigned int) (seps[2] - row->title);
+    row->author = seps[2] + 1;
+    row->author_length = (unsigned int) (seps[1] - row->author);
+    if (row->title_length == 0 || row->author_length == 0) {
+        return "title and author must not be empty";
+    }
+    if (memchr(row->title, '\r', row->title_length) != NULL || memchr(row->author, '\r', row->author_length) != NULL) {
+        return "title and author must not contain a line break";
+    }
+    return NULL;
+}
+
+// Thread body: parse every line of one chunk
+static void *parse_chunk(void *arg) {
+    ImportChunk *chunk = arg;
+    const char *p = chunk->start;
+    while (p < chunk->end) {
+        const char *newline = memchr(p, '\n', (size_t) (chunk->end - p));
+        const char *line_end = newline ? newline : chunk->end; // Last line may lack a newline
+        const char *next = newline ? newline + 1 : chunk->end;
+        chunk->line_count++;
+        if (line_end > p && line_end[-1] == '\r') {  // Accept CRLF files
+            line_end--;
+        }
+        if (line_end == p) {                         // Skip blank lines
+            p = next;
+            continue;
+        }
+        if (chunk->row_count == chunk->row_capacity) { // Grow the row array
+            long long capacity = chunk->row_capacity ? chunk->row_capacity * 2 : 1024;
+            ImportRow *rows = realloc(chunk->rows, (size_t) capacity * sizeof(ImportRow));
+            if (rows == NULL) {
+                chunk->out_of_memory = 1;
+                return NULL;
+            }
+            chunk->rows = rows;
+            chunk->row_capacity = capacity;
+        }
+        ImportRow *row = &chunk->rows[chunk->row_count];
+        const char *message = parse_line(p, line_end, row);
+        if (message == NULL) {
+            row->line = chunk->line_count;
+            chunk->row_count++;
+        } else {
+            if (chunk->error_count < IMPORT_MAX_REPORTED_ERRORS) {
+                chunk->errors[chunk->error_count].line = chunk->line_count;
+                chunk->errors[chunk->error_count].message = message;
+            }
+            chunk->error_count++;
+        }
+        p = next;
+    }
+    return NULL;
+}
+
+// Print one bad line, unless enough have been printed already
+static void report_import_error(const char *filename, long long line, const char *message, long long *reported) {
+    if ((*reported)++ < IMPORT_MAX_REPORTED_ERRORS) {
+        fprintf(stderr, "%s:%lld: %s\n", filename, line, message);
+    }
+}
+
+// Function to import a semicolon-separated text file in bulk
+// The file is mapped and cut into chunks at line boundaries; each chunk is
+// parsed by its own thread. The rows are then added in file order, so the
+// library looks the same as after a line-by-line load. Lines that cannot be
+// parsed, or whose ID is already in the library (or earlier in the file), are
+// skipped and reported as "file:line: reason". Returns 1 if the file was
+// read, 0 if it could not be opened or memory ran out. With `replace`, the
+// library is only emptied once the file has been mapped and parsed, so a
+// file that cannot be read leaves it as it was.
+static int import_text_file(const char *filename, int replace, ImportStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {                                    // A missing file is normal on the first run
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t) info.st_size;
+    if (size == 0) {                                 // Nothing to import
+        close(fd);
+        if (replace) {
+            clear_library();                         // An empty file is an empty library
+            release_snapshot_map();
+        }
+        return 1;
+    }
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0); // Map the whole file
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);            // Read ahead aggressively
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);       // One chunk per core, but not tiny ones
+    int chunk_count = (int) (size / IMPORT_MIN_CHUNK) + 1;
+    if (cpus > 0 && chunk_count > cpus) chunk_count = (int) cpus;
+    if (chunk_count > IMPORT_MAX_THREADS) chunk_count = IMPORT_MAX_THREADS;
+
+    ImportChunk chunks[IMPORT_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    const char *file_end = data + size;
+    const char *start = data;
+    for (int c = 0; c < chunk_count; c++) {          // Cut at the first newline after each even split
+        const char *end = c == chunk_count - 1 ? file_end : data + size / (size_t) chunk_count * (size_t) (c + 1);
+        if (end < start) end = start;
+        if (end < file_end) {
+            const char *newline = memchr(end, '\n', (size_t) (file_end - end));
+            end = newline ? newline + 1 : file_end;
+        }
+        chunks[c].start = start;
+        chunks[c].end = end;
+        start = end;
+    }
+
+    pthread_t threads[IMPORT_MAX_THREADS];
+    int started[IMPORT_MAX_THREADS] = {0};
+    for (int c = 1; c < chunk_count; c++) {          // Chunk 0 is parsed by this thread
+        started[c] = pthread_create(&threads[c], NULL, parse_chunk, &chunks[c]) == 0;
+    }
+    parse_chunk(&chunks[0]);
+    for (int c = 1; c < chunk_count; c++) {
+        if (started[c]) {
+            pthread_join(threads[c], NULL);
+        } else {
+            parse_chunk(&chunks[c]);                 // Could not start a thread: parse it here
+        }
+    }
+
+    long long total_rows = 0;
+    int ok = 1;
+    for (int c = 0; c < chunk_count; c++) {
+        total_rows += chunks[c].row_count;
+        ok = ok && !chunks[c].out_of_memory;
+    }
+    if (ok && replace) {                             // The new books are ready: now replace the old ones
+        clear_library();
+        release_snapshot_map();                      // Nothing points into an old snapshot any more
+    }
+    long long wanted = *get_book_count_address() + total_rows;
+    if (ok && (wanted > INT_MAX || !reserve_books((int) total_rows))) { // Size the library once
+        ok = 0;
+    }
+
+    long long first_line = 1;                        // File line number of the chunk's first line
+    long long reported = 0;                          // Bad lines printed so far
+    for (int c = 0; c < chunk_count && ok; c++) {    // Add rows and report errors in file order
+        ImportChunk *chunk = &chunks[c];
+        long long stored_errors = chunk->error_count < IMPORT_MAX_REPORTED_ERRORS ? chunk->error_count : IMPORT_MAX_REPORTED_ERRORS;
+        long long e = 0;
+        for (long long r = 0; r < chunk->row_count; r++) {
+            const ImportRow *row = &chunk->rows[r];
+            for (; e < stored_errors && chunk->errors[e].line < row->line; e++) { // Earlier bad lines first
+                report_import_error(filename, first_line - 1 + chunk->errors[e].line, chunk->errors[e].message, &reported);
+            }
+            if (find_book_by_id(row->id) != -1) {    // ID collision
+                report_import_error(filename, first_line - 1 + row->line, "ID is already in use", &reported);
+                stats->errors++;
+                continue;
+            }
+            const char *title = store_string_n(row->title, row->title_length);
+            unsigned int author = author_dict_intern_n(row->author, row->author_length); // Copied only the first time it is seen
+            if (title == NULL || author == AUTHOR_INVALID ||
+                append_book_in_place(row->id, title, author, row->year, row->is_borrowed) == NULL) {
+                ok = 0;                              // Out of memory: stop here
+                break;
+            }
+            stats->imported++;
+        }
+        for (; e < stored_errors; e++) {             // Bad lines after the last good one
+            report_import_error(filename, first_line - 1 + chunk->errors[e].line, chunk->errors[e].message, &reported);
+        }
+        reported += chunk->error_count - stored_errors; // Count the ones not stored
+        stats->errors += chunk->error_count;
+        first_line += chunk->line_count;
+    }
+    for (int c = 0; c < chunk_count; c++) {
+        stats->lines += chunks[c].line_count;
+        free(chunks[c].rows);
+    }
+    if (reported > IMPORT_MAX_REPORTED_ERRORS) {
+        fprintf(stderr, "%s: %lld more bad lines not shown\n", filename, reported - IMPORT_MAX_REPORTED_ERRORS);
+    }
+    munmap(data, size);                              // Every string has been copied out
+    return ok;
+}
+
+// Timed wrapper (see stats.h)
+int bulk_import_books(const char *filename, int replace, ImportStats *stats) {
+    unsigned long long start = stats_now();          // Time the whole import
+    int ok = import_text_file(filename, replace, stats);
+    stats_record(STAT_LOAD, start, stats->imported, stats->lines);
+    return ok;
+}
+
+// Function to save books to a text file
+int save_books(const char *filename) {
+    unsigned long long start = stats_now();    // Time the save
+    FILE *file = fopen(filename, "w");         // Open file for writing (clears old content)
+    if (file == NULL) {                        // If file cannot be opened for writing
+        perror("Error opening file for saving"); // Print error message with system error info
+        return 0;                              // Return 0 to indicate save failure
+    }
+
+    CatalogView *view = catalog_view_open();   // Books to save, as they are now
+    if (view == NULL) {
+        fclose(file);
+        return 0;
+    }
+    Renderer r;                                // Formats records into one large buffer
+    render_begin(&r, file, RENDER_TEXT, 0, -1); // ID;Title;Author;Year;IsBorrowed lines
+    const Book *book;
+    int borrowed;
+    while ((book = catalog_view_next(view, &borrowed)) != NULL) { // Loop through all books to save
+        render_book(&r, book, borrowed);
+    }
+    int ok = render_end(&r) && catalog_view_ok(view); // Write the last block
+    ok = (fclose(file) == 0) && ok;            // Close the file
+    catalog_view_close(view);
+    if (!ok) {
+        perror("Error writing file");
+    }
+    stats_record(STAT_SAVE, start, ok ? r.shown : 0, *get_book_count_address());
+    return ok;                                 // Return 1 to indicate successful saving
+}
+
+// Set of merge keys: open addressing over 64-bit hashes, kept at most half
+// full (0 marks an empty entry)
+typedef struct {
+    unsigned long long *keys;  // The table
+    size_t capacity;           // Entries (a power of two, 0 before the first reserve)
+    size_t count;              // Keys stored
+} MergeKeys;
+
+// Make room for `count` keys; returns 0 if out of memory
+static int merge_keys_reserve(MergeKeys *set, size_t count) {
+    if (count * 2 <= set->capacity) {                // Still at most half full
+        return 1;
+    }
+    size_t capacity = set->capacity ? set->capacity : 1024;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    unsigned long long *keys = calloc(capacity, sizeof(unsigned long long));
+    if (keys == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < set->capacity; i++) {     // Re-insert every key
+        if (set->keys[i] != 0) {
+            size_t pos = set->keys[i] & (capacity - 1);
+            while (keys[pos] != 0) {                 // Linear probing
+                pos = (pos + 1) & (capacity - 1);
+            }
+            keys[pos] = set->keys[i];
+        }
+    }
+    free(set->keys);
+    set->keys = keys;
+    set->capacity = capacity;
+    return 1;
+}
+
+// Add a key (room must have been reserved); returns 1 if it is new, 0 if it was there
+static int merge_keys_add(MergeKeys *set, unsigned long long key) {
+    size_t pos = key & (set->capacity - 1);
+    while (set->keys[pos] != 0) {
+        if (set->keys[pos] == key) {
+            return 0;
+        }
+        pos = (pos + 1) & (set->capacity - 1);
+    }
+    set->keys[pos] = key;
+    set->count++;
+    return 1;
+}
+
+// Mix `length` bytes of text into a hash as normalize_author would write
+// them: lowercase, runs of whitespace as one space, no outer whitespace
+static unsigned long long hash_folded(unsigned long long hash, const char *text, size_t length) {
+    int pending_space = 0;                           // Saw whitespace since the last word
+    int started = 0;                                 // Saw a character that is not whitespace
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) text[i];
+        if (c == ' ' || (unsigned char) (c - '\t') < 5) { // isspace in the C locale, without the call
+            pending_space = started;                 // Ignore leading whitespace
+            continue;
+        }
+        if (pending_space) {
+            hash = (hash ^ ' ') * FNV_PRIME;
+            pending_space = 0;
+        }
+        if ((unsigned char) (c - 'A') < 26) {        // tolower in the C locale
+            c |= 0x20;
+        }
+        hash = (hash ^ c) * FNV_PRIME;
+        started = 1;
+    }
+    return hash * FNV_PRIME;                         // A zero byte ends the field
+}
+
+// Key a merge compares books by: title, author and year, ignoring case and spacing
+// Two different books share a key with odds of about 2^-64 per pair.
+static unsigned long long merge_key(const char *title, size_t title_length, const char *author, size_t author_length,
+                                    int year) {
+    unsigned long long hash = hash_folded(FNV_OFFSET, title, title_length);
+    hash = hash_folded(hash, author, author_length);
+    hash = (hash ^ (unsigned int) year) * FNV_PRIME;
+    hash ^= hash >> 33;                              // Spread the bits into the low ones the table uses
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash != 0 ? hash : 1;                     // 0 marks an empty entry
+}
+
+// Add the key of every book already in the library
+static int seed_merge_keys(MergeKeys *keys) {
+    const Book *library = get_library_address();
+    const int *ids = get_book_id_column();
+    int slot_count = get_slot_count();
+    if (!merge_keys_reserve(keys, (size_t) *get_book_count_address())) {
+        return 0;
+    }
+    for (int slot = 0; slot < slot_count; slot++) {
+        if (ids[slot] == 0) {                        // Tombstone
+            continue;
+        }
+        const char *title = library[slot].title;
+        const char *author = author_dict_name(library[slot].author_id);
+        merge_keys_add(keys, merge_key(title, strlen(title), author, strlen(author), library[slot].publication_year));
+    }
+    return 1;
+}
+
+// One block of a merge: whole lines of the file and their parsed rows
+typedef struct {
+    char *text;                // STREAM_BLOCK_SIZE bytes
+    ImportChunk chunk;         // Rows and errors of the lines in text (rows never need to grow)
+    long long first_line;      // File line number of the block's first line
+    long long done;            // Bytes of the file up to the end of the block's last line
+    int last;                  // Set on the last block (end of file or a read error)
+    int full;                  // Set from when the reader hands the block over until the caller is done with it
+} StreamBlock;
+
+// State of a merge shared by the reader thread and the caller
+typedef struct {
+    int fd;                    // The file
+    StreamBlock blocks[STREAM_BLOCKS]; // Filled by the reader in turn, added by the caller in the same turn
+    char *carry;               // Unfinished last line of the previous block
+    size_t carry_length;       // Bytes in carry
+    int skipping;              // Discarding the rest of a line longer than a block
+    long long next_line;       // File line number of the next block's first line
+    long long read_bytes;      // Bytes read from the file so far
+    int read_failed;           // A read error ended the file early
+    int stopping;              // Set by the caller to make the reader stop early
+    pthread_mutex_t lock;      // Guards `full` and `stopping`
+    pthread_cond_t changed;    // A block was filled or handed back, or stopping was set
+} StreamReader;
+
+// Last newline in [start, end), or NULL
+static const char *last_newline(const char *start, const char *end) {
+    while (end > start) {
+        if (*--end == '\n') {
+            return end;
+        }
+    }
+    return NULL;
+}
+
+// Read the next block of the file and parse its whole lines
+// The block starts with the previous block's unfinished line, so no line is
+// split; a line that does not fit in a block at all is reported and skipped.
+static void fill_block(StreamReader *reader, StreamBlock *block) {
+    ImportChunk *chunk = &block->chunk;
+    char *text = block->text;
+    size_t used = reader->carry_length;
+    memcpy(text, reader->carry, used);
+    int end_of_file = 0;
+    while (used < STREAM_BLOCK_SIZE) {               // Fill the block
+        ssize_t n = read(reader->fd, text + used, STREAM_BLOCK_SIZE - used);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            reader->read_failed = n < 0;
+            end_of_file = 1;
+            break;
+        }
+        used += (size_t) n;
+        reader->read_bytes += n;
+    }
+    chunk->row_count = 0;
+    chunk->error_count = 0;
+    chunk->line_count = 0;
+    const char *start = text;                        // First byte of the block's first whole line
+    const char *end = text + used;                   // One past its last whole line
+    if (reader->skipping) {                          // Rest of a line longer than a block
+        const char *newline = memchr(text, '\n', used);
+        start = newline != NULL ? newline + 1 : end;
+        reader->skipping = newline == NULL;
+    }
+    if (!end_of_file) {                              // The last line may go on in the next block
+        const char *newline = last_newline(start, end);
+        if (newline != NULL) {
+            end = newline + 1;
+        } else if (start == text) {                  // A whole block without a newline
+            chunk->errors[0] = (ImportError) { 1, "line is longer than a block" };
+            chunk->error_count = 1;
+            chunk->line_count = 1;
+            reader->skipping = 1;
+            start = end;
+        } else {
+            end = start;
+        }
+    }
+    reader->carry_length = (size_t) (text + used - end);
+    memcpy(reader->carry, end, reader->carry_length);
+    chunk->start = start;
+    chunk->end = end;
+    parse_chunk(chunk);
+    block->first_line = reader->next_line;
+    reader->next_line += chunk->line_count;
+    block->done = reader->read_bytes - (long long) reader->carry_length;
+    block->last = end_of_file;
+}
+
+// Reader thread: fill the blocks in turn, waiting while the next one is still in use
+static void *read_blocks(void *arg) {
+    StreamReader *reader = arg;
+    for (int b = 0; ; b = (b + 1) % STREAM_BLOCKS) {
+        StreamBlock *block = &reader->blocks[b];
+        pthread_mutex_lock(&reader->lock);
+        while (block->full && !reader->stopping) {
+            pthread_cond_wait(&reader->changed, &reader->lock);
+        }
+        int stopping = reader->stopping;
+        pthread_mutex_unlock(&reader->lock);
+        if (stopping) {
+            break;
+        }
+        fill_block(reader, block);
+        int last = block->last;
+        pthread_mutex_lock(&reader->lock);
+        block->full = 1;                             // Hand it to the caller
+        pthread_cond_broadcast(&reader->changed);
+        pthread_mutex_unlock(&reader->lock);
+        if (last) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Add the rows of one block that are not duplicates, reporting bad lines in file order
+static int merge_block(const char *filename, const StreamBlock *block, MergeKeys *keys, ImportStats *stats,
+                       long long *reported) {
+    const ImportChunk *chunk = &block->chunk;
+    stats->lines += chunk->line_count;
+    if (*get_book_count_address() + chunk->row_count > INT_MAX ||
+        !merge_keys_reserve(keys, keys->count + (size_t) chunk->row_count) ||
+        !reserve_books((int) chunk->row_count)) {    // Room for the whole block up front
+        return 0;
+    }
+    int *next_id = get_next_id_address();
+    long long stored_errors = chunk->error_count < IMPORT_MAX_REPORTED_ERRORS ? chunk->error_count : IMPORT_MAX_REPORTED_ERRORS;
+    long long e = 0;
+    for (long long r = 0; r < chunk->row_count; r++) {
+        const ImportRow *row = &chunk->rows[r];
+        for (; e < stored_errors && chunk->errors[e].line < row->line; e++) { // Earlier bad lines first
+            report_import_error(filename, block->first_line - 1 + chunk->errors[e].line, chunk->errors[e].message, reported);
+        }
+        unsigned long long key = merge_key(row->title, row->title_length, row->author, row->author_length, row->year);
+        if (!merge_keys_add(keys, key)) {            // The library already has it
+            stats->duplicates++;
+            continue;
+        }
+        const char *title = store_string_n(row->title, row->title_length);
+        unsigned int author = author_dict_intern_n(row->author, row->author_length);
+        if (title == NULL || author == AUTHOR_INVALID ||
+            append_book_in_place(*next_id, title, author, row->year, row->is_borrowed) == NULL) { // Takes the next ID
+            return 0;
+        }
+        stats->imported++;
+    }
+    for (; e < stored_errors; e++) {                 // Bad lines after the last good one
+        report_import_error(filename, block->first_line - 1 + chunk->errors[e].line, chunk->errors[e].message, reported);
+    }
+    *reported += chunk->error_count - stored_errors; // Count the ones not stored
+    stats->errors += chunk->error_count;
+    return 1;
+}
+
+// Function to merge a text file into the library, one block at a time
+// Memory stays at STREAM_BLOCKS blocks plus the key set, however large the
+// file. The caller adds each block while the reader thread parses the next.
+int stream_merge_books(const char *filename, ImportStats *stats, StreamProgressFn progress, void *context) {
+    unsigned long long start = stats_now();          // Time the whole merge
+    memset(stats, 0, sizeof(*stats));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat info;
+    StreamProgress state = { 0, fstat(fd, &info) == 0 ? (long long) info.st_size : 0, 0 };
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);  // Read ahead aggressively
+
+    StreamReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.fd = fd;
+    reader.next_line = 1;
+    reader.carry = malloc(STREAM_BLOCK_SIZE);
+    int ok = reader.carry != NULL;
+    long long row_capacity = STREAM_BLOCK_SIZE / STREAM_MIN_LINE + 1; // Every row takes a line of STREAM_MIN_LINE bytes or more
+    for (int b = 0; b < STREAM_BLOCKS; b++) {
+        reader.blocks[b].text = malloc(STREAM_BLOCK_SIZE);
+        reader.blocks[b].chunk.rows = malloc((size_t) row_capacity * sizeof(ImportRow));
+        reader.blocks[b].chunk.row_capacity = row_capacity;
+        ok = ok && reader.blocks[b].text != NULL && reader.blocks[b].chunk.rows != NULL;
+    }
+    MergeKeys keys = { NULL, 0, 0 };
+    ok = ok && seed_merge_keys(&keys);
+
+    pthread_mutex_init(&reader.lock, NULL);
+    pthread_cond_init(&reader.changed, NULL);
+    pthread_t thread;
+    int threaded = ok && pthread_create(&thread, NULL, read_blocks, &reader) == 0;
+    long long reported = 0;                          // Bad lines printed so far
+    for (int b = 0; ok; b = (b + 1) % STREAM_BLOCKS) {
+        StreamBlock *block = &reader.blocks[b];
+        if (threaded) {                              // Wait for the reader
+            pthread_mutex_lock(&reader.lock);
+            while (!block->full) {
+                pthread_cond_wait(&reader.changed, &reader.lock);
+            }
+            pthread_mutex_unlock(&reader.lock);
+        } else {
+            fill_block(&reader, block);              // Could not start a thread: read it here
+        }
+        ok = merge_block(filename, block, &keys, stats, &reported);
+        int last = block->last;
+        state.done = block->done;
+        if (threaded) {                              // Hand the block back
+            pthread_mutex_lock(&reader.lock);
+            block->full = 0;
+            pthread_cond_broadcast(&reader.changed);
+            pthread_mutex_unlock(&reader.lock);
+        }
+        state.books = stats->imported;
+        if (progress != NULL) {
+            progress(&state, context);
+        }
+        if (last) {
+            break;
+        }
+    }
+    if (threaded) {
+        pthread_mutex_lock(&reader.lock);
+        reader.stopping = 1;                         // Wake the reader if the merge stopped early
+        pthread_cond_broadcast(&reader.changed);
+        pthread_mutex_unlock(&reader.lock);
+        pthread_join(thread, NULL);
+    }
+    pthread_cond_destroy(&reader.changed);
+    pthread_mutex_destroy(&reader.lock);
+    if (reported > IMPORT_MAX_REPORTED_ERRORS) {
+        fprintf(stderr, "%s: %lld more bad lines not shown\n", filename, reported - IMPORT_MAX_REPORTED_ERRORS);
+    }
+    ok = ok && !reader.read_failed;
+    for (int b = 0; b < STREAM_BLOCKS; b++) {
+        free(reader.blocks[b].text);
+        free(reader.blocks[b].chunk.rows);
+    }
+    free(reader.carry);
+    free(keys.keys);
+    close(fd);
+    stats_record(STAT_MERGE, start, stats->imported, stats->lines);
+    return ok;
+}
+
+// Function to export the books that match a query
+// The view is walked once; each match is formatted into the render buffer,
+// which is written out in large blocks, so memory does not grow with the catalog.
+long long stream_export_books(FILE *out, CatalogView *view, const ScanQuery *query, int format,
+                              StreamProgressFn progress, void *context) {
+    unsigned long long start = stats_now();          // Time the export
+    CatalogView *own = view == NULL ? catalog_view_open() : NULL; // No view given: the catalog as it is now
+    if (view == NULL && own == NULL) {
+        return -1;
+    }
+    if (view == NULL) view = own;
+    ScanFilter filter;
+    scan_filter_init(&filter, query);
+    Renderer r;                                      // One buffer of output at a time
+    render_begin(&r, out, format, 0, -1);
+    StreamProgress state = { 0, catalog_view_book_count(view), 0 };
+    const Book *book;
+    int borrowed;
+    while ((book = catalog_view_next(view, &borrowed)) != NULL) {
+        if (scan_filter_match(&filter, book, borrowed)) {
+            render_book(&r, book, borrowed);
+        }
+        if (++state.done % STREAM_EXPORT_PROGRESS == 0 && progress != NULL) {
+            state.books = r.shown;
+            progress(&state, context);
+        }
+    }
+    int ok = render_end(&r) && catalog_view_ok(view); // Write the last block
+    state.books = r.shown;
+    if (progress != NULL) {
+        progress(&state, context);
+    }
+    scan_filter_free(&filter);
+    if (own != NULL) catalog_view_close(own);
+    stats_record(STAT_EXPORT, start, ok ? r.shown : 0, state.done);
+    return ok ? r.shown : -1;
+}
+
+// Load a mapped version 1 snapshot (see SnapshotHeaderV1); takes over the mapping
+// Authors are interned as they come, pointing into the heap like the titles.
+static int map_snapshot_v1(void *map, size_t size) {
+    const SnapshotHeaderV1 *header = map;
+    const SnapshotRecordV1 *records = (const SnapshotRecordV1 *) (header + 1); // Records follow the header
+    unsigned long long count = header->book_count;
+    const char *heap = (const char *) (records + count); // String heap follows the records
+    int valid = header->record_size == sizeof(SnapshotRecordV1) &&
+                count <= (size - sizeof(SnapshotHeaderV1)) / sizeof(SnapshotRecordV1) &&
+                sizeof(SnapshotHeaderV1) + count * sizeof(SnapshotRecordV1) + header->heap_size == size &&
+                (header->heap_size == 0 || heap[header->heap_size - 1] == '\0'); // Last string is terminated
+    if (valid) {                                     // Only then is the checksum range known
+        Checksum sum = { FNV_OFFSET, {0}, 0 };
+        checksum_update(&sum, records, count * sizeof(SnapshotRecordV1));
+        checksum_update(&sum, heap, header->heap_size);
+        valid = checksum_finish(&sum) == header->checksum;
+    }
+    if (!valid) {                                    // Damaged file
+        munmap(map, size);
+        return -1;
+    }
+
+    clear_library();                                 // Replace the current contents
+    release_snapshot_map();                          // The previous snapshot is no longer referenced
+    snapshot_map = map;                              // Keep this one mapped while the library uses it
+    snapshot_map_size = size;
+
+    if (!reserve_books((int) count)) {               // Size the library once
+        return -1;
+    }
+    for (unsigned long long r = 0; r < count; r++) { // Adopt each record, pointing into the heap
+        const SnapshotRecordV1 *record = &records[r];
+        unsigned int author = record->author_offset < header->heap_size ? author_dict_adopt(heap + record->author_offset)
+                                                                        : AUTHOR_INVALID; // Repeated names get the same ID
+        if (record->title_offset >= header->heap_size || author == AUTHOR_INVALID ||
+            append_book_in_place(record->id, heap + record->title_offset, author,
+                                 record->publication_year, (int) (record->flags & 1)) == NULL) {
+            clear_library();                         // Bad offset or out of memory
+            return -1;
+        }
+    }
+    int *next_id = get_next_id_address();            // Restore the ID counter as it was saved
+    if (header->next_id > *next_id) {
+        *next_id = header->next_id;
+    }
+    snapshot_generation = header->generation;        // Its journal is replayed on top
+    return 1;
+}
+
+// Function to load a binary snapshot
+// The file is mapped read-only and the strings are used in place; only the
+// fixed-width records are walked. Returns 1 on success, 0 if the file is
+// missing, and -1 if it is damaged (the library is left empty).
+static int map_snapshot(const char *filename) {
+    int fd = open(filename, O_RDONLY);               // Open the snapshot
+    if (fd < 0) {                                    // No snapshot yet
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(SnapshotHeaderV1)) {
+        close(fd);
+        return -1;                                   // Too small to be a snapshot
+    }
+    size_t size = (size_t) info.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0); // Map the whole file
+    close(fd);                                       // The mapping stays valid after close
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const SnapshotHeader *header = map;              // Magic and version sit at the same place in every version
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 && header->version == 1) {
+        return map_snapshot_v1(map, size);
+    }
+    if (size < sizeof(SnapshotHeader)) {
+        munmap(map, size);
+        return -1;
+    }
+    const SnapshotRecord *records = (const SnapshotRecord *) (header + 1); // Records follow the header
+    unsigned long long count = header->book_count;
+    unsigned long long author_count = header->author_count;
+    unsigned long long loan_count = header->loan_count;
+    const unsigned long long *authors = (const unsigned long long *) (records + count); // Author table follows the records
+    const unsigned int *loan_times = (const unsigned int *) (authors + author_count); // Loan columns follow the author table
+    const int *loan_ids = (const int *) (loan_times + loan_count);
+    const unsigned char *loan_kinds = (const unsigned char *) (loan_ids + loan_count);
+    const char *heap = (const char *) (loan_kinds + loan_count); // String heap follows the loan columns
+    size_t loan_size = sizeof(unsigned int) + sizeof(int) + 1; // Bytes per loan event
+    int valid = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+                header->version >= SNAPSHOT_OLDEST_VERSION && header->version <= SNAPSHOT_VERSION &&
+                header->record_size == sizeof(SnapshotRecord) &&
+                count <= (size - sizeof(SnapshotHeader)) / sizeof(SnapshotRecord) &&
+                author_count <= (size - sizeof(SnapshotHeader) - count * sizeof(SnapshotRecord)) / sizeof(unsigned long long) &&
+                loan_count <= (size - sizeof(SnapshotHeader) - count * sizeof(SnapshotRecord) -
+                               author_count * sizeof(unsigned long long)) / loan_size &&
+                sizeof(SnapshotHeader) + count * sizeof(SnapshotRecord) + author_count * sizeof(unsigned long long) +
+                    loan_count * loan_size + header->heap_size == size &&
+                (header->heap_size == 0 || heap[header->heap_size - 1] == '\0'); // Last string is terminated
+    if (valid) {                                     // Only then is the checksum range known
+        Checksum sum = { FNV_OFFSET, {0}, 0 };
+        checksum_update(&sum, records, count * sizeof(SnapshotRecord));
+        checksum_update(&sum, authors, author_count * sizeof(unsigned long long));
+        checksum_update(&sum, loan_times, loan_count * loan_size); // The three columns are contiguous
+        checksum_update(&sum, heap, header->heap_size);
+        valid = checksum_finish(&sum) == header->checksum;
+    }
+    if (!valid) {                                    // Wrong format or damaged file
+        munmap(map, size);
+        return -1;
+    }
+
+    clear_library();                                 // Replace the current contents
+    release_snapshot_map();                          // The previous snapshot is no longer referenced
+    snapshot_map = map;                              // Keep this one mapped while the library uses it
+    snapshot_map_size = size;
+
+    unsigned int *author_ids = malloc((author_count > 0 ? author_count : 1) * sizeof(unsigned int)); // Table index -> author ID
+    if (author_ids == NULL || !reserve_books((int) count)) { // Size the library once
+        free(author_ids);
+        return -1;
+    }
+    for (unsigned long long a = 0; a < author_count; a++) { // Intern every author once, pointing into the heap
+        author_ids[a] = authors[a] < header->heap_size ? author_dict_adopt(heap + authors[a]) : AUTHOR_INVALID;
+        if (author_ids[a] == AUTHOR_INVALID) {       // Bad offset or out of memory
+            free(author_ids);
+            clear_library();
+            return -1;
+        }
+    }
+    for (unsigned long long r = 0; r < count; r++) { // Adopt each record, pointing into the heap
+        const SnapshotRecord *record = &records[r];
+        if (record->title_offset >= header->heap_size || record->author >= author_count ||
+            append_book_in_place(record->id, heap + record->title_offset, author_ids[record->author],
+                                 record->publication_year, (int) (record->flags & 1)) == NULL) {
+            free(author_ids);
+            clear_library();                         // Bad offset or out of memory
+            return -1;
+        }
+    }
+    free(author_ids);
+    if (!ledger_load(loan_times, loan_ids, loan_kinds, (long long) loan_count)) { // Loans of the books just added
+        clear_library();
+        return -1;
+    }
+    int *next_id = get_next_id_address();            // Restore the ID counter as it was saved
+    if (header->next_id > *next_id) {
+        *next_id = header->next_id;
+    }
+    snapshot_generation = header->generation;        // Journals are matched against this
+    return 1;
+}
+
+// Timed wrapper (see stats.h)
+int load_snapshot(const char *filename) {
+    unsigned long long start = stats_now();          // Time the load
+    int loaded = map_snapshot(filename);
+    if (loaded != 0) {                               // No snapshot at all is not a load
+        stats_record(STAT_SNAPSHOT_LOAD, start, loaded == 1 ? *get_book_count_address() : 0, 0);
+    }
+    return loaded;
+}
+
+unsigned int get_snapshot_generation() {
+    return snapshot_generation;
+}
+
+void set_snapshot_generation(unsigned int generation) {
+    snapshot_generation = generation;
+}
+
+// Function to save the library as a binary snapshot
+// Writes to "<filename>.tmp" and renames it over the old snapshot, so a crash
+// never leaves a half-written file behind (and a mapped old snapshot stays valid).
+static int write_snapshot(const char *filename, CatalogView *view, unsigned int generation) {
+    char temp_name[1024];                            // Name of the temporary file
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", filename);
+    FILE *file = fopen(temp_name, "wb");
+    if (file == NULL) {
+        perror("Error opening snapshot for saving"); // Print error message with system error info
+        return 0;
+    }
+    setvbuf(file, NULL, _IOFBF, SNAPSHOT_WRITE_BUFFER); // Large buffered writes
+
+    // Authors get table indexes in order of first use, so authors no book uses any more are left out
+    unsigned int dict_count = author_dict_count();   // Every author ID in the view is below this
+    unsigned int *table_index = calloc(dict_count, sizeof(unsigned int)); // Author ID -> table index + 1 (0 = not used yet)
+    unsigned int *table = malloc((size_t) dict_count * sizeof(unsigned int)); // Table index -> author ID
+    if (table_index == NULL || table == NULL) {
+        free(table_index);
+        free(table);
+        fclose(file);
+        remove(temp_name);
+        return 0;
+    }
+    unsigned int author_count = 0;
+
+    SnapshotHeader header = {0};                     // Header is rewritten once the checksum is known
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.record_size = sizeof(SnapshotRecord);
+    header.book_count = (unsigned long long) catalog_view_book_count(view);
+    header.next_id = catalog_view_next_id(view);
+    header.generation = generation;
+    fwrite(&header, sizeof(header), 1, file);
+
+    Checksum sum = { FNV_OFFSET, {0}, 0 };           // Records: the heap holds every title, then every author
+    unsigned long long offset = 0;                   // Heap offset of the next title
+    const Book *book;
+    int borrowed;
+    while ((book = catalog_view_next(view, &borrowed)) != NULL) { // Tombstones are not saved
+        unsigned int author = book->author_id < dict_count ? book->author_id : AUTHOR_NONE; // (newer only in a torn view, which is not saved)
+        if (table_index[author] == 0) {              // First book by this author
+            table[author_count++] = author;
+            table_index[author] = author_count;
+        }
+        SnapshotRecord record = {0};
+        record.id = book->id;
+        record.publication_year = book->publication_year;
+        record.title_offset = offset;
+        offset += strlen(book->title) + 1;
+        record.author = table_index[author] - 1;
+        record.flags = (unsigned int) borrowed;
+        fwrite(&record, sizeof(record), 1, file);
+        checksum_update(&sum, &record, sizeof(record));
+    }
+    for (unsigned int a = 0; a < author_count; a++) { // Author table: each name's place after the titles
+        fwrite(&offset, sizeof(offset), 1, file);
+        checksum_update(&sum, &offset, sizeof(offset));
+        offset += strlen(author_dict_name(table[a])) + 1;
+    }
+    long long loans = catalog_view_loan_count(view); // Loan ledger as of the view, one column after another
+    for (int column = 0; column < 3; column++) {
+        for (long long e = 0; e < loans; ) {
+            const unsigned int *times;
+            const int *ids;
+            const unsigned char *kinds;
+            long long run = ledger_events(e, loans - e, &times, &ids, &kinds); // Events sharing a page
+            const void *data = column == 0 ? (const void *) times : column == 1 ? (const void *) ids : (const void *) kinds;
+            size_t bytes = (size_t) run * (column == 0 ? sizeof(unsigned int) : column == 1 ? sizeof(int) : 1);
+            fwrite(data, 1, bytes, file);
+            checksum_update(&sum, data, bytes);
+            e += run;
+        }
+    }
+    // The checksum covers the records, the author table, then the heap, so hash the heap in a second pass
+    catalog_view_rewind(view);
+    while ((book = catalog_view_next(view, &borrowed)) != NULL) {
+        size_t title_len = strlen(book->title) + 1;  // Include the null terminator
+        fwrite(book->title, 1, title_len, file);
+        checksum_update(&sum, book->title, title_len);
+    }
+    for (unsigned int a = 0; a < author_count; a++) { // Each author once
+        const char *author = author_dict_name(table[a]);
+        size_t author_len = strlen(author) + 1;
+        fwrite(author, 1, author_len, file);
+        checksum_update(&sum, author, author_len);
+    }
+    free(table_index);
+    free(table);
+    header.author_count = author_count;
+    header.loan_count = (unsigned long long) loans;
+    header.heap_size = offset;
+    header.checksum = checksum_finish(&sum);
+
+    fseek(file, 0, SEEK_SET);                        // Fill in the final header
+    fwrite(&header, sizeof(header), 1, file);
+    int ok = !ferror(file) && fflush(file) == 0 && fsync(fileno(file)) == 0; // On disk before the rename
+    ok = (fclose(file) == 0) && ok && catalog_view_ok(view); // Close (a torn view is not saved)
+    if (!ok || rename(temp_name, filename) != 0) {   // Atomically replace the old snapshot
+        perror("Error saving snapshot");
+        remove(temp_name);
+        return 0;
+    }
+    return 1;
+}
+
+// Timed wrapper (see stats.h)
+int save_snapshot_view(const char *filename, CatalogView *view, unsigned int generation) {
+    unsigned long long start = stats_now();          // Time the save
+    int ok = write_snapshot(filename, view, generation);
+    int count = catalog_view_book_count(view);
+    stats_record(STAT_SNAPSHOT_SAVE, start, ok ? count : 0, count);
+    return ok;
+}
+
+// Function to save the library as it is now
+int save_snapshot(const char *filename) {
+    CatalogView *view = catalog_view_open();
+    if (view == NULL) {
+        return 0;
+    }
+    int ok = save_snapshot_view(filename, view, snapshot_generation + 1); // Each saved snapshot is a new generation
+    catalog_view_close(view);
+    if (ok) {
+        snapshot_generation++;                       // The new snapshot is now the base
+    }
+    return ok;
+}
+
+// ==================== journal.h ====================
+#ifndef JOURNAL_H              // Include guard to prevent multiple inclusions
+#define JOURNAL_H              // Define the include guard macro
+
+// Append-only write-ahead journal of library changes.
+// Each change is one small record appended to the journal; records are written
+// and fsync'ed in groups. On startup the journal is replayed on top of the
+// snapshot it follows. When it grows large, a background thread writes a fresh
+// snapshot from a catalog view (renamed into place) while changes carry on
+// into a new journal.
+#define JOURNAL_GROUP_RECORDS 64        // Commit once this many records are waiting
+#define JOURNAL_GROUP_WINDOW_MS 20      // ... or once the oldest waiting record is this old
+#define JOURNAL_COMPACT_BYTES (8 << 20) // Start a compaction when the journal passes this size
+
+int journal_open(const char *journal_path, const char *snapshot_path); // Replay, then open for appending
+void journal_log_add(int id, const char *title, const char *author, int year); // Record a new book
+void journal_log_remove(int id);        // Record a removed book
+void journal_log_borrowed(int id, int borrowed); // Record a borrow (1) or return (0)
+int journal_commit();                   // Write and fsync every waiting record now
+
+// For threaded callers with one committer thread: appends only queue records,
+// and the committer writes them (under the caller's lock) and then fsyncs
+// (without it), so appends never wait for the disk.
+void journal_set_auto_commit(int enabled); // 0: only journal_commit/journal_write write records
+int journal_write();                    // Write waiting records without fsync; 1 if any, 0 if none, -1 on error
+int journal_sync();                     // fsync what journal_write has written
+int journal_sync_fd();                  // New descriptor of the journal file, to fsync without the caller's lock (-1 if none)
+void journal_maintain();                // Reap a finished compaction or start one (only a start writes and fsyncs)
+int journal_checkpoint();               // Save a snapshot now and start an empty journal
+void journal_close();                   // Commit, wait for any compaction, and close
+
+#endif // JOURNAL_H            // End of include guard
+
+// ==================== journal.c ====================
+#include <stdio.h>             // For printf, fprintf, snprintf, rename, remove functions
+#include <stdlib.h>            // For realloc, free functions
+#include <string.h>            // For memcpy, memcmp, strlen functions
+#include <time.h>              // For clock_gettime, time functions
+#include <errno.h>             // For errno, ENOENT
+#include <fcntl.h>             // For open function
+#include <unistd.h>            // For write, fsync, ftruncate, dup functions
+#include <sys/stat.h>          // For fstat function
+#include <pthread.h>           // For the compaction thread
+
+#include "journal.h"           // Include our journal declarations
+#include "admin.h"             // Include functions that apply replayed changes
+#include "data_handler.h"      // Include snapshot functions
+
+#define JOURNAL_MAGIC "LIBJRNL"  // First 8 bytes of every journal (with its null terminator)
+#define JOURNAL_VERSION 1        // Bumped whenever the record layout changes
+
+enum { JOURNAL_ADD = 1, JOURNAL_REMOVE = 2, JOURNAL_BORROW = 3, JOURNAL_RETURN = 4 }; // Record types
+
+// Start of every journal file
+typedef struct {
+    char magic[8];             // JOURNAL_MAGIC
+    unsigned int version;      // JOURNAL_VERSION
+    unsigned int base_generation; // Generation of the snapshot this journal applies on top of
+} JournalHeader;
+
+// One change; JOURNAL_ADD records are followed by the title and author bytes
+typedef struct {
+    unsigned int checksum;     // FNV-1a of the record (with this field zero) and its strings
+    unsigned char type;        // JOURNAL_ADD, JOURNAL_REMOVE, JOURNAL_BORROW or JOURNAL_RETURN
+    unsigned char reserved[3]; // Zero
+    int id;                    // Book ID the change applies to
+    int year;                  // Publication year (JOURNAL_ADD), or time of a borrow or return (seconds since the epoch)
+    unsigned int title_length; // Bytes of title following the record (no terminator)
+    unsigned int author_length; // Bytes of author following the title (no terminator)
+} JournalRecord;
+
+static int journal_fd = -1;                 // Journal being appended to (-1 = journaling off)
+static char journal_file[1024];             // Path of the current journal
+static char previous_file[1024];            // Path of the journal being folded into a snapshot
+static char snapshot_file[1024];            // Path of the snapshot compaction writes
+static long long journal_size = 0;          // Bytes in the current journal (committed)
+
+static char *pending = NULL;                // Records waiting for the next group commit
+static size_t pending_size = 0;             // Bytes waiting
+static size_t pending_capacity = 0;         // Bytes allocated for pending
+static int pending_records = 0;             // Records waiting
+static double pending_since = 0;            // Time the oldest waiting record was added
+
+static pthread_t compaction_thread;         // Thread writing a snapshot
+static int compaction_running = 0;          // compaction_thread has not been joined yet
+static int compaction_done = 0;             // Set by the thread when it has finished
+static int compaction_ok = 0;               // Whether the snapshot was written
+static CatalogView *compaction_view = NULL; // Catalog as of the journal switch
+static unsigned int compaction_generation;  // Generation being written
+static int auto_commit = 1;                 // Commit from journal_append when a group is full or old
+
+// Current time in seconds from a monotonic clock
+static double journal_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// 32-bit FNV-1a hash, continued from `h`
+static unsigned int journal_hash(unsigned int h, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Checksum of a record and the strings that follow it
+static unsigned int record_checksum(JournalRecord record, const char *strings) {
+    record.checksum = 0;                              // The field itself is not covered
+    unsigned int h = journal_hash(2166136261u, &record, sizeof(record));
+    return journal_hash(h, strings, record.title_length + record.author_length);
+}
+
+// Write all of a buffer, retrying short writes
+static int write_all(int fd, const void *data, size_t size) {
+    const char *bytes = data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written <= 0) {
+            return 0;
+        }
+        bytes += written;
+        size -= (size_t) written;
+    }
+    return 1;
+}
+
+// Create (or empty) a journal file that follows snapshot `generation`
+static int create_journal(const char *path, unsigned int generation) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    JournalHeader header = {0};
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.base_generation = generation;
+    if (!write_all(fd, &header, sizeof(header)) || fsync(fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    journal_size = sizeof(header);
+    return fd;
+}
+
+// Apply one replayed record to the library
+static void apply_record(const JournalRecord *record, const char *strings) {
+    int slot = find_book_by_id(record->id);           // Current slot of the book (if any)
+    switch (record->type) {
+        case JOURNAL_ADD: {
+            char title[MAX_TITLE_LEN], author[MAX_AUTHOR_LEN]; // Terminated copies of the strings
+            size_t title_length = record->title_length < MAX_TITLE_LEN ? record->title_length : MAX_TITLE_LEN - 1;
+            size_t author_length = record->author_length < MAX_AUTHOR_LEN ? record->author_length : MAX_AUTHOR_LEN - 1;
+            memcpy(title, strings, title_length);
+            title[title_length] = '\0';
+            memcpy(author, strings + record->title_length, author_length);
+            author[author_length] = '\0';
+            if (slot == -1) {                         // Ignore a duplicate add
+                append_book(record->id, title, author, record->year, 0);
+            }
+            break;
+        }
+        case JOURNAL_REMOVE:
+            if (slot != -1) remove_book_at(slot);
+            break;
+        case JOURNAL_BORROW:
+        case JOURNAL_RETURN:
+            if (slot != -1) change_book_borrowed(slot, record->type == JOURNAL_BORROW, (unsigned int) record->year); // The loan is recorded again
+            break;
+    }
+}
+
+// Replay a journal file if it follows snapshot `generation`
+// Returns the number of bytes of valid journal (a torn or damaged tail is
+// ignored), 0 if the file is missing or follows another snapshot.
+static long long replay_journal(const char *path, unsigned int generation) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat info;
+    char *data = NULL;                                // Whole journal, read in one go
+    long long valid = 0;
+    if (fstat(fd, &info) == 0 && info.st_size >= (off_t) sizeof(JournalHeader) &&
+        (data = malloc((size_t) info.st_size)) != NULL &&
+        read(fd, data, (size_t) info.st_size) == info.st_size) {
+        JournalHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0 &&
+            header.version == JOURNAL_VERSION && header.base_generation == generation) {
+            size_t pos = sizeof(header);              // Walk the records
+            while (pos + sizeof(JournalRecord) <= (size_t) info.st_size) {
+                JournalRecord record;
+                memcpy(&record, data + pos, sizeof(record));
+                size_t strings = (size_t) record.title_length + record.author_length;
+                if (strings > (size_t) info.st_size - pos - sizeof(record) || // Torn record at the end
+                    record_checksum(record, data + pos + sizeof(record)) != record.checksum) {
+                    break;                            // Stop at the first damaged record
+                }
+                apply_record(&record, data + pos + sizeof(record));
+                pos += sizeof(record) + strings;
+            }
+            valid = (long long) pos;
+        }
+    }
+    free(data);
+    close(fd);
+    return valid;
+}
+
+// Append one record to the group-commit buffer
+static void journal_append(int type, int id, int year, const char *title, const char *author) {
+    if (journal_fd < 0) {                             // Journaling is off
+        return;
+    }
+    JournalRecord record = {0};
+    record.type = (unsigned char) type;
+    record.id = id;
+    record.year = year;
+    record.title_length = title ? (unsigned int) strlen(title) : 0;
+    record.author_length = author ? (unsigned int) strlen(author) : 0;
+    size_t size = sizeof(record) + record.title_length + record.author_length;
+    if (pending_size + size > pending_capacity) {     // Grow the buffer
+        size_t new_capacity = pending_capacity ? pending_capacity * 2 : 4096;
+        while (new_capacity < pending_size + size) new_capacity *= 2;
+        char *grown = realloc(pending, new_capacity);
+        if (grown != NULL) {
+            pending = grown;
+            pending_capacity = new_capacity;
+        } else if (!journal_commit() || pending_size + size > pending_capacity) { // Out of memory: flush what we have and retry
+            fprintf(stderr, "Error: out of memory; change to book %d was not journaled\n", id);
+            return;
+        }
+    }
+    char *strings = pending + pending_size + sizeof(record);
+    memcpy(strings, title ? title : "", record.title_length);
+    memcpy(strings + record.title_length, author ? author : "", record.author_length);
+    record.checksum = record_checksum(record, strings);
+    memcpy(pending + pending_size, &record, sizeof(record));
+    pending_size += size;
+    if (pending_records++ == 0) {
+        pending_since = journal_now();                // Start of this group
+    }
+    if (auto_commit && (pending_records >= JOURNAL_GROUP_RECORDS || // Group is full or old enough
+        (journal_now() - pending_since) * 1000.0 >= JOURNAL_GROUP_WINDOW_MS)) {
+        journal_commit();
+    }
+}
+
+void journal_log_add(int id, const char *title, const char *author, int year) {
+    journal_append(JOURNAL_ADD, id, year, title, author);
+}
+
+void journal_log_remove(int id) {
+    journal_append(JOURNAL_REMOVE, id, 0, NULL, NULL);
+}
+
+void journal_log_borrowed(int id, int borrowed) {
+    journal_append(borrowed ? JOURNAL_BORROW : JOURNAL_RETURN, id, (int) time(NULL), NULL, NULL); // When, for the loan ledger
+}
+
+// Fold the library into a new snapshot in the foreground and restart the journal
+int journal_checkpoint() {
+    if (journal_fd < 0) {
+        return 0;
+    }
+    journal_commit();                                 // Nothing may be lost if the save fails
+    if (compaction_running) {                         // Let a running compaction finish first
+        pthread_join(compaction_thread, NULL);
+        compaction_running = 0;
+    }
+    if (!save_snapshot(snapshot_file)) {              // Keep journaling on top of the old snapshot
+        return 0;
+    }
+    close(journal_fd);                                // Everything is in the snapshot now
+    journal_fd = create_journal(journal_file, get_snapshot_generation());
+    remove(previous_file);
+    return journal_fd >= 0;
+}
+
+// Check whether a background compaction has finished
+static void reap_compaction() {
+    if (compaction_running && __atomic_load_n(&compaction_done, __ATOMIC_ACQUIRE)) {
+        pthread_join(compaction_thread, NULL);
+        compaction_running = 0;
+        if (compaction_ok) {
+            remove(previous_file);                    // The new snapshot covers the old journal
+        } else {
+            journal_checkpoint();                     // Thread failed: do it in the foreground
+        }
+    }
+}
+
+// Compaction thread: write the view and release it
+static void *compact_in_background(void *arg) {
+    (void) arg;
+    compaction_ok = save_snapshot_view(snapshot_file, compaction_view, compaction_generation);
+    catalog_view_close(compaction_view);
+    __atomic_store_n(&compaction_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Start writing a fresh snapshot in a background thread
+// The thread reads a copy-on-write view of the library as of now, while
+// changes carry on into a new journal; the old one is kept aside until the
+// snapshot is renamed into place.
+static void start_compaction() {
+    if (compaction_running) {                         // One at a time
+        return;
+    }
+    int written = journal_write();                    // Records queued since the last commit belong to the old journal
+    if (written < 0 || (written > 0 && !journal_sync())) { // (once per compaction, so the fsync here is rare)
+        return;
+    }
+    compaction_view = catalog_view_open();            // No change is in progress (callers hold the journal)
+    if (compaction_view == NULL) {
+        return;
+    }
+    unsigned int generation = get_snapshot_generation() + 1; // Generation the thread will write
+    close(journal_fd);
+    if (rename(journal_file, previous_file) != 0) {   // Keep the old journal until the snapshot exists
+        journal_fd = open(journal_file, O_WRONLY | O_APPEND);
+        catalog_view_close(compaction_view);
+        return;
+    }
+    journal_fd = create_journal(journal_file, generation);
+    compaction_generation = generation;
+    compaction_done = 0;
+    if (pthread_create(&compaction_thread, NULL, compact_in_background, NULL) != 0) { // Could not start: do it in the foreground
+        catalog_view_close(compaction_view);
+        journal_checkpoint();
+        return;
+    }
+    set_snapshot_generation(generation);              // New journal follows the snapshot being written
+    compaction_running = 1;
+}
+
+// Function to write and fsync every waiting record (one fsync per group)
+int journal_commit() {
+    if (journal_fd < 0) {
+        return 0;
+    }
+    reap_compaction();                                // Finish off a completed compaction
+    int written = journal_write();
+    if (written < 0 || (written > 0 && !journal_sync())) {
+        return 0;
+    }
+    journal_maintain();
+    return 1;
+}
+
+// Function to finish a completed compaction, or start one if the journal has grown large
+// Only starting a compaction writes (the records queued since the last commit), so a committer can call it under its locks and fsync outside them.
+void journal_maintain() {
+    if (journal_fd < 0) {
+        return;
+    }
+    reap_compaction();
+    if (journal_size > JOURNAL_COMPACT_BYTES) {       // Journal has grown large: fold it into a snapshot
+        start_compaction();
+    }
+}
+
+void journal_set_auto_commit(int enabled) {
+    auto_commit = enabled;
+}
+
+// Function to write every waiting record to the journal file (no fsync)
+// Returns 1 if records were written, 0 if none were waiting, -1 on error.
+int journal_write() {
+    if (journal_fd < 0 || pending_size == 0) {
+        return 0;
+    }
+    if (!write_all(journal_fd, pending, pending_size)) {
+        perror("Error writing journal");
+        return -1;
+    }
+    journal_size += (long long) pending_size;
+    pending_size = 0;
+    pending_records = 0;
+    return 1;
+}
+
+// Function to get a descriptor of the current journal file for an fsync
+// A checkpoint or compaction may close and replace journal_fd at any time
+// under the caller's lock, so a committer that fsyncs without that lock
+// must fsync (and close) its own descriptor instead.
+int journal_sync_fd() {
+    return journal_fd >= 0 ? dup(journal_fd) : -1;
+}
+
+// Function to make everything written so far durable
+int journal_sync() {
+    if (journal_fd >= 0 && fsync(journal_fd) != 0) {
+        perror("Error writing journal");
+        return 0;
+    }
+    return 1;
+}
+
+// Function to replay the journal and open it for appending
+// Call after the snapshot (or text import) has been loaded.
+// Returns 1 if journaling is on, 0 if the journal could not be opened.
+int journal_open(const char *journal_path, const char *snapshot_path) {
+    snprintf(journal_file, sizeof(journal_file), "%s", journal_path);
+    snprintf(previous_file, sizeof(previous_file), "%s.prev", journal_path);
+    snprintf(snapshot_file, sizeof(snapshot_file), "%s", snapshot_path);
+
+    unsigned int generation = get_snapshot_generation(); // Snapshot that was loaded (0 = none)
+    // A leftover previous journal means a compaction did not finish: its
+    // records come first, and the current journal follows the next generation.
+    int resumed = replay_journal(previous_file, generation) > 0;
+    long long valid = replay_journal(journal_file, resumed ? generation + 1 : generation);
+
+    if (resumed) {                                    // Fold both journals into a snapshot right away
+        journal_fd = open(journal_file, O_WRONLY | O_APPEND);
+        if (journal_fd < 0 && errno == ENOENT) {      // Crashed between the rename and the new journal
+            journal_fd = create_journal(journal_file, generation + 1);
+        }
+        return journal_checkpoint();
+    }
+    remove(previous_file);                            // Already covered by the snapshot
+    if (valid > 0) {                                  // Continue the journal after its last good record
+        journal_fd = open(journal_file, O_WRONLY | O_APPEND);
+        if (journal_fd >= 0 && ftruncate(journal_fd, valid) == 0) {
+            journal_size = valid;
+            return 1;
+        }
+        if (journal_fd >= 0) close(journal_fd);
+    }
+    journal_fd = create_journal(journal_file, generation); // Missing, damaged or stale: start a new one
+    return journal_fd >= 0;
+}
+
+// Function to commit outstanding records and close the journal
+void journal_close() {
+    if (journal_fd < 0) {
+        return;
+    }
+    journal_commit();
+    if (compaction_running) {                         // Wait for the snapshot being written
+        pthread_join(compaction_thread, NULL);
+        compaction_running = 0;
+        if (compaction_ok) remove(previous_file);
+    }
+    close(journal_fd);
+    journal_fd = -1;
+}
+
+// ==================== batch.h ====================
+#ifndef BATCH_H                // Include guard to prevent multiple inclusions
+#define BATCH_H                // Define the include guard macro
+
+#include <stdio.h>             // For FILE
+#include "book.h"              // Include IdList
+#include "catalog_view.h"      // Include CatalogView
+
+// Batch mode: one command per line, fields separated by ';'
+//   add;Title;Author;Year   remove;ID   borrow;ID   return;ID
+//   search;Title text       author;Name   years;1990-2005   count
+//   rank;Query words (ranked fuzzy search: IDs best first)
+//   complete;titles|authors;Prefix (autocomplete: "<books>\t<first ID>\t<text>" lines, then "<line> ok <count>")
+//   circulation;books|authors|decades (loan figures, one per line, then "<line> ok <count>"):
+//     books "<loans>\t<ID>\t<title>", authors "<on loan>\t<loans>\t<name>", decades "<first year>\t<on loan>\t<loans>"
+//   find;Title text;Author text;1990-2005;all|borrowed|available (empty fields match anything)
+//   list;all|borrowed|available;human|compact|tsv|jsonl|text;OFFSET;LIMIT
+//   export;Title text;Author text;1990-2005;all|borrowed|available;FORMAT (every matching book, streamed)
+//   merge;FILE (adds the file's books that are not in the library yet: "<line> ok <added> <duplicates> <bad lines>")
+// Blank lines and lines starting with '#' are ignored. Each command prints one
+// line: "<line> ok [details]" or "<line> error <reason>"; list and export write
+// their books first and then "<line> ok <books written>".
+#define BATCH_OUTPUT_BUFFER (1 << 20)   // stdio buffer for batch output
+
+// Outcome of a batch run
+typedef struct {
+    long long commands;        // Commands executed
+    long long failed;          // Commands that reported an error
+} BatchStats;
+
+// Runs every command read from `in`, writing results to `out`
+void run_batch(FILE *in, FILE *out, BatchStats *stats);
+
+// What a command does to the library (decides which lock a server takes)
+#define BATCH_READS 0          // Only reads (search, author, years, rank, find, complete, circulation, count)
+#define BATCH_STATUS 1         // Changes a borrowed status (borrow, return)
+#define BATCH_WRITES 2         // Adds or removes books (add, remove, merge)
+#define BATCH_VIEW 3           // Reads a catalog view (list, export): a lock is only needed to open it
+int batch_command_kind(const char *text);
+int batch_status_id(const char *text);  // Book a borrow or return line is about (0 if it names none)
+// Runs one command line (split in place) and writes its result; returns 1 if it succeeded
+// With `journal` set, successful changes are also recorded in the journal.
+// `view` is the catalog list reads (NULL: list opens its own).
+int batch_execute(FILE *out, long long line, char *text, IdList *results, int journal, CatalogView *view);
+
+#endif // BATCH_H              // End of include guard
+
+// ==================== batch.c ====================
+#include <stdio.h>             // For getline, fprintf functions
+#include <stdlib.h>            // For strtol, free functions
+#include <string.h>            // For strchr, strcmp, strcspn functions
+#include <limits.h>            // For INT_MAX, INT_MIN constants
+
+#include "batch.h"             // Include our batch declarations
+#include "admin.h"             // Include add_book and remove_book
+#include "user.h"              // Include borrow_book, return_book and searches
+#include "render.h"            // Include the renderer used by list
+#include "journal.h"           // Include change journaling (server connections)
+#include "ranked_search.h"     // Include ranked fuzzy search (rank)
+#include "scan.h"              // Include the parallel full scan (find)
+#include "prefix_index.h"      // Include the autocomplete indexes (complete)
+#include "loan_ledger.h"       // Include circulation figures (circulation)
+#include "author_dict.h"       // Include author names
+#include "data_handler.h"      // Include streaming merge and export (merge, export)
+
+// Read a whole field as an int; returns 0 if it is not one
+static int parse_batch_int(const char *text, int *value) {
+    char *end;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v > INT_MAX || v < INT_MIN) {
+        return 0;
+    }
+    *value = (int) v;
+    return 1;
+}
+
+// Print the IDs of a result list after its size
+static void print_batch_ids(FILE *out, long long line, const IdList *ids) {
+    fprintf(out, "%lld ok %d", line, ids->count);
+    for (int i = 0; i < ids->count; i++) {
+        fprintf(out, " %d", ids->ids[i]);
+    }
+    fputc('\n', out);
+}
+
+// Split `count` fields separated by ';' in place (the last one keeps any further ';'); returns 0 if there are fewer
+static int split_batch_fields(char *args, char **fields, int count) {
+    for (int f = 0; f < count; f++) {
+        fields[f] = args;
+        if (f == count - 1) break;
+        args = strchr(args, ';');
+        if (args == NULL) return 0;
+        *args++ = '\0';
+    }
+    return 1;
+}
+
+// Read TITLE, AUTHOR, YEARS and STATUS fields into a query; returns NULL, or what is wrong (`usage` for bad years)
+static const char *parse_query_fields(char **fields, ScanQuery *query, const char *usage) {
+    scan_query_init(query);
+    query->title = fields[0];                        // Empty text matches every book
+    query->author = fields[1];
+    if (fields[2][0] != '\0' && !parse_year_range(fields[2], &query->year_from, &query->year_to)) return usage;
+    if (strcmp(fields[3], "borrowed") == 0) {
+        query->status = 1;
+    } else if (strcmp(fields[3], "available") == 0) {
+        query->status = 0;
+    } else if (fields[3][0] != '\0' && strcmp(fields[3], "all") != 0) {
+        return "which books? (all, borrowed or available)";
+    }
+    return NULL;
+}
+
+// Find the books matching every given field: find;TITLE;AUTHOR;YEARS;STATUS
+static const char *run_find(FILE *out, long long line, char *args, IdList *results) {
+    const char *usage = "usage: find;TITLE;AUTHOR;FROM-TO;all|borrowed|available";
+    char *fields[4];                                 // TITLE, AUTHOR, YEARS, STATUS
+    if (!split_batch_fields(args, fields, 4)) return usage;
+    ScanQuery query;
+    const char *error = parse_query_fields(fields, &query, usage);
+    if (error != NULL) return error;
+    if (!scan_books(&query, results)) return "out of memory";
+    print_batch_ids(out, line, results);
+    return NULL;
+}
+
+// Write every book matching the given fields: export;TITLE;AUTHOR;YEARS;STATUS;FORMAT
+// Like list, the books come from a catalog view; nothing is collected first.
+static const char *run_export(FILE *out, long long line, char *args, CatalogView *view) {
+    const char *usage = "usage: export;TITLE;AUTHOR;FROM-TO;all|borrowed|available;FORMAT";
+    char *fields[5];                                 // TITLE, AUTHOR, YEARS, STATUS, FORMAT
+    if (!split_batch_fields(args, fields, 5)) return usage;
+    ScanQuery query;
+    const char *error = parse_query_fields(fields, &query, usage);
+    if (error != NULL) return error;
+    int format = parse_render_format(fields[4]);
+    if (format == -1) return "unknown format (human, compact, tsv, jsonl or text)";
+    long long written = stream_export_books(out, view, &query, format, NULL, NULL);
+    if (written < 0) return "out of memory";
+    fprintf(out, "%lld ok %lld\n", line, written);
+    return NULL;
+}
+
+// Add the books of a text file that the library does not have yet: merge;FILE
+static const char *run_merge(FILE *out, long long line, const char *args, int journal) {
+    if (args[0] == '\0') return "usage: merge;FILE";
+    ImportStats stats;
+    int ok = stream_merge_books(args, &stats, NULL, NULL);
+    if (journal && stats.imported > 0) {
+        journal_checkpoint();                        // Merged books are not journaled one by one: save them all
+    }
+    if (!ok) return stats.lines == 0 ? "could not read file" : "merge stopped early (out of memory or read error)";
+    fprintf(out, "%lld ok %lld %lld %lld\n", line, stats.imported, stats.duplicates, stats.errors); // Added, duplicates, bad lines
+    return NULL;
+}
+
+// Complete the start of a title or author: complete;FIELD;PREFIX
+static const char *run_complete(FILE *out, long long line, char *args) {
+    char *prefix = strchr(args, ';');
+    if (prefix == NULL) return "usage: complete;titles|authors;PREFIX";
+    *prefix++ = '\0';
+    int field = strcmp(args, "titles") == 0 ? PREFIX_TITLES : strcmp(args, "authors") == 0 ? PREFIX_AUTHORS : -1;
+    if (field == -1) return "complete what? (titles or authors)";
+    Completion completions[PREFIX_DEFAULT_RESULTS];
+    int found = prefix_complete(field, prefix, PREFIX_DEFAULT_RESULTS, completions);
+    if (found < 0) return "out of memory";
+    for (int c = 0; c < found; c++) {                // Texts may contain spaces: one per line
+        fprintf(out, "%d\t%d\t%s\n", completions[c].books, completions[c].id, completions[c].text);
+    }
+    fprintf(out, "%lld ok %d\n", line, found);
+    return NULL;
+}
+
+// Report loan figures: circulation;books|authors|decades
+static const char *run_circulation(FILE *out, long long line, const char *args) {
+    int count;
+    if (strcmp(args, "books") == 0 || strcmp(args, "authors") == 0) {
+        LoanRank ranks[LEDGER_DEFAULT_RESULTS];
+        int books = args[0] == 'b';
+        count = books ? ledger_top_books(LEDGER_DEFAULT_RESULTS, ranks) : ledger_top_authors(LEDGER_DEFAULT_RESULTS, ranks);
+        const Book *library = get_library_address();
+        int shown = 0;                               // Books removed since the ranking was read are left out
+        for (int i = 0; i < count; i++) {            // Titles and names may contain spaces: one per line
+            if (books) {
+                int slot = find_book_by_id((int) ranks[i].key);
+                if (slot == -1) {
+                    continue;
+                }
+                fprintf(out, "%d\t%u\t%s\n", ranks[i].count, ranks[i].key, library[slot].title);
+            } else {
+                int on_loan;
+                long long loans;
+                ledger_author(ranks[i].key, &on_loan, &loans);
+                fprintf(out, "%d\t%lld\t%s\n", on_loan, loans, author_dict_name(ranks[i].key));
+            }
+            shown++;
+        }
+        count = shown;
+    } else if (strcmp(args, "decades") == 0) {
+        DecadeLoans decades[LEDGER_DECADES];
+        count = ledger_decades(decades);
+        for (int i = 0; i < count; i++) {
+            fprintf(out, "%d\t%d\t%lld\n", decades[i].first_year, decades[i].on_loan, decades[i].loans);
+        }
+    } else {
+        return "circulation of what? (books, authors or decades)";
+    }
+    fprintf(out, "%lld ok %d\n", line, count);
+    return NULL;
+}
+
+// Write one page of the library: list;WHICH;FORMAT;OFFSET;LIMIT
+// The books come from a catalog view, so a long listing never mixes states.
+static const char *run_list(FILE *out, long long line, char *args, CatalogView *view) {
+    char *fields[4];                                 // WHICH, FORMAT, OFFSET, LIMIT
+    for (int f = 0; f < 4; f++) {
+        fields[f] = args;
+        args = strchr(args, ';');
+        if (args == NULL && f < 3) return "usage: list;all|borrowed|available;FORMAT;OFFSET;LIMIT";
+        if (args != NULL) *args++ = '\0';
+    }
+    int status = strcmp(fields[0], "all") == 0 ? -1 : strcmp(fields[0], "borrowed") == 0 ? 1 :
+                 strcmp(fields[0], "available") == 0 ? 0 : -2; // Which books to list
+    int format = parse_render_format(fields[1]);
+    int offset, limit;
+    if (status == -2) return "list what? (all, borrowed or available)";
+    if (format == -1) return "unknown format (human, compact, tsv, jsonl or text)";
+    if (!parse_batch_int(fields[2], &offset) || !parse_batch_int(fields[3], &limit)) return "offset and limit must be numbers";
+
+    CatalogView *own = view == NULL ? catalog_view_open() : NULL; // No view given: the catalog as it is now
+    if (view == NULL && own == NULL) return "out of memory";
+    if (view == NULL) view = own;
+    Renderer r;
+    render_begin(&r, out, format, offset, limit);
+    const Book *book;
+    int borrowed;
+    while ((book = catalog_view_next(view, &borrowed)) != NULL) {
+        if ((status == -1 || borrowed == status) && !render_book(&r, book, borrowed)) { // Limit reached
+            break;
+        }
+    }
+    render_end(&r);
+    if (own != NULL) catalog_view_close(own);
+    fprintf(out, "%lld ok %lld\n", line, r.shown);
+    return NULL;
+}
+
+// Execute one command (`args` is the text after the command name, or "")
+// Returns NULL on success (after printing the result), or the error to print.
+static const char *run_command(FILE *out, long long line, const char *command, char *args, IdList *results, int journal,
+                               CatalogView *view) {
+    int id;
+    if (strcmp(command, "add") == 0) {               // Author and year are taken from the right: titles may contain ';'
+        char *year_field = strrchr(args, ';');
+        if (year_field == NULL) return "usage: add;Title;Author;Year";
+        *year_field++ = '\0';
+        char *author = strrchr(args, ';');
+        int year;
+        if (author == NULL || args[0] == ';' || author[1] == '\0') return "usage: add;Title;Author;Year";
+        *author++ = '\0';
+        if (!parse_batch_int(year_field, &year)) return "year is not a number";
+        const char *error = book_text_error(args, author);
+        if (error != NULL) return error;
+        id = add_book(args, author, year);
+        if (id == -1) return "out of memory";
+        if (journal) journal_log_add(id, args, author, year);
+        fprintf(out, "%lld ok %d\n", line, id);
+        return NULL;
+    }
+    if (strcmp(command, "remove") == 0) {
+        if (!parse_batch_int(args, &id)) return "book ID is not a number";
+        if (!remove_book(id)) return "book not found";
+        if (journal) journal_log_remove(id);
+        fprintf(out, "%lld ok %d\n", line, id);
+        return NULL;
+    }
+    if (strcmp(command, "borrow") == 0 || strcmp(command, "return") == 0) {
+        int borrowing = command[0] == 'b';           // Which way the status changes
+        if (!parse_batch_int(args, &id)) return "book ID is not a number";
+        int status = borrowing ? borrow_book(id) : return_book(id);
+        if (status == LOAN_NOT_FOUND) return "book not found";
+        if (status == LOAN_UNCHANGED) return borrowing ? "book is already borrowed" : "book is not borrowed";
+        if (journal) journal_log_borrowed(id, borrowing);
+        fprintf(out, "%lld ok %d\n", line, id);
+        return NULL;
+    }
+    if (strcmp(command, "search") == 0) {
+        if (!search_by_title(args, results)) return "out of memory";
+    } else if (strcmp(command, "author") == 0) {
+        if (!search_by_author(args, results)) return "out of memory";
+    } else if (strcmp(command, "years") == 0) {
+        int from, to;
+        if (!parse_year_range(args, &from, &to)) return "usage: years;FROM-TO";
+        if (!search_by_year_range(from, to, results)) return "out of memory";
+    } else if (strcmp(command, "rank") == 0) {
+        RankedHit hits[RANKED_MAX_RESULTS];
+        int found = search_ranked(args, RANKED_MAX_RESULTS, hits);
+        results->count = 0;
+        for (int h = 0; h < found; h++) {            // Best first, not ID order
+            if (!id_list_push(results, hits[h].id)) return "out of memory";
+        }
+    } else if (strcmp(command, "find") == 0) {
+        return run_find(out, line, args, results);
+    } else if (strcmp(command, "complete") == 0) {
+        return run_complete(out, line, args);
+    } else if (strcmp(command, "circulation") == 0) {
+        return run_circulation(out, line, args);
+    } else if (strcmp(command, "list") == 0) {
+        return run_list(out, line, args, view);
+    } else if (strcmp(command, "export") == 0) {
+        return run_export(out, line, args, view);
+    } else if (strcmp(command, "merge") == 0) {
+        return run_merge(out, line, args, journal);
+    } else if (strcmp(command, "count") == 0) {
+        fprintf(out, "%lld ok %d %d\n", line, *get_book_count_address(), count_borrowed_books()); // Total and borrowed
+        return NULL;
+    } else {
+        return "unknown command";
+    }
+    print_batch_ids(out, line, results);
+    return NULL;
+}
+
+// Function to find the book a borrow or return line is about
+int batch_status_id(const char *text) {
+    const char *args = strchr(text, ';');
+    int id;
+    return args != NULL && parse_batch_int(args + 1, &id) ? id : 0;
+}
+
+// Function to classify a command line by what it changes
+int batch_command_kind(const char *text) {
+    size_t length = strcspn(text, ";");              // Length of the command name
+    if ((length == 3 && strncmp(text, "add", 3) == 0) || (length == 6 && strncmp(text, "remove", 6) == 0) ||
+        (length == 5 && strncmp(text, "merge", 5) == 0)) {
+        return BATCH_WRITES;
+    }
+    if ((length == 6 && strncmp(text, "borrow", 6) == 0) || (length == 6 && strncmp(text, "return", 6) == 0)) {
+        return BATCH_STATUS;
+    }
+    if ((length == 4 && strncmp(text, "list", 4) == 0) || (length == 6 && strncmp(text, "export", 6) == 0)) {
+        return BATCH_VIEW;
+    }
+    return BATCH_READS;
+}
+
+// Function to run one command line and write its result
+int batch_execute(FILE *out, long long line, char *text, IdList *results, int journal, CatalogView *view) {
+    char *args = strchr(text, ';');                  // Split off the command name
+    if (args != NULL) {
+        *args++ = '\0';
+    } else {
+        args = text + strlen(text);                  // No arguments
+    }
+    const char *error = run_command(out, line, text, args, results, journal, view);
+    if (error != NULL) {
+        fprintf(out, "%lld error %s\n", line, error);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to run a batch of commands
+// Commands go straight to the core operations (no prompts, no journal); the
+// caller persists the library once after the whole batch.
+void run_batch(FILE *in, FILE *out, BatchStats *stats) {
+    char *text = NULL;                               // Current line (grown by getline)
+    size_t capacity = 0;
+    long long line = 0;
+    IdList results = {0};                            // Reused by every search
+    stats->commands = 0;
+    stats->failed = 0;
+    while (getline(&text, &capacity, in) != -1) {
+        line++;
+        text[strcspn(text, "\r\n")] = '\0';          // Strip the line ending
+        if (text[0] == '\0' || text[0] == '#') {     // Blank line or comment
+            continue;
+        }
+        stats->commands++;
+        if (!batch_execute(out, line, text, &results, 0, NULL)) {
+            stats->failed++;
+        }
+    }
+    id_list_free(&results);
+    free(text);
+}
+
+// ==================== server.h ====================
+#ifndef SERVER_H               // Include guard to prevent multiple inclusions
+#define SERVER_H               // Define the include guard macro
+
+// Daemon mode: serves the batch commands (see batch.h) over a Unix domain
+// socket. Each line a client sends is one command; each reply is the line
+// batch mode would print, numbered per connection.
+#define SERVER_THREADS 8               // Worker threads (each serves one connection at a time)
+#define SERVER_BACKLOG 128             // Connections waiting to be accepted
+#define SERVER_COMMIT_INTERVAL_MS 20   // How often the journal is committed while clients are idle
+#define SERVER_STATUS_LOCKS 32         // Borrow/return locks, picked by book ID (a few per worker)
+
+int run_server(const char *socket_path, int threads); // Serve until SIGINT or SIGTERM; returns 0 on a clean stop
+
+#endif // SERVER_H             // End of include guard
+
+// ==================== server.c ====================
+#include <stdio.h>             // For fdopen, getline, fprintf functions
+#include <stdlib.h>            // For calloc, free functions
+#include <string.h>            // For strcspn, strncpy functions
+#include <signal.h>            // For sigaction function
+#include <errno.h>             // For errno, EINTR
+#include <poll.h>              // For poll function
+#include <pthread.h>           // For threads, rwlock, mutex and condition variable
+#include <unistd.h>            // For close, unlink, dup, fsync functions
+#include <sys/socket.h>        // For socket, bind, listen, accept functions
+#include <sys/un.h>            // For sockaddr_un
+
+#include "server.h"            // Include our server declarations
+#include "batch.h"             // Include the command executor
+#include "journal.h"           // Include journal commits
+#include "catalog_view.h"      // Include views for listings
+
+// Locking: searches, borrows and returns share the library under the read
+// lock; add and remove take it exclusively. A listing only holds the locks
+// while it opens a catalog view, then reads the view with no lock at all.
+// A borrow or return flips its bit with a compare-and-swap
+// (change_book_borrowed), so of two clients racing for one book exactly one
+// succeeds. It holds only the status lock of its book (one of
+// SERVER_STATUS_LOCKS) around the change and its journal record, so status
+// changes of different books run in parallel while each book's records stay
+// in order; journal_lock is taken just for the append. Adds and removes
+// append under the exclusive library lock. Opening a view or starting a
+// compaction takes every status lock, so no change is half done.
+// Lock order: library_lock, status locks (ascending), journal_lock.
+static pthread_rwlock_t library_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t status_locks[SERVER_STATUS_LOCKS];
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Accepted connections waiting for a worker (ring buffer)
+static int queue[SERVER_BACKLOG];
+static int queue_head = 0;                   // Next connection to hand out
+static int queue_count = 0;                  // Connections waiting
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+
+static volatile sig_atomic_t stopping = 0;   // Set by SIGINT/SIGTERM
+static int *active = NULL;                   // Connection each worker is serving (-1 = none)
+static int active_count = 0;                 // Number of workers
+
+static void request_stop(int signal_number) {
+    (void) signal_number;
+    stopping = 1;
+}
+
+// Take (1) or release (0) every status lock: no borrow or return is in progress meanwhile
+static void all_status_locks(int take) {
+    for (int l = 0; l < SERVER_STATUS_LOCKS; l++) {
+        if (take) pthread_mutex_lock(&status_locks[l]); else pthread_mutex_unlock(&status_locks[l]);
+    }
+}
+
+// Run a borrow or return: the status change and its journal record under the book's lock
+static int execute_status(FILE *out, long long number, char *text, IdList *results) {
+    int id = batch_status_id(text);                  // Read before batch_execute splits the line
+    int borrowing = text[0] == 'b';
+    pthread_mutex_t *lock = &status_locks[(unsigned int) id % SERVER_STATUS_LOCKS];
+    pthread_mutex_lock(lock);
+    int ok = batch_execute(out, number, text, results, 0, NULL); // CAS on the book's bit (and the ledger)
+    if (ok) {                                        // Only a changed status is journaled
+        pthread_mutex_lock(&journal_lock);
+        journal_log_borrowed(id, borrowing);
+        pthread_mutex_unlock(&journal_lock);
+    }
+    pthread_mutex_unlock(lock);
+    return ok;
+}
+
+// Run one command under the lock it needs
+static int execute_locked(FILE *out, long long number, char *text, IdList *results) {
+    int kind = batch_command_kind(text);
+    if (kind == BATCH_VIEW) {                        // Open a view with no change in progress, then read it unlocked
+        pthread_rwlock_rdlock(&library_lock);
+        all_status_locks(1);
+        pthread_mutex_lock(&journal_lock);
+        CatalogView *view = catalog_view_open();
+        pthread_mutex_unlock(&journal_lock);
+        all_status_locks(0);
+        pthread_rwlock_unlock(&library_lock);
+        if (view == NULL) {
+            fprintf(out, "%lld error out of memory\n", number);
+            return 0;
+        }
+        int ok = batch_execute(out, number, text, results, 0, view); // Adds, removes and borrows go on meanwhile
+        catalog_view_close(view);
+        return ok;
+    }
+    if (kind == BATCH_WRITES) {
+        pthread_rwlock_wrlock(&library_lock);        // Indexes and arrays change: nobody else inside
+    } else {
+        pthread_rwlock_rdlock(&library_lock);        // Many readers (and CAS status changes) at once
+    }
+    int ok;
+    if (kind == BATCH_READS) {
+        ok = batch_execute(out, number, text, results, 0, NULL);
+    } else if (kind == BATCH_STATUS) {
+        ok = execute_status(out, number, text, results);
+    } else {
+        pthread_mutex_lock(&journal_lock);           // Change and journal record in one order
+        ok = batch_execute(out, number, text, results, 1, NULL);
+        pthread_mutex_unlock(&journal_lock);
+    }
+    pthread_rwlock_unlock(&library_lock);
+    return ok;
+}
+
+// Serve one client until it disconnects
+static void serve_connection(int fd) {
+    int out_fd = dup(fd);                            // Separate FILEs for reading and writing
+    FILE *in = fdopen(fd, "r");
+    FILE *out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+    if (in == NULL || out == NULL) {
+        if (in) fclose(in); else close(fd);
+        if (out) fclose(out); else if (out_fd >= 0) close(out_fd);
+        return;
+    }
+    char *text = NULL;                               // Current request (grown by getline)
+    size_t capacity = 0;
+    long long number = 0;                            // Requests on this connection
+    IdList results = {0};                            // Reused by every search
+    while (!stopping && getline(&text, &capacity, in) != -1) {
+        text[strcspn(text, "\r\n")] = '\0';
+        if (text[0] == '\0') {                       // Ignore empty lines
+            continue;
+        }
+        execute_locked(out, ++number, text, &results);
+        if (fflush(out) != 0) {                      // Client went away
+            break;
+        }
+    }
+    id_list_free(&results);
+    free(text);
+    fclose(out);
+    fclose(in);
+}
+
+// Worker thread: take connections from the queue and serve them
+static void *worker(void *arg) {
+    int index = (int) (long) arg;                    // This worker's entry in active[]
+    while (1) {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == 0 && !stopping) {
+            pthread_cond_wait(&queue_ready, &queue_lock);
+        }
+        if (queue_count == 0) {                      // Stopping and nothing left
+            pthread_mutex_unlock(&queue_lock);
+            return NULL;
+        }
+        int fd = queue[queue_head];
+        queue_head = (queue_head + 1) % SERVER_BACKLOG;
+        queue_count--;
+        active[index] = fd;
+        pthread_mutex_unlock(&queue_lock);
+
+        serve_connection(fd);
+
+        pthread_mutex_lock(&queue_lock);
+        active[index] = -1;
+        pthread_mutex_unlock(&queue_lock);
+    }
+}
+
+// Commit waiting journal records (group commit across all clients)
+// Only this thread writes the journal file. Records are handed to the kernel
+// under journal_lock, but the slow fsync runs without any lock, so clients
+// keep borrowing and returning while the disk catches up.
+static void commit_journal() {
+    pthread_mutex_lock(&journal_lock);
+    int written = journal_write();                   // Waiting records -> file (no fsync)
+    int fd = written > 0 ? journal_sync_fd() : -1;   // Our own descriptor: a merge may checkpoint meanwhile
+    if (written > 0 && fd < 0) {
+        journal_sync();                              // No descriptor to spare: fsync under the lock
+    }
+    pthread_mutex_unlock(&journal_lock);
+    if (fd >= 0) {
+        if (fsync(fd) != 0) {                        // Durable on disk
+            perror("Error writing journal");
+        }
+        close(fd);
+    }
+    pthread_rwlock_rdlock(&library_lock);            // No add/remove half done if a compaction forks
+    all_status_locks(1);                             // nor any borrow or return
+    pthread_mutex_lock(&journal_lock);
+    journal_maintain();                              // Records queued since the write wait for the next tick
+    pthread_mutex_unlock(&journal_lock);
+    all_status_locks(0);
+    pthread_rwlock_unlock(&library_lock);
+}
+
+// Function to run the daemon
+// Accepts connections on `socket_path` and hands them to `threads` workers
+// until SIGINT or SIGTERM arrives. The journal is committed every
+// SERVER_COMMIT_INTERVAL_MS. The caller persists the library afterwards.
+int run_server(const char *socket_path, int threads) {
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path is too long: %s\n", socket_path);
+        return 1;
+    }
+    strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);                             // Remove a socket left by an earlier run
+    if (listener < 0 || bind(listener, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(listener, SERVER_BACKLOG) != 0) {
+        perror(socket_path);
+        if (listener >= 0) close(listener);
+        return 1;
+    }
+
+    struct sigaction action = {0};                   // Stop cleanly on Ctrl-C or kill
+    action.sa_handler = request_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);                        // A vanished client must not kill the server
+
+    for (int l = 0; l < SERVER_STATUS_LOCKS; l++) {
+        pthread_mutex_init(&status_locks[l], NULL);
+    }
+    active_count = threads;
+    active = malloc((size_t) threads * sizeof(int));
+    pthread_t *pool = malloc((size_t) threads * sizeof(pthread_t));
+    if (active == NULL || pool == NULL) {
+        free(active);
+        free(pool);
+        close(listener);
+        return 1;
+    }
+    for (int t = 0; t < threads; t++) {
+        active[t] = -1;
+        pthread_create(&pool[t], NULL, worker, (void *) (long) t);
+    }
+    journal_set_auto_commit(0);                      // Workers only queue records; commit_journal writes them
+    fprintf(stderr, "Serving on %s with %d threads\n", socket_path, threads);
+
+    struct pollfd waiting = {listener, POLLIN, 0};
+    while (!stopping) {
+        int ready = poll(&waiting, 1, SERVER_COMMIT_INTERVAL_MS);
+        commit_journal();                            // Make recent changes durable
+        if (ready <= 0) {                            // Timeout or signal
+            continue;
+        }
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        pthread_mutex_lock(&queue_lock);
+        if (queue_count == SERVER_BACKLOG) {         // Too many clients waiting: turn this one away
+            pthread_mutex_unlock(&queue_lock);
+            close(fd);
+            continue;
+        }
+        queue[(queue_head + queue_count) % SERVER_BACKLOG] = fd;
+        queue_count++;
+        pthread_cond_signal(&queue_ready);
+        pthread_mutex_unlock(&queue_lock);
+    }
+
+    close(listener);                                 // Stop: no new clients, wake every worker
+    unlink(socket_path);
+    pthread_mutex_lock(&queue_lock);
+    for (int t = 0; t < active_count; t++) {
+        if (active[t] >= 0) shutdown(active[t], SHUT_RDWR); // End connections being served
+    }
+    for (; queue_count > 0; queue_count--) {         // Drop connections never served
+        close(queue[queue_head]);
+        queue_head = (queue_head + 1) % SERVER_BACKLOG;
+    }
+    pthread_cond_broadcast(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    for (int t = 0; t < threads; t++) {
+        pthread_join(pool[t], NULL);
+    }
+    free(pool);
+    free(active);
+    active = NULL;
+    commit_journal();
+    journal_set_auto_commit(1);                      // Back to single-threaded use
+    return 0;
+}
+
+// ==================== catalog_gen.h ====================
+#ifndef CATALOG_GEN_H          // Include guard to prevent multiple inclusions
+#define CATALOG_GEN_H          // Define the include guard macro
+
+#include <stdio.h>             // Include FILE
+#include <stddef.h>            // Include size_t
+
+// Synthetic catalogs for benchmarks, written in the load_books text format
+// (ID;Title;Author;Year;IsBorrowed). The same count and seed always give the
+// same file. Titles and authors follow skewed distributions: most titles have
+// 2-5 words from a small vocabulary, and a few authors write many books.
+#define CATALOG_DEFAULT_SEED 42ULL     // Seed used when none is given
+#define CATALOG_BORROWED_PERCENT 10    // Share of books written as borrowed
+#define CATALOG_MAX_AUTHORS (64 * 64 * 27) // Distinct author names the generator can produce
+
+// Writes `count` books with IDs 1..count; returns 1, or 0 if writing failed
+int generate_catalog(FILE *out, long long count, unsigned long long seed);
+// Writes the name of the author with popularity `rank` (0 = most books) into `buffer`
+void catalog_author(int rank, char *buffer, size_t size);
+// Number of authors used for a catalog of `count` books
+int catalog_author_count(long long count);
+
+#endif // CATALOG_GEN_H        // End of include guard
+
+// ==================== catalog_gen.c ====================
+#include <stdio.h>             // For fprintf, fputs functions
+#include <string.h>            // For strlen function
+
+#include "catalog_gen.h"       // Include generator declarations
+
+static const char *title_words[] = {   // Title vocabulary, most frequent first
+    "the", "of", "and", "a", "in", "history", "night", "love", "war", "river",
+    "garden", "king", "house", "world", "life", "secret", "last", "city", "dark", "light",
+    "man", "woman", "time", "stars", "winter", "summer", "sea", "shadow", "empire", "journey",
+    "letters", "silent", "lost", "golden", "road", "fire", "water", "stone", "blood", "island",
+    "children", "mountain", "forest", "queen", "ghost", "song", "dream", "memory", "storm", "glass",
+    "iron", "wind", "bridge", "kingdom", "ocean", "silver", "book", "crown", "harbor", "hunter",
+    "north", "south", "country", "people", "science", "art", "introduction", "guide", "theory", "practice",
+    "modern", "ancient", "american", "english", "french", "new", "old", "great", "little", "black",
+    "white", "red", "blue", "green", "second", "first", "final", "hidden", "broken", "wild",
+    "quiet", "long", "beyond", "between", "under", "after", "before", "without", "against", "toward"
+};
+#define TITLE_WORDS ((int) (sizeof(title_words) / sizeof(title_words[0])))
 
-    int available = 0, borrowed = 0;               // Variables to count available and borrowed books
-    for (int i = 0; i < book_count; i++) {         // Loop through all books
-        if (library[i].is_borrowed) {              // If current book is borrowed
-            borrowed++;                             // Increment borrowed counter
-        } else {                                    // If current book is available
-            available++;                            // Increment available counter
-        }
-    }
+static const char *first_names[64] = { // Author first names
+    "James", "Mary", "John", "Patricia", "Robert", "Jennifer", "Michael", "Linda",
+    "William", "Elizabeth", "David", "Barbara", "Richard", "Susan", "Joseph", "Jessica",
+    "Thomas", "Sarah", "Charles", "Karen", "Daniel", "Nancy", "Matthew", "Lisa",
+    "Anthony", "Margaret", "Mark", "Sandra", "Donald", "Ashley", "Steven", "Emily",
+    "Paul", "Donna", "Andrew", "Michelle", "Joshua", "Carol", "Kenneth", "Amanda",
+    "Kevin", "Melissa", "Brian", "Deborah", "George", "Stephanie", "Edward", "Rebecca",
+    "Haruki", "Chimamanda", "Gabriel", "Toni", "Fyodor", "Virginia", "Orhan", "Isabel",
+    "Kazuo", "Zadie", "Jorge", "Ursula", "Italo", "Clarice", "Salman", "Elena"
+};
 
-    printf("Available books: %d\n", available);    // Display available count
-    printf("Borrowed books: %d\n", borrowed);      // Display borrowed count
+static const char *last_names[64] = {  // Author last names
+    "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller", "Davis",
+    "Rodriguez", "Martinez", "Hernandez", "Lopez", "Gonzalez", "Wilson", "Anderson", "Thomas",
+    "Taylor", "Moore", "Jackson", "Martin", "Lee", "Perez", "Thompson", "White",
+    "Harris", "Sanchez", "Clark", "Ramirez", "Lewis", "Robinson", "Walker", "Young",
+    "Allen", "King", "Wright", "Scott", "Torres", "Nguyen", "Hill", "Flores",
+    "Green", "Adams", "Nelson", "Baker", "Hall", "Rivera", "Campbell", "Mitchell",
+    "Murakami", "Adichie", "Marquez", "Morrison", "Dostoevsky", "Woolf", "Pamuk", "Allende",
+    "Ishiguro", "Okonkwo", "Borges", "Le Guin", "Calvino", "Lispector", "Rushdie", "Ferrante"
+};
+
+static const int title_length_weights[] = { // Relative frequency of 1..12 word titles
+    8, 18, 22, 18, 12, 8, 5, 4, 2, 1, 1, 1
+};
+
+// splitmix64: small, fast and identical on every platform (unlike rand())
+static unsigned long long catalog_next(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
-// View all books
-void view_all_books(const Book books[], int count) {
-    if (count == 0) {                              // Check if no books exist
-        printf(" No books in the library.\n");     // Display message
-        return;                                     // Exit function
-    }
+// Uniform value in [0, 1)
+static double catalog_uniform(unsigned long long *state) {
+    return (double) (catalog_next(state) >> 11) / 9007199254740992.0;
+}
 
-    printf(" All Books in the Library:\n");        // Display section header
-    printf("--------------------------------------------------\n"); // Display separator
+// Index in [0, n) skewed towards 0: u^power puts most of the weight on low indexes
+static int catalog_skewed(unsigned long long *state, int n, int power) {
+    double u = catalog_uniform(state);
+    double weight = u;
+    for (int p = 1; p < power; p++) weight *= u;
+    int index = (int) (weight * n);
+    return index < n ? index : n - 1;
+}
+
+int catalog_author_count(long long count) {
+    long long authors = count / 4 + 16;           // About four books per author on average
+    return authors < CATALOG_MAX_AUTHORS ? (int) authors : CATALOG_MAX_AUTHORS;
+}
 
-    for (int i = 0; i < count; i++) {             // Loop through all books
-        printf("ID: %d\nTitle: %s\nAuthor: %s\nYear: %d\nBorrowed: %s\n\n", // Display book details
-               books[i].id,                         // Book ID
-               books[i].title,                      // Book title
-               books[i].author,                     // Book author
-               books[i].publication_year,           // Publication year
-               books[i].is_borrowed ? "Yes" : "No"); // Borrowed status using ternary operator
+void catalog_author(int rank, char *buffer, size_t size) {
+    const char *first = first_names[rank % 64];
+    const char *last = last_names[(rank / 64 + rank * 5) % 64]; // Popular authors do not all share a surname
+    int initial = rank / (64 * 64);               // Beyond 4096 names, add a middle initial
+    if (initial == 0) {
+        snprintf(buffer, size, "%s %s", first, last);
+    } else {
+        snprintf(buffer, size, "%s %c. %s", first, 'A' + (initial - 1) % 26, last);
     }
 }
 
-// View borrowed books
-void view_borrowed_books(const Book books[], int count) {
-    int found = 0;                                 // Flag to track if any borrowed books found
+int generate_catalog(FILE *out, long long count, unsigned long long seed) {
+    unsigned long long state = seed;
+    int authors = catalog_author_count(count);
+    int weight_total = 0;
+    for (int w = 0; w < 12; w++) weight_total += title_length_weights[w];
 
-    printf(" Borrowed Books:\n");                  // Display section header
-    printf("--------------------------------------------------\n"); // Display separator
+    for (long long id = 1; id <= count; id++) {
+        char title[256];
+        size_t length = 0;
+        int pick = (int) (catalog_next(&state) % (unsigned long long) weight_total);
+        int words = 1;                            // Title length from the weight table
+        while (pick >= title_length_weights[words - 1]) pick -= title_length_weights[words++ - 1];
+        for (int w = 0; w < words; w++) {
+            const char *word = title_words[catalog_skewed(&state, TITLE_WORDS, 2)];
+            length += (size_t) snprintf(title + length, sizeof(title) - length, "%s%c%s",
+                                        w == 0 ? "" : " ", w == 0 ? (char) (word[0] - 'a' + 'A') : word[0], word + 1);
+        }
+        if (catalog_next(&state) % 100 < 15 && length < sizeof(title) - 64) { // Some books have a subtitle
+            length += (size_t) snprintf(title + length, sizeof(title) - length, ": A %s of the %s",
+                                        title_words[5 + catalog_skewed(&state, TITLE_WORDS - 5, 1)],
+                                        title_words[5 + catalog_skewed(&state, TITLE_WORDS - 5, 2)]);
+        }
 
-    for (int i = 0; i < count; i++) {             // Loop through all books
-        if (books[i].is_borrowed) {                // If current book is borrowed
-            found = 1;                              // Set found flag
-            printf("ID: %d\nTitle: %s\nAuthor: %s\nYear: %d\n\n", // Display borrowed book details
-                   books[i].id,                     // Book ID
-                   books[i].title,                  // Book title
-                   books[i].author,                 // Book author
-                   books[i].publication_year);      // Publication year
+        char author[64];
+        catalog_author(catalog_skewed(&state, authors, 3), author, sizeof(author));
+
+        int year;                                 // Mostly recent books, with a long tail of older ones
+        if (catalog_next(&state) % 100 < 70) {
+            year = 2024 - catalog_skewed(&state, 75, 2);
+        } else {
+            year = 1700 + (int) (catalog_next(&state) % 250);
         }
-    }
+        int borrowed = catalog_next(&state) % 100 < CATALOG_BORROWED_PERCENT;
 
-    if (!found) {                                  // If no borrowed books found
-        printf(" No books are currently borrowed.\n"); // Display message
+        if (fprintf(out, "%lld;%s;%s;%d;%d\n", id, title, author, year, borrowed) < 0) {
+            return 0;
+        }
     }
+    return fflush(out) == 0;
 }
 
-// ==================== user.h ====================
-#ifndef USER_H                 // Include guard to prevent multiple inclusions
-#define USER_H                 // Define the include guard macro
-
-#include "book.h"              // Include Book structure definition
-#include <stdio.h>             // Include standard I/O functions
-#include <stdlib.h>            // Include standard library functions
-#include <ctype.h>             // Include character type functions
+// ==================== bench.c ====================
+// Stand-alone benchmark program (has its own main; not linked into library_system)
+#include <stdio.h>             // For printf function
+#include <stdlib.h>            // For malloc, free, rand functions
+#include <string.h>            // For strncpy, strstr functions
+#include <ctype.h>             // For tolower function
+#include <time.h>              // For clock_gettime function
 
-// Function declarations only (no definitions in header)
-void viewAvailableBooks();     // Display all available (non-borrowed) books
-void borrowBook();             // Allow user to borrow a book
-void returnBook();             // Allow user to return a borrowed book
-void searchByTitle();          // Search books by title
-void filterByAuthor();         // Filter search results by author
-void filterByYear();           // Filter search results by publication year
-void toLowerStr(char *str);    // Convert string to lowercase
-void init_user_pointers();     // Initialize pointers to admin data
+#include "text_search.h"       // Include the matcher being measured
 
-#endif                         // End of include guard
+#define BENCH_TITLES 200000    // Number of synthetic titles to search
+#define BENCH_ROUNDS 5         // Times each query is run over all titles
 
-// ==================== user.c ====================
-#include "user.h"              // Include user function declarations
-#include <string.h>            // For: strcspn, strncpy, strstr functions
-#include <ctype.h>             // For: tolower function
-#include <stdio.h>             // Include standard I/O functions
-#include <stdlib.h>            // Include standard library functions
-#include "book.h"              // Include Book structure and related functions
-#include "admin.h"             // Include admin functions to access global data
+static const char *bench_words[] = { // Vocabulary for synthetic titles
+    "The", "Secret", "History", "of", "a", "Silent", "River", "and", "Garden", "Night",
+    "Lost", "Empire", "Winter", "Journey", "Shadow", "Kingdom", "Letters", "Ocean", "Last", "Light"
+};
 
-#define MAX_RESULTS 100        // Maximum number of search results to store
+// Current time in seconds from a monotonic clock
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
 
-// Get pointers to admin data - these will point to global variables in admin.c
-static Book *library_ptr = NULL;      // Pointer to the library array
-static int *book_count_ptr = NULL;    // Pointer to book count variable
-static int *next_id_ptr = NULL;       // Pointer to next ID variable
+// Previous implementation: copy and lowercase both strings, then strstr
+static int legacy_contains(const char *title, const char *query) {
+    char lower_query[100];                         // Same buffer sizes as the old searchByTitle
+    char lower_title[100];
+    strncpy(lower_query, query, sizeof(lower_query));
+    lower_query[sizeof(lower_query) - 1] = '\0';
+    for (int i = 0; lower_query[i]; i++) lower_query[i] = (char) tolower((unsigned char) lower_query[i]);
+    strncpy(lower_title, title, sizeof(lower_title));
+    lower_title[sizeof(lower_title) - 1] = '\0';
+    for (int i = 0; lower_title[i]; i++) lower_title[i] = (char) tolower((unsigned char) lower_title[i]);
+    return strstr(lower_title, lower_query) != NULL;
+}
 
-Book searchResults[MAX_RESULTS];      // Array to store search results
-int searchResultCount = 0;            // Counter for number of search results
+static int vector_contains(const char *title, const char *query) {
+    return find_ignore_case(title, query) != NULL;
+}
 
-// Initialize pointers to admin data
-void init_user_pointers() {
-    library_ptr = get_library_address();      // Get address of library array from admin.c
-    book_count_ptr = get_book_count_address(); // Get address of book_count from admin.c
-    next_id_ptr = get_next_id_address();       // Get address of next_id from admin.c
+static int scalar_contains(const char *title, const char *query) {
+    return find_ignore_case_scalar(title, query) != NULL;
 }
 
-// Function to convert string to lowercase
-void toLowerStr(char *str) {
-    for (int i = 0; str[i]; i++) {            // Loop through each character until null terminator
-        str[i] = tolower((unsigned char) str[i]); // Convert character to lowercase
+// Run one matcher over every title and print its throughput
+static void bench_matcher(const char *name, int (*matcher)(const char *, const char *),
+                          char **titles, const char *query) {
+    long hits = 0;                                 // Keeps the work from being optimized away
+    double start = bench_now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_TITLES; i++) {
+            hits += matcher(titles[i], query);
+        }
     }
+    double elapsed = bench_now() - start;
+    printf("%-8s %-16s %8.1f ns/title  %ld hits\n", name, query,
+           elapsed * 1e9 / ((double) BENCH_TITLES * BENCH_ROUNDS), hits / BENCH_ROUNDS);
 }
 
-//**************************Search By Title******************************//
-
-void searchByTitle() {
-    // Initialize pointers if not done already
-    if (library_ptr == NULL) {                 // Check if pointers are not initialized
-        init_user_pointers();                  // Initialize pointers to admin data
+int main() {
+    srand(42);                                     // Same titles on every run
+    char **titles = malloc(BENCH_TITLES * sizeof(char *));
+    if (titles == NULL) {
+        return 1;
+    }
+    for (int i = 0; i < BENCH_TITLES; i++) {       // Build titles of 2-12 words
+        char buffer[256] = "";
+        int words = 2 + rand() % 11;
+        for (int w = 0; w < words; w++) {
+            strcat(buffer, bench_words[rand() % 20]);
+            if (w + 1 < words) strcat(buffer, " ");
+        }
+        titles[i] = malloc(strlen(buffer) + 1);
+        strcpy(titles[i], buffer);
     }
-    
-    char search_title[100];                    // Buffer to store search term
-    printf("Enter the book title to search: "); // Prompt user for search term
-    clear_input_buffer();                      // Clear input buffer
-    fgets(search_title, sizeof(search_title), stdin); // Read search term with spaces
-    search_title[strcspn(search_title, "\n")] = 0; // Remove newline character
 
-    int found = 0;                             // Flag to track if any books found
-    searchResultCount = 0;                     // Reset search results counter
+    const char *queries[] = { "a", "of", "river", "SILENT garden", "kingdom of light" };
+    for (int q = 0; q < 5; q++) {                  // Compare the three implementations per query
+        bench_matcher("legacy", legacy_contains, titles, queries[q]);
+        bench_matcher("scalar", scalar_contains, titles, queries[q]);
+        bench_matcher("vector", vector_contains, titles, queries[q]);
+    }
 
-    char lower_search_title[100];              // Buffer for lowercase search term
-    strncpy(lower_search_title, search_title, sizeof(lower_search_title)); // Copy search term
-    lower_search_title[sizeof(lower_search_title) - 1] = '\0'; // Ensure null termination
-    toLowerStr(lower_search_title);            // Convert search term to lowercase
+    for (int i = 0; i < BENCH_TITLES; i++) {
+        free(titles[i]);
+    }
+    free(titles);
+    return 0;
+}
 
-    printf("\nSearching through %d books...\n", *book_count_ptr); // Display search info
+// ==================== bench_suite.c ====================
+// Benchmark suite for the library's hot paths (has its own main; links every
+// module except main.c).
+//   library_bench_suite generate COUNT FILE [SEED]   write a synthetic catalog
+//   library_bench_suite run [COUNT...]               benchmark catalogs of each size
+// `run` prints one JSON object per benchmark and catalog size, e.g.
+//   {"benchmark":"find_book_by_id","books":100000,"ops":100000,"ops_per_sec":9.1e+06,
+//    "p50_ns":95,"p99_ns":310,"peak_rss_kb":41236}
+// Each catalog size runs in its own child process, so peak_rss_kb is the
+// high-water mark of that size alone (up to and including that benchmark).
+#include <stdio.h>             // For printf, fopen functions
+#include <stdlib.h>            // For malloc, qsort, strtoll functions
+#include <string.h>            // For strcmp function
+#include <time.h>              // For clock_gettime function
+#include <unistd.h>            // For fork, mkstemp, unlink functions
+#include <sys/resource.h>      // For getrusage
+#include <sys/wait.h>          // For waitpid
 
-    for (int i = 0; i < *book_count_ptr; i++) { // Loop through all books in library
-        char lower_title[100];                  // Buffer for lowercase book title
-        strncpy(lower_title, library_ptr[i].title, sizeof(lower_title)); // Copy book title
-        lower_title[sizeof(lower_title) - 1] = '\0'; // Ensure null termination
-        toLowerStr(lower_title);               // Convert book title to lowercase
+#include "book.h"              // Include IdList
+#include "admin.h"             // Include find_book_by_id, remove_book, count_borrowed_books
+#include "loan_ledger.h"       // Include circulation figures
+#include "user.h"              // Include search_by_title, borrow_book, return_book
+#include "author_index.h"      // Include author_index_lookup (used by filterByAuthor)
+#include "year_index.h"        // Include year_index_range (used by filterByYear)
+#include "data_handler.h"      // Include load_books, save_books, stream_merge_books, stream_export_books
+#include "catalog_gen.h"       // Include the catalog generator
+#include "ranked_search.h"     // Include search_ranked
+#include "scan.h"              // Include scan_books
+#include "prefix_index.h"      // Include prefix_complete
+#include "render.h"            // Include RENDER_TEXT (export_filtered)
+#include "query_cache.h"       // Include query_cache_clear (cold title searches)
 
-        if (strstr(lower_title, lower_search_title)) { // If search term found in title (case-insensitive)
-            searchResults[searchResultCount++] = library_ptr[i]; // Add to search results
-            printf("\nID: %d\nTitle: %s\nAuthor: %s\nYear: %d\nStatus: %s\n", // Display book details
-                   library_ptr[i].id, library_ptr[i].title, library_ptr[i].author,
-                   library_ptr[i].publication_year,
-                   library_ptr[i].is_borrowed ? "Borrowed" : "Available"); // Status using ternary operator
-            found = 1;                          // Set found flag
-        }
-    }
+#define SUITE_FAST_OPS 100000          // Timed calls for lookups, borrows, returns and counts
+#define SUITE_QUERY_OPS 1000           // Timed calls for searches and filters
+#define SUITE_REMOVE_OPS 10000         // Timed removals (at most half the catalog)
+#define SUITE_FILE_ROUNDS 3            // Times the catalog is loaded and saved
+#define SUITE_SCAN_OPS 20              // Timed full scans (per thread setting)
 
-    if (!found) {                              // If no books found
-        printf("No books found with title containing \"%s\".\n", search_title); // Display message
-        return;                                 // Exit function
-    }
+static const char *suite_queries[] = { // Title search terms, from common to rare
+    "the", "history", "river", "night of", "garden", "silent", "the last", "kingdom", "without", "toward"
+};
+#define SUITE_QUERIES ((int) (sizeof(suite_queries) / sizeof(suite_queries[0])))
 
-    // Offer filter options
-    int choice;                                // Variable to store user choice
-    printf("\nFilter search results:\n1. By Author\n2. By Year\n3. Exit\nChoice: "); // Display filter menu
-    scanf("%d", &choice);                      // Read user choice
+static const char *suite_typos[] = {   // Ranked search queries with typos in titles and authors
+    "kingdon", "histroy", "rivre night", "Wiliam Adams", "silnet garden", "Smiht", "withuot", "the last kingdon",
+    "gardn", "towrad"
+};
+#define SUITE_TYPOS ((int) (sizeof(suite_typos) / sizeof(suite_typos[0])))
 
-    switch (choice) {                          // Execute based on user choice
-        case 1: filterByAuthor(); break;       // Filter by author
-        case 2: filterByYear(); break;         // Filter by year
-        case 3: default: break;                // Exit or default case
-    }
+// Current time in seconds from a monotonic clock
+static double suite_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
 }
 
-//**************************filter By Author******************************//
-
-void filterByAuthor() {
-    char author[100];                          // Buffer to store author name
-    printf("Enter author's name to filter: "); // Prompt for author name
-    clear_input_buffer();                      // Clear input buffer
-    fgets(author, sizeof(author), stdin);      // Read author name with spaces
-    author[strcspn(author, "\n")] = 0;         // Remove newline character
+static int compare_samples(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
 
-    int found = 0;                             // Flag to track if any books found
-    for (int i = 0; i < searchResultCount; i++) { // Loop through search results only
-        if (strstr(searchResults[i].author, author)) { // If author name found in book's author
-            printf("\nID: %d\nTitle: %s\nAuthor: %s\nYear: %d\nStatus: %s\n", // Display book details
-                   searchResults[i].id,         // Book ID
-                   searchResults[i].title,      // Book title
-                   searchResults[i].author,     // Book author
-                   searchResults[i].publication_year, // Publication year
-                   searchResults[i].is_borrowed ? "Borrowed" : "Available"); // Status
-            found = 1;                          // Set found flag
-        }
+// Print one result line; `samples` holds the seconds taken by each call
+static void report(const char *name, long long books, double *samples, int count) {
+    if (count == 0) {
+        return;
     }
+    double total = 0;
+    for (int i = 0; i < count; i++) total += samples[i];
+    qsort(samples, (size_t) count, sizeof(double), compare_samples);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);               // ru_maxrss is in kilobytes on Linux
+    printf("{\"benchmark\":\"%s\",\"books\":%lld,\"ops\":%d,\"ops_per_sec\":%.4g,"
+           "\"p50_ns\":%.0f,\"p99_ns\":%.0f,\"peak_rss_kb\":%ld}\n",
+           name, books, count, total > 0 ? count / total : 0.0,
+           samples[(int) (0.50 * (count - 1) + 0.5)] * 1e9,
+           samples[(int) (0.99 * (count - 1) + 0.5)] * 1e9, usage.ru_maxrss);
+    fflush(stdout);
+}
 
-    if (!found) {                              // If no books found by that author
-        printf("No books found by that author in the search results.\n"); // Display message
-    }
+// Random ID of the catalog (1..books)
+static int random_id(unsigned int *seed, long long books) {
+    return 1 + (int) (((unsigned long long) rand_r(seed) * 65536ULL + (unsigned long long) rand_r(seed)) % (unsigned long long) books);
 }
 
-//**************************filter By Year******************************//
+// Run every benchmark on a catalog of `books` books; returns 0 on success
+static int run_suite(long long books, unsigned long long seed) {
+    char catalog[] = "/tmp/library_bench_XXXXXX";  // Generated catalog
+    char saved[] = "/tmp/library_bench_XXXXXX";    // save_books output
+    int catalog_fd = mkstemp(catalog);
+    int saved_fd = mkstemp(saved);
+    if (catalog_fd < 0 || saved_fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(saved_fd);
+    FILE *out = fdopen(catalog_fd, "w");
+    int written = out != NULL && generate_catalog(out, books, seed);
+    if (out == NULL || fclose(out) != 0 || !written) {
+        perror(catalog);
+        unlink(catalog);
+        unlink(saved);
+        return 1;
+    }
 
-void filterByYear() {
-    int year;                                  // Variable to store publication year
-    printf("Enter publication year to filter: "); // Prompt for year
-    scanf("%d", &year);                        // Read year as integer
+    int most = SUITE_FAST_OPS > SUITE_FILE_ROUNDS ? SUITE_FAST_OPS : SUITE_FILE_ROUNDS;
+    double *samples = malloc((size_t) most * sizeof(double));
+    unsigned int rng = (unsigned int) seed;
+    int failed = 0;
 
-    int found = 0;                             // Flag to track if any books found
-    for (int i = 0; i < searchResultCount; i++) { // Loop through search results only
-        if (searchResults[i].publication_year == year) { // If publication year matches
-            printf("\nID: %d\nTitle: %s\nAuthor: %s\nYear: %d\nStatus: %s\n", // Display book details
-                   searchResults[i].id,         // Book ID
-                   searchResults[i].title,      // Book title
-                   searchResults[i].author,     // Book author
-                   searchResults[i].publication_year, // Publication year
-                   searchResults[i].is_borrowed ? "Borrowed" : "Available"); // Status
-            found = 1;                          // Set found flag
-        }
+    for (int r = 0; r < SUITE_FILE_ROUNDS; r++) { // Full text import (mmap + parallel parse)
+        double start = suite_now();
+        failed |= !load_books(catalog);
+        samples[r] = suite_now() - start;
     }
+    report("load_books", books, samples, SUITE_FILE_ROUNDS);
 
-    if (!found) {                              // If no books found from that year
-        printf("No books found from that year in the search results.\n"); // Display message
+    for (int r = 0; r < SUITE_FILE_ROUNDS; r++) { // Full text export
+        double start = suite_now();
+        failed |= !save_books(saved);
+        samples[r] = suite_now() - start;
     }
-}
+    report("save_books", books, samples, SUITE_FILE_ROUNDS);
 
-//**************************User Borrowing Functions ******************************//
+    for (int r = 0; r < SUITE_FILE_ROUNDS; r++) { // Streaming merge of the catalog into itself (every line a duplicate)
+        ImportStats stats;
+        double start = suite_now();
+        failed |= !stream_merge_books(catalog, &stats, NULL, NULL) || stats.imported != 0;
+        samples[r] = suite_now() - start;
+    }
+    report("merge_books", books, samples, SUITE_FILE_ROUNDS);
 
-// عرض جميع الكتب المتاحة (التي لم يتم استعارتها)
-// Display all available books (that haven't been borrowed)
-void viewAvailableBooks() {
-    // Initialize pointers if not done already
-    if (library_ptr == NULL) {                 // Check if pointers not initialized
-        init_user_pointers();                  // Initialize pointers to admin data
+    for (int r = 0; r < SUITE_FILE_ROUNDS; r++) { // Streaming export of one decade's available books
+        ScanQuery query;
+        scan_query_init(&query);
+        query.year_from = 1990;
+        query.year_to = 1999;
+        query.status = 0;
+        double start = suite_now();
+        FILE *file = fopen(saved, "w");
+        failed |= file == NULL || stream_export_books(file, NULL, &query, RENDER_TEXT, NULL, NULL) < 0;
+        failed |= file == NULL || fclose(file) != 0;
+        samples[r] = suite_now() - start;
     }
+    report("export_filtered", books, samples, SUITE_FILE_ROUNDS);
 
-    if (*book_count_ptr == 0) {                // Check if library is empty
-        printf("No books found, currently.\n"); // Display message
-        return;                                 // Exit function
+    IdList results = {0};
+    for (int i = 0; i < SUITE_QUERY_OPS; i++) {   // What searchByTitle runs for a new query (cache emptied first)
+        query_cache_clear();
+        double start = suite_now();
+        search_by_title(suite_queries[i % SUITE_QUERIES], &results);
+        samples[i] = suite_now() - start;
     }
+    report("search_by_title", books, samples, SUITE_QUERY_OPS);
 
-    printf("\nAvailable book list:\n");        // Display section header
-    printf("--------------------------------------------------\n"); // Display separator
-    
-    int available_count = 0;                   // Counter for available books
-    for (int i = 0; i < *book_count_ptr; i++) { // Loop through all books
-        if (!library_ptr[i].is_borrowed) {     // If book is not borrowed (available)
-            printf("ID: %d | %s by %s (%d)\n", // Display book info in compact format
-                   library_ptr[i].id,           // Book ID
-                   library_ptr[i].title,        // Book title
-                   library_ptr[i].author,       // Book author
-                   library_ptr[i].publication_year); // Publication year
-            available_count++;                  // Increment available counter
-        }
+    for (int i = 0; i < SUITE_QUERY_OPS; i++) {   // The same queries repeated: answered by the query cache
+        double start = suite_now();
+        search_by_title(suite_queries[i % SUITE_QUERIES], &results);
+        samples[i] = suite_now() - start;
     }
-    
-    if (available_count == 0) {                // If no available books found
-        printf("No books are currently available for borrowing.\n"); // Display message
+    report("search_by_title_cached", books, samples, SUITE_QUERY_OPS);
+
+    RankedHit ranked[RANKED_DEFAULT_RESULTS];
+    for (int i = 0; i < SUITE_QUERY_OPS; i++) {   // What rankedSearch runs for each query
+        double start = suite_now();
+        search_ranked(suite_typos[i % SUITE_TYPOS], RANKED_DEFAULT_RESULTS, ranked);
+        samples[i] = suite_now() - start;
     }
-}
+    report("search_ranked", books, samples, SUITE_QUERY_OPS);
 
-void borrowBook() {
-    // Initialize pointers if not done already
-    if (library_ptr == NULL) {                 // Check if pointers not initialized
-        init_user_pointers();                  // Initialize pointers to admin data
+    ScanQuery scan;                               // Unindexed combined filter: every slot is visited
+    scan_query_init(&scan);
+    scan.title = "of";
+    scan.author = "son";
+    scan.year_from = 1950;
+    scan.year_to = 2000;
+    scan.status = 0;
+    for (int threads = 1; threads >= 0; threads--) { // One thread, then one per core
+        scan_set_threads(threads);
+        for (int i = 0; i < SUITE_SCAN_OPS; i++) {
+            double start = suite_now();
+            failed |= !scan_books(&scan, &results);
+            samples[i] = suite_now() - start;
+        }
+        report(threads == 1 ? "scan_books_1_thread" : "scan_books", books, samples, SUITE_SCAN_OPS);
     }
 
-    int id, found = 0;                         // Variables for book ID and found flag
+    Completion completions[PREFIX_DEFAULT_RESULTS];
+    for (int field = 0; field < PREFIX_FIELDS; field++) { // The first completion builds the index from the library
+        double start = suite_now();
+        failed |= prefix_complete(field, "", PREFIX_DEFAULT_RESULTS, completions) < 0;
+        samples[field] = suite_now() - start;
+    }
+    report("complete_build", books, samples, PREFIX_FIELDS);
+    for (int i = 0; i < SUITE_QUERY_OPS; i++) {   // What autocomplete runs: the first 1-4 letters of a title word
+        char prefix[8];
+        snprintf(prefix, sizeof(prefix), "%.*s", 1 + i % 4, suite_queries[i % SUITE_QUERIES]);
+        double start = suite_now();
+        prefix_complete(PREFIX_TITLES, prefix, PREFIX_DEFAULT_RESULTS, completions);
+        prefix_complete(PREFIX_AUTHORS, prefix, PREFIX_DEFAULT_RESULTS, completions);
+        samples[i] = suite_now() - start;
+    }
+    report("complete", books, samples, SUITE_QUERY_OPS);
 
-    if (*book_count_ptr == 0) {                // Check if library is empty
-        printf("No books in the library.\n");  // Display message
-        return;                                 // Exit function
+    IdList base = {0};                            // Search results the filters narrow down
+    search_by_title("the", &base);
+    int authors = catalog_author_count(books);
+    for (int i = 0; i < SUITE_QUERY_OPS; i++) {   // filterByAuthor: copy the results, intersect with the author's books
+        char author[64];
+        catalog_author(rand_r(&rng) % authors, author, sizeof(author));
+        double start = suite_now();
+        results.count = 0;
+        const IdList *by_author = author_index_lookup(author);
+        if (by_author != NULL) {
+            for (int r = 0; r < base.count; r++) id_list_push(&results, base.ids[r]);
+            id_list_intersect(&results, by_author->ids, by_author->count);
+        }
+        samples[i] = suite_now() - start;
     }
+    report("filter_by_author", books, samples, SUITE_QUERY_OPS);
 
-    printf("Enter the book ID you desire to borrow: "); // Prompt for book ID
-    scanf("%d", &id);                          // Read book ID
+    for (int i = 0; i < SUITE_QUERY_OPS; i++) {   // filterByYear: year range, intersected with the results
+        int from = 1700 + rand_r(&rng) % 320;
+        int to = from + rand_r(&rng) % 10;
+        double start = suite_now();
+        results.count = 0;
+        year_index_range(from, to, &results);
+        id_list_intersect(&results, base.ids, base.count);
+        samples[i] = suite_now() - start;
+    }
+    report("filter_by_year", books, samples, SUITE_QUERY_OPS);
+    id_list_free(&base);
+    id_list_free(&results);
 
-    for (int i = 0; i < *book_count_ptr; i++) { // Loop through all books
-        if (library_ptr[i].id == id && !library_ptr[i].is_borrowed) { // If book found and available
-            library_ptr[i].is_borrowed = 1;    // Mark book as borrowed
-            found = 1;                          // Set found flag
-            printf("The book \"%s\" by %s is borrowed successfully.\n", // Confirm borrowing
-                   library_ptr[i].title, library_ptr[i].author);
-            break;                              // Exit loop
-        } else if (library_ptr[i].id == id && library_ptr[i].is_borrowed) { // If book found but already borrowed
-            printf("The book \"%s\" is already borrowed.\n", library_ptr[i].title); // Display message
-            return;                             // Exit function
-        }
+    long long hits = 0;
+    for (int i = 0; i < SUITE_FAST_OPS; i++) {    // ID lookups through the hash index
+        int id = random_id(&rng, books);
+        double start = suite_now();
+        hits += find_book_by_id(id) != -1;
+        samples[i] = suite_now() - start;
     }
+    report("find_book_by_id", books, samples, SUITE_FAST_OPS);
+    failed |= hits != SUITE_FAST_OPS;
 
-    if (!found) {                              // If book not found
-        printf("The book with ID %d is not found.\n", id); // Display error message
+    int *loaned = malloc(SUITE_FAST_OPS * sizeof(int)); // Borrow random books, then return the same ones
+    for (int i = 0; i < SUITE_FAST_OPS; i++) {
+        loaned[i] = random_id(&rng, books);
+        double start = suite_now();
+        borrow_book(loaned[i]);
+        samples[i] = suite_now() - start;
     }
-}
+    report("borrow_book", books, samples, SUITE_FAST_OPS);
+    for (int i = 0; i < SUITE_FAST_OPS; i++) {
+        double start = suite_now();
+        return_book(loaned[i]);
+        samples[i] = suite_now() - start;
+    }
+    report("return_book", books, samples, SUITE_FAST_OPS);
+    free(loaned);
 
-void returnBook() {
-    // Initialize pointers if not done already
-    if (library_ptr == NULL) {                 // Check if pointers not initialized
-        init_user_pointers();                  // Initialize pointers to admin data
+    long long total = 0;
+    for (int i = 0; i < SUITE_FAST_OPS; i++) {    // The counts countTotalBooks prints
+        double start = suite_now();
+        total += *get_book_count_address() - count_borrowed_books();
+        samples[i] = suite_now() - start;
     }
+    report("count_total_books", books, samples, SUITE_FAST_OPS);
+    failed |= total <= 0 && books > 0;
 
-    int id, found = 0;                         // Variables for book ID and found flag
+    LoanRank ranks[LEDGER_DEFAULT_RESULTS];       // The figures circulationReport prints
+    DecadeLoans *decades = malloc(LEDGER_DECADES * sizeof(DecadeLoans));
+    int figures = 0;
+    for (int i = 0; i < SUITE_QUERY_OPS; i++) {
+        double start = suite_now();
+        figures += ledger_top_books(LEDGER_DEFAULT_RESULTS, ranks);
+        figures += ledger_top_authors(LEDGER_DEFAULT_RESULTS, ranks);
+        figures += ledger_decades(decades);
+        samples[i] = suite_now() - start;
+    }
+    report("circulation_report", books, samples, SUITE_QUERY_OPS);
+    failed |= figures == 0;
+    free(decades);
 
-    if (*book_count_ptr == 0) {                // Check if library is empty
-        printf("No books in the library.\n");  // Display message
-        return;                                 // Exit function
+    int removals = books / 2 < SUITE_REMOVE_OPS ? (int) (books / 2) : SUITE_REMOVE_OPS;
+    for (int i = 0; i < removals; i++) {          // Remove random books (an ID already gone is retried)
+        int id;
+        do id = random_id(&rng, books); while (find_book_by_id(id) == -1);
+        double start = suite_now();
+        remove_book(id);
+        samples[i] = suite_now() - start;
     }
+    report("remove_book", books, samples, removals);
 
-    printf("Enter the book ID you want to return: "); // Prompt for book ID
-    scanf("%d", &id);                          // Read book ID
+    free(samples);
+    clear_library();
+    unlink(catalog);
+    unlink(saved);
+    return failed;
+}
 
-    for (int i = 0; i < *book_count_ptr; i++) { // Loop through all books
-        if (library_ptr[i].id == id && library_ptr[i].is_borrowed) { // If book found and borrowed
-            library_ptr[i].is_borrowed = 0;    // Mark book as available
-            found = 1;                          // Set found flag
-            printf("The book \"%s\" by %s is returned successfully.\n", // Confirm return
-                   library_ptr[i].title, library_ptr[i].author);
-            break;                              // Exit loop
-        } else if (library_ptr[i].id == id && !library_ptr[i].is_borrowed) { // If book found but not borrowed
-            printf("The book \"%s\" is not currently borrowed.\n", library_ptr[i].title); // Display message
-            return;                             // Exit function
+int main(int argc, char *argv[]) {
+    if (argc >= 4 && strcmp(argv[1], "generate") == 0) {
+        long long count = strtoll(argv[2], NULL, 10);
+        unsigned long long seed = argc > 4 ? strtoull(argv[4], NULL, 10) : CATALOG_DEFAULT_SEED;
+        FILE *out = count > 0 ? fopen(argv[3], "w") : NULL;
+        if (out == NULL) {
+            perror(argv[3]);
+            return 1;
         }
+        int ok = generate_catalog(out, count, seed);
+        ok = (fclose(out) == 0) && ok;
+        return ok ? 0 : 1;
+    }
+    if (argc < 2 || strcmp(argv[1], "run") != 0) {
+        fprintf(stderr, "usage: %s generate COUNT FILE [SEED]\n"
+                        "       %s run [COUNT...]\n", argv[0], argv[0]);
+        return 1;
     }
 
-    if (!found) {                              // If book not found
-        printf("The book with ID %d is not found.\n", id); // Display error message
+    static const long long default_sizes[] = { 1000, 10000, 100000, 1000000 };
+    int sizes = argc > 2 ? argc - 2 : 4;
+    int status = 0;
+    for (int s = 0; s < sizes; s++) {             // One child per size keeps peak RSS separate
+        long long books = argc > 2 ? strtoll(argv[2 + s], NULL, 10) : default_sizes[s];
+        if (books <= 0) {
+            fprintf(stderr, "Bad catalog size: %s\n", argv[2 + s]);
+            return 1;
+        }
+        pid_t child = fork();
+        if (child == 0) {
+            _exit(run_suite(books, CATALOG_DEFAULT_SEED));
+        }
+        int child_status = 1;
+        if (child < 0 || waitpid(child, &child_status, 0) < 0 || !WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0) {
+            fprintf(stderr, "Benchmarks failed for %lld books\n", books);
+            status = 1;
+        }
     }
+    return status;
 }
 
-// ==================== data_handler.h ====================
-#ifndef DATA_HANDLER_H         // Include guard to prevent multiple inclusions
-#define DATA_HANDLER_H         // Define the include guard macro
+// ==================== loadgen.c ====================
+// Load generator for the daemon (library_system --serve).
+// Opens several client connections, sends a mix of searches, borrows and
+// returns, and reports throughput and latency percentiles.
+//   library_loadgen [SOCKET] [CLIENTS] [REQUESTS_PER_CLIENT]
+#include <stdio.h>             // For printf, fdopen, getline functions
+#include <stdlib.h>            // For atoi, malloc, qsort functions
+#include <string.h>            // For strncpy, strlen functions
+#include <time.h>              // For clock_gettime function
+#include <pthread.h>           // For pthread_create, pthread_join functions
+#include <unistd.h>            // For close, dup functions
+#include <sys/socket.h>        // For socket, connect functions
+#include <sys/un.h>            // For sockaddr_un
 
-#include "book.h"              // Include header for Book structure
+#define LOADGEN_SEARCH_PERCENT 80      // Share of requests that are title searches (the rest borrow or return)
 
-// Function declarations for data handling
-// Loads book data from a file into the 'books' array
-int load_books(const char *filename, Book *books, int *count);
-// Saves book data from the 'books' array to a file
-int save_books(const char *filename, const Book *books, int count);
+static const char *loadgen_terms[] = { // Title fragments to search for
+    "the", "of", "and", "war", "love", "history", "night", "garden", "river", "king"
+};
 
-#endif // DATA_HANDLER_H       // End of include guard
+// One client connection and its measurements
+typedef struct {
+    const char *socket_path;   // Server to connect to
+    int requests;              // Requests to send
+    int book_count;            // IDs 1..book_count are used for borrow/return
+    unsigned int seed;         // Per-client random state
+    double *latencies;         // Seconds per request
+    int completed;             // Requests answered
+} LoadClient;
 
-// ==================== data_handler.c ====================
-#include <stdio.h>             // For fopen, fclose, fscanf, fprintf functions
-#include <stdlib.h>            // For general utilities (though not directly used here)
-#include <string.h>            // For strcspn function
+// Current time in seconds from a monotonic clock
+static double loadgen_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
 
-#include "data_handler.h"      // Include our data handler declarations
+// Connect to the server; returns a socket or -1
+static int loadgen_connect(const char *path) {
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
 
-// Function to load books from a text file
-int load_books(const char *filename, Book *books, int *count) {
-    FILE *file = fopen(filename, "r");         // Open file for reading
-    if (file == NULL) {                        // If file cannot be opened
-        // If the file doesn't exist, it's normal for the first run
-        // or if it's empty. Initialize count to 0.
-        *count = 0;                            // Set book count to 0
-        return 0;                              // Return 0 to indicate failure to open/load
+// Read one reply; a "list" reply is the only multi-line one and is not sent here
+static int read_reply(FILE *in, char **line, size_t *capacity) {
+    return getline(line, capacity, in) != -1;
+}
+
+// Client thread: send requests one at a time and time each round trip
+static void *run_client(void *arg) {
+    LoadClient *client = arg;
+    int fd = loadgen_connect(client->socket_path);
+    if (fd < 0) {
+        perror(client->socket_path);
+        return NULL;
+    }
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    char *line = NULL;
+    size_t capacity = 0;
+    for (int r = 0; r < client->requests; r++) {
+        int pick = rand_r(&client->seed) % 100;
+        int id = 1 + rand_r(&client->seed) % (client->book_count > 0 ? client->book_count : 1);
+        double start = loadgen_now();
+        if (pick < LOADGEN_SEARCH_PERCENT) {
+            fprintf(out, "search;%s\n", loadgen_terms[rand_r(&client->seed) % (sizeof(loadgen_terms) / sizeof(loadgen_terms[0]))]);
+        } else if (pick % 2 == 0) {
+            fprintf(out, "borrow;%d\n", id);
+        } else {
+            fprintf(out, "return;%d\n", id);
+        }
+        fflush(out);
+        if (!read_reply(in, &line, &capacity)) {     // Server went away
+            break;
+        }
+        client->latencies[client->completed++] = loadgen_now() - start;
     }
+    free(line);
+    fclose(out);
+    fclose(in);
+    return NULL;
+}
 
-    *count = 0;                                // Reset book count before loading
-    // Read 5 fields (ID, Title, Author, Year, is_borrowed) using semicolon as delimiter
-    while (*count < MAX_BOOKS &&              // While we haven't reached max books and
-           fscanf(file, "%d;%99[^;];%99[^;];%d;%d\n", // Read formatted data from file
-                  &books[*count].id,           // Read book ID
-                  books[*count].title,         // Read book title (up to 99 chars, stop at semicolon)
-                  books[*count].author,        // Read book author (up to 99 chars, stop at semicolon)
-                  &books[*count].publication_year, // Read publication year
-                  &books[*count].is_borrowed) == 5) { // Read borrowed status, check if all 5 fields read
-        (*count)++;                            // Increment book count
+// Ask the server how many books it holds ("count" replies "<n> ok <total> <borrowed>")
+static int fetch_book_count(const char *path) {
+    int fd = loadgen_connect(path);
+    if (fd < 0) {
+        return -1;
+    }
+    FILE *stream = fdopen(fd, "r+");
+    char *line = NULL;
+    size_t capacity = 0;
+    int total = -1;
+    fprintf(stream, "count\n");
+    fflush(stream);
+    if (read_reply(stream, &line, &capacity)) {
+        long long number;
+        sscanf(line, "%lld ok %d", &number, &total);
     }
+    free(line);
+    fclose(stream);
+    return total;
+}
 
-    fclose(file);                              // Close the file
-    return 1;                                  // Return 1 to indicate successful loading
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
 }
 
-// Function to save books to a text file
-int save_books(const char *filename, const Book *books, int current_book_count) {
-    FILE *file = fopen(filename, "w");         // Open file for writing (clears old content)
-    if (file == NULL) {                        // If file cannot be opened for writing
-        perror("Error opening file for saving"); // Print error message with system error info
-        return 0;                              // Return 0 to indicate save failure
+// Value below which `fraction` of the sorted samples lie
+static double percentile(const double *sorted, long long count, double fraction) {
+    long long index = (long long) (fraction * (double) (count - 1) + 0.5);
+    return sorted[index];
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "library.sock";
+    int clients = argc > 2 ? atoi(argv[2]) : 8;
+    int requests = argc > 3 ? atoi(argv[3]) : 10000;
+    if (clients <= 0 || requests <= 0) {
+        fprintf(stderr, "usage: %s [SOCKET] [CLIENTS] [REQUESTS_PER_CLIENT]\n", argv[0]);
+        return 1;
+    }
+    int book_count = fetch_book_count(path);
+    if (book_count < 0) {
+        perror(path);
+        return 1;
     }
 
-    for (int i = 0; i < current_book_count; i++) { // Loop through all books to save
-        fprintf(file, "%d;%s;%s;%d;%d\n",      // Write book data to file with semicolon delimiters
-                books[i].id,                    // Write book ID
-                books[i].title,                 // Write book title
-                books[i].author,                // Write book author
-                books[i].publication_year,      // Write publication year
-                books[i].is_borrowed);          // Write borrowed status
+    LoadClient *all = calloc((size_t) clients, sizeof(LoadClient));
+    pthread_t *threads = malloc((size_t) clients * sizeof(pthread_t));
+    for (int c = 0; c < clients; c++) {
+        all[c].socket_path = path;
+        all[c].requests = requests;
+        all[c].book_count = book_count;
+        all[c].seed = 12345u + (unsigned int) c;
+        all[c].latencies = malloc((size_t) requests * sizeof(double));
+    }
+    double start = loadgen_now();
+    for (int c = 0; c < clients; c++) {
+        pthread_create(&threads[c], NULL, run_client, &all[c]);
     }
+    for (int c = 0; c < clients; c++) {
+        pthread_join(threads[c], NULL);
+    }
+    double elapsed = loadgen_now() - start;
 
-    fclose(file);                              // Close the file
-    return 1;                                  // Return 1 to indicate successful saving
+    long long total = 0;                              // Merge every client's samples
+    for (int c = 0; c < clients; c++) total += all[c].completed;
+    double *samples = malloc((size_t) (total > 0 ? total : 1) * sizeof(double));
+    long long n = 0;
+    for (int c = 0; c < clients; c++) {
+        for (int r = 0; r < all[c].completed; r++) samples[n++] = all[c].latencies[r];
+        free(all[c].latencies);
+    }
+    if (total == 0) {
+        fprintf(stderr, "No requests completed\n");
+        return 1;
+    }
+    qsort(samples, (size_t) total, sizeof(double), compare_doubles);
+    printf("%d clients, %lld requests in %.2f s (%d books)\n", clients, total, elapsed, book_count);
+    printf("throughput: %.0f requests/s\n", (double) total / elapsed);
+    printf("latency: p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+           percentile(samples, total, 0.50) * 1e6, percentile(samples, total, 0.99) * 1e6,
+           percentile(samples, total, 0.999) * 1e6, samples[total - 1] * 1e6);
+    free(samples);
+    free(threads);
+    free(all);
+    return 0;
 }
 
 // ==================== main.c ====================
@@ -585,11 +8263,30 @@ int save_books(const char *filename, const Book *books, int current_book_count)
 #include "admin.h"             // Include admin function declarations
 #include "user.h"              // Include user function declarations
 #include "book.h"              // Include Book structure and related functions
+#include "data_handler.h"      // Include load_books and save_books
+#include "journal.h"           // Include change journaling
+#include "batch.h"             // Include batch command mode
+#include "server.h"            // Include daemon mode
+#include "stats.h"             // Include operation statistics
+#include <string.h>            // Include strcmp function
+#include <errno.h>             // Include ENOENT
+#include <unistd.h>            // Include access function
+
+#define LIBRARY_FILE "library.txt" // Text file imported when there is no snapshot yet
+#define LIBRARY_SNAPSHOT "library.snap" // Binary snapshot the library is loaded from and saved to
+#define LIBRARY_JOURNAL "library.journal" // Changes made since the snapshot was written
+#define LIBRARY_SOCKET "library.sock"   // Socket served by --serve when no path is given
+#define LIBRARY_STATS "library.stats"   // Operation statistics, rewritten every STATS_DUMP_INTERVAL seconds
 
 // Declare external variables - these are defined in admin.c
-extern Book library[MAX_BOOKS]; // External reference to library array
+extern Book *library;          // External reference to library array
 extern int book_count;           // External reference to book count
 
+// Function to handle an invalid menu choice
+void invalid_choice() {
+    printf("Invalid choice. Please try again.\n"); // Display error message
+}
+
 // Admin mode: simple menu for demonstration
 void admin_mode() {
     int choice;                                // Variable to store user's menu choice
@@ -599,7 +8296,13 @@ void admin_mode() {
     printf("3. View All Books\n");            // Display menu option 3
     printf("4. Count Total Books\n");         // Display menu option 4
     printf("5. View Borrowed Books\n");       // Display menu option 5
-    printf("6. Exit Admin Mode\n");           // Display menu option 6
+    printf("6. Import Books from Text File\n"); // Display menu option 6
+    printf("7. Export Books to Text File\n"); // Display menu option 7
+    printf("8. Statistics\n");                // Display menu option 8
+    printf("9. Circulation Report\n");       // Display menu option 9
+    printf("10. Merge Books from Text File\n"); // Display menu option 10
+    printf("11. Export Matching Books\n");   // Display menu option 11
+    printf("12. Exit Admin Mode\n");         // Display menu option 12
     printf("Enter your choice: ");            // Prompt for choice
     scanf("%d", &choice);                     // Read user's choice
 
@@ -611,10 +8314,208 @@ void admin_mode() {
             removeBook();                     // Call function to remove a book
             break;                            // Exit switch statement
         case 3:                               // If user chose option 3
-            view_all_books(library, book_count); // Call function to view all books
+            view_all_books();                 // Call function to view all books
             break;                            // Exit switch statement
         case 4:                               // If user chose option 4
             countTotalBooks();                // Call function to count books
             break;                            // Exit switch statement
         case 5:                               // If user chose option 5
-            view_borrowed_books(library, book_count); // Call function to view borrowed books
\ No newline at end of file
+            view_borrowed_books(library, get_slot_count()); // Call function to view borrowed books
+            break;                            // Exit switch statement
+        case 6:                               // If user chose option 6
+            importBooks();                    // Call function to import a text file
+            break;                            // Exit switch statement
+        case 7:                               // If user chose option 7
+            exportBooks();                    // Call function to export a text file
+            break;                            // Exit switch statement
+        case 8:                               // If user chose option 8
+            showStatistics();                 // Call function to show operation statistics
+            break;                            // Exit switch statement
+        case 9:                               // If user chose option 9
+            circulationReport();              // Call function to show loan figures
+            break;                            // Exit switch statement
+        case 10:                              // If user chose option 10
+            mergeBooks();                     // Call function to merge a text file
+            break;                            // Exit switch statement
+        case 11:                              // If user chose option 11
+            exportMatchingBooks();            // Call function to export matching books
+            break;                            // Exit switch statement
+        case 12:                              // If user chose option 12
+            printf("Exiting Admin Mode...\n"); // Display mode exit message
+            break;                            // Exit switch statement
+        default:                              // Any other number
+            invalid_choice();                 // Report the invalid choice
+            break;                            // Exit switch statement
+    }
+}
+
+// User mode: search, borrow and return books
+void user_mode() {
+    int choice;                                // Variable to store user's menu choice
+    printf("Entering User Mode...\n");        // Display mode entry message
+    printf("1. Search Book\n");               // Display menu option 1
+    printf("2. View Available Books\n");      // Display menu option 2
+    printf("3. Borrow Book\n");               // Display menu option 3
+    printf("4. Return Book\n");               // Display menu option 4
+    printf("5. Search by Author\n");          // Display menu option 5
+    printf("6. Search by Year Range\n");      // Display menu option 6
+    printf("7. Ranked Search (typo tolerant)\n"); // Display menu option 7
+    printf("8. Autocomplete Title or Author\n"); // Display menu option 8
+    printf("9. Exit User Mode\n");            // Display menu option 9
+    printf("Enter your choice: ");            // Prompt for choice
+    scanf("%d", &choice);                     // Read user's choice
+
+    switch (choice) {                         // Execute based on user choice
+        case 1:                               // If user chose option 1
+            searchByTitle();                  // Call function to search by title
+            break;                            // Exit switch statement
+        case 2:                               // If user chose option 2
+            viewAvailableBooks();             // Call function to list available books
+            break;                            // Exit switch statement
+        case 3:                               // If user chose option 3
+            borrowBook();                     // Call function to borrow a book
+            break;                            // Exit switch statement
+        case 4:                               // If user chose option 4
+            returnBook();                     // Call function to return a book
+            break;                            // Exit switch statement
+        case 5:                               // If user chose option 5
+            searchByAuthor();                 // Call function to search by author
+            break;                            // Exit switch statement
+        case 6:                               // If user chose option 6
+            searchByYearRange();              // Call function to search by year range
+            break;                            // Exit switch statement
+        case 7:                               // If user chose option 7
+            rankedSearch();                   // Call function for ranked fuzzy search
+            break;                            // Exit switch statement
+        case 8:                               // If user chose option 8
+            autocomplete();                   // Call function to complete a prefix
+            break;                            // Exit switch statement
+        case 9:                               // If user chose option 9
+            printf("Exiting User Mode...\n"); // Display mode exit message
+            break;                            // Exit switch statement
+        default:                              // Any other number
+            invalid_choice();                 // Report the invalid choice
+            break;                            // Exit switch statement
+    }
+}
+
+// Function to move a damaged snapshot and its journals out of the way
+// They become "<name>.bad" (or ".bad.N" if that is taken), so nothing saved
+// from now on overwrites what may still be recovered from them. Returns 0
+// if a file could not be moved.
+static int set_aside_damaged_snapshot() {
+    const char *files[] = { LIBRARY_SNAPSHOT, LIBRARY_JOURNAL, LIBRARY_JOURNAL ".prev" };
+    char suffix[32] = ".bad";                 // Same suffix for the snapshot and its journals
+    char name[256];
+    snprintf(name, sizeof(name), "%s%s", LIBRARY_SNAPSHOT, suffix);
+    for (int n = 1; access(name, F_OK) == 0; n++) { // Keep copies from earlier failures
+        snprintf(suffix, sizeof(suffix), ".bad.%d", n);
+        snprintf(name, sizeof(name), "%s%s", LIBRARY_SNAPSHOT, suffix);
+    }
+    for (int f = 0; f < 3; f++) {
+        snprintf(name, sizeof(name), "%s%s", files[f], suffix);
+        if (rename(files[f], name) != 0 && errno != ENOENT) { // A missing journal is fine
+            perror(files[f]);
+            return 0;
+        }
+    }
+    printf("Warning: %s is damaged; it was kept as %s%s (with its journal).\n", LIBRARY_SNAPSHOT, LIBRARY_SNAPSHOT, suffix);
+    return 1;
+}
+
+// Function to save the library once and close the journal (used on every exit)
+static void persist_library() {
+    if (!journal_checkpoint()) {              // Fold the journal into a fresh snapshot
+        save_snapshot(LIBRARY_SNAPSHOT);      // No journal: persist the library directly
+    }
+    journal_close();                          // Flush and close the journal
+    stats_stop_dump();                        // Write the final statistics
+}
+
+// Function to run batch mode: commands from a file (or stdin for "-"), one persist at the end
+static int batch_mode(const char *path) {
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r"); // Command source
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+    BatchStats stats;                         // Commands run and failed
+    run_batch(in, stdout, &stats);            // Apply every command through the core functions
+    if (in != stdin) {
+        fclose(in);
+    }
+    persist_library();                        // Single save for the whole batch
+    fflush(stdout);                           // Results before the summary
+    fprintf(stderr, "%lld commands, %lld failed\n", stats.commands, stats.failed);
+    return stats.failed == 0 ? 0 : 1;         // Exit status tells scripts whether anything failed
+}
+
+int main(int argc, char *argv[]) {
+    int batch = argc > 1 && strcmp(argv[1], "--batch") == 0; // library_system --batch [FILE|-]
+    int serve = argc > 1 && strcmp(argv[1], "--serve") == 0; // library_system --serve [SOCKET]
+    if (batch) {                              // Results are written in large blocks, not per line
+        setvbuf(stdout, NULL, _IOFBF, BATCH_OUTPUT_BUFFER);
+    }
+    int loaded = load_snapshot(LIBRARY_SNAPSHOT); // Map the binary snapshot (no parsing)
+    if (loaded == -1) {                       // Snapshot exists but is damaged or of an unknown format
+        if (!set_aside_damaged_snapshot()) {  // Never save over it
+            fprintf(stderr, "Cannot move %s aside; not starting.\n", LIBRARY_SNAPSHOT);
+            return 1;
+        }
+        printf("Importing %s instead.\n", LIBRARY_FILE);
+    }
+    if (loaded != 1) {                        // No usable snapshot: import the text file
+        load_books(LIBRARY_FILE);             // An absent file means an empty library
+    }
+    if (!journal_open(LIBRARY_JOURNAL, LIBRARY_SNAPSHOT)) { // Replay changes made since the snapshot
+        printf("Warning: cannot open %s; changes are saved only on exit.\n", LIBRARY_JOURNAL);
+    } else if (loaded != 1) {                 // Journal must follow a snapshot of this library
+        journal_checkpoint();
+    }
+    stats_start_dump(LIBRARY_STATS, STATS_DUMP_INTERVAL); // Statistics file for monitoring
+    if (batch) {                              // No menu: run the commands and leave
+        return batch_mode(argc > 2 ? argv[2] : "-");
+    }
+    if (serve) {                              // No menu: serve clients until stopped
+        int status = run_server(argc > 2 ? argv[2] : LIBRARY_SOCKET, SERVER_THREADS);
+        persist_library();                    // Save once on the way out
+        return status;
+    }
+    printf("Welcome to the Library Management System\n"); // Display welcome message
+
+    while (1) {                               // Keep showing the main menu until the user exits
+        int choice;                           // Variable to store user's menu choice
+        printf("\nMain Menu\n");              // Display menu header
+        printf("1. Admin Mode\n");            // Display menu option 1
+        printf("2. User Mode\n");             // Display menu option 2
+        printf("3. Exit\n");                  // Display menu option 3
+        printf("Enter your choice: ");        // Prompt for choice
+        if (scanf("%d", &choice) != 1) {      // Input closed or not a number
+            clear_input_buffer();             // Discard the bad input
+            if (feof(stdin)) {                // Nothing more to read: exit like option 3
+                choice = 3;
+            } else {
+                invalid_choice();             // Report the invalid choice
+                continue;                     // Show the menu again
+            }
+        }
+
+        switch (choice) {                     // Execute based on user choice
+            case 1:                           // If user chose option 1
+                admin_mode();                 // Enter admin mode
+                journal_commit();             // Make the changes durable
+                break;                        // Back to the main menu
+            case 2:                           // If user chose option 2
+                user_mode();                  // Enter user mode
+                journal_commit();             // Make the changes durable
+                break;                        // Back to the main menu
+            case 3:                           // If user chose option 3
+                persist_library();            // Save the library and close the journal
+                printf("Goodbye!\n");         // Display exit message
+                return 0;                     // Exit the program
+            default:                          // Any other number
+                invalid_choice();             // Report the invalid choice
+                break;                        // Back to the main menu
+        }
+    }
+}